@@ -1,24 +1,85 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
 
 #ifdef _WIN32
 #include <windows.h>
 #include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #else
 #include <dirent.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <pthread.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
 #endif
 
 // Constants
 #define MAX_FILES 100
 #define MAX_PATH 260
 #define MAX_LINE 1024
-#define MAX_RECORDS 10000
+#define INITIAL_CAPACITY 64
+#define STRING_BLOCK_SIZE 65536
+#define RECORD_FIELDS 5
+#define MAX_LOAD_THREADS 64
+#define PARALLEL_LOAD_MIN_BYTES (1 << 20)
+#define PARALLEL_SAVE_MIN_ROWS 100000
+#define SCAN_BLOCK 64
+#define BENCH_TRIALS 5
+#define BENCH_LAYOUT_ROWS 1000000
+#define BENCH_MAX_SIZES 8
+#define BENCH_LOOKUPS 1000
+#define BENCH_DEFAULT_SIZES "10000,100000,1000000,10000000"
+#define GENERATOR_RECENT_IDS 1024
+#define METRIC_SUB_BUCKETS 16 // Per power of two, so a bucket is within 1/16 of its values
+#define METRIC_BUCKETS ((64 - 4 + 1) * METRIC_SUB_BUCKETS)
+#define METRIC_LOOKUP_SAMPLE 64 // Time one ID lookup in this many; a power of two
+#define TRACE_CAPACITY (1 << 16)  // Events kept by --trace, newest win; a power of two
+
+// Span markers for --trace; with tracing off each is one predictable branch
+#define TRACE_BEGIN(name) (tracing ? trace_record((name), 'B') : (void)0)
+#define TRACE_END(name) (tracing ? trace_record((name), 'E') : (void)0)
+#define JOURNAL_CHECKPOINT_BYTES (4L << 20)
+#define JOURNAL_SUFFIX ".journal"
+#define JOURNAL_BATCH_ENTRIES 64
+#define TEMP_SUFFIX ".tmp"
+#define SAVE_BUFFER_SIZE (1 << 20)
+#define SNAPSHOT_SUFFIX ".tdb"
+#define SNAPSHOT_MAGIC "TDBSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+#define SNAPSHOT_ALIGN 64
+#define ARCHIVE_SUFFIX ".tda"
+#define ARCHIVE_MAGIC "TDBARCH"
+#define ARCHIVE_VERSION 1
+#define STATS_TOP_GROUPS 10
+#define BATCH_MAX_FIELDS 8
 #define MAX_ATTEMPTS 3
 #define PAGINATION_SIZE 20
+#define SCREEN_MAX_LINES 64 // Lines in one composed screen; a page is PAGINATION_SIZE + 4
+#define SCREEN_LINE_SIZE 512
+#define SCREEN_CLEAR "\x1b[H\x1b[2J\x1b[3J" // Home, erase the screen and its scrollback, as clear(1) does
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#define CLEAR_TO_NULL_COMMAND "cls > NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#define CLEAR_TO_NULL_COMMAND "clear > /dev/null 2>&1"
+#endif
 #define MIN_NAME_LENGTH 3
 #define REQUIRED_HEADER "TestID,SystemName,TestType,TestResult,Active"
 
@@ -32,34 +93,596 @@ typedef enum
     INVALID_RESULT = -1
 } TestResult;
 
+#define INVALID_CODE UINT32_MAX
+
+// When changes are forced to disk (TDM_DURABILITY=none|commit|batch)
+typedef enum
+{
+    DURABILITY_NONE = 0, // Flush to the OS only
+    DURABILITY_COMMIT,   // fsync every journal entry and checkpoint
+    DURABILITY_BATCH     // fsync every JOURNAL_BATCH_ENTRIES entries and at batch end
+} DurabilityMode;
+
 // Data Structure
 typedef struct
 {
     int test_id;
-    char system_name[100];
-    char test_type[100];
-    TestResult test_result;
-    int active;
+    uint32_t system_code; // Index into db.systems, see record_system_name()
+    uint32_t type_code;   // Index into db.types, see record_test_type()
+    int8_t test_result;   // TestResult
+    uint8_t active;       // 0 or 1
 } TestRecord;
 
+// Interned strings; equal strings share one code
+typedef struct
+{
+    const char **strings; // Indexed by code
+    uint32_t *lengths;
+    uint32_t *hashes;
+    uint32_t count;
+    uint32_t capacity;
+    uint64_t *slots; // Open addressing: hash << 32 | (code + 1), 0 = empty
+    uint32_t slot_count; // Power of two
+    int borrows_strings; // Keep callers' pointers instead of copying into the string arena
+} StringDictionary;
+
+// Backing storage for dictionary strings
+typedef struct StringBlock
+{
+    struct StringBlock *next;
+    size_t used;
+    size_t size;
+    char data[];
+} StringBlock;
+
+// Ascending IDs (dictionary codes or row numbers) sharing one trigram
+typedef struct
+{
+    uint32_t *items;
+    uint32_t count;
+    uint32_t capacity;
+} Posting;
+
+// Case-insensitive trigram -> posting list, for substring search
+typedef struct
+{
+    uint32_t *keys; // Three lowercased bytes + 1, 0 = empty
+    Posting *lists;
+    uint32_t slot_count; // Power of two
+    uint32_t used;
+    uint32_t indexed; // Entries [0, indexed) are posted, later ones are added on query
+} TrigramIndex;
+
+// TestID -> first row with that ID. Dense ID ranges use a direct array,
+// sparse ones an open-addressing table; see id_index_build()
+typedef struct
+{
+    int *direct; // direct[id - base] = row + 1, 0 = absent
+    int base;
+    int span;
+    uint64_t *slots; // (uint64_t)id << 32 | (row + 1), 0 = empty
+    uint32_t slot_count; // Power of two
+    uint32_t used;
+    int sparse;
+    int rows; // Rows [0, rows) are indexed, later ones are added on lookup; 0 = rebuild
+} IdIndex;
+
+// Counts over active rows, kept current by the database_* mutation functions
+typedef struct
+{
+    int by_result[SUCCESS + 1];
+    int *system_results; // [system code * (SUCCESS + 1) + result]
+    int *type_counts;    // [type code]
+    uint32_t system_capacity;
+    uint32_t type_capacity;
+    int valid; // 0 = rebuild with stats_rebuild() before use
+} Statistics;
+
+// Sections of a .tdb snapshot, in file order
+typedef enum
+{
+    SNAPSHOT_IDS,          // int32 per row
+    SNAPSHOT_SYSTEM_CODES, // uint32 per row
+    SNAPSHOT_TYPE_CODES,   // uint32 per row
+    SNAPSHOT_RESULTS,      // int8 per row
+    SNAPSHOT_ACTIVE,       // uint64 bitmap words, bits past the last row clear
+    SNAPSHOT_LENGTHS,      // uint32 per string: the systems, then the types
+    SNAPSHOT_STRINGS,      // The same strings, each followed by a NUL
+    SNAPSHOT_SECTIONS
+} SnapshotSection;
+
+// Start of a .tdb file. Sections follow at SNAPSHOT_ALIGN-aligned offsets in
+// the writer's byte order, so a mapping of the file can be used as the columns.
+typedef struct
+{
+    char magic[8];       // SNAPSHOT_MAGIC
+    uint32_t version;    // SNAPSHOT_VERSION
+    uint32_t byte_order; // SNAPSHOT_BYTE_ORDER as the writer stored it
+    uint64_t file_size;
+    uint32_t row_count;
+    int32_t next_id;
+    uint32_t system_count;
+    uint32_t type_count;
+    uint64_t offsets[SNAPSHOT_SECTIONS];
+    uint64_t sizes[SNAPSHOT_SECTIONS];
+    uint64_t checksums[SNAPSHOT_SECTIONS];
+    uint64_t header_checksum; // Over this header with the field zeroed
+} SnapshotHeader;
+
+// Growable output for archive_put_*; bits are packed least significant first
+typedef struct
+{
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+    uint64_t bit_buffer;
+    int bit_count;
+    int failed; // An allocation failed, later writes are dropped
+} ArchiveBuffer;
+
+typedef struct
+{
+    const unsigned char *data;
+    size_t size;
+    size_t pos;
+    uint64_t bit_buffer;
+    int bit_count;
+    int failed; // Read past the end or found a malformed value
+} ArchiveReader;
+
+// One timed operation of the bench suite; run returns 0 on failure
+typedef int (*BenchFn)(void);
+
+typedef struct
+{
+    const char *name;
+    BenchFn run;
+    int ops; // Operations per call, 0 for one per row
+} BenchCase;
+
+// Shape of a generated dataset; the same options and seed give the same file
+typedef struct
+{
+    long long rows;
+    uint64_t seed;
+    int systems;                     // Distinct SystemName values
+    int types;                       // Distinct TestType values
+    int result_weights[SUCCESS + 1]; // Relative frequency of each TestResult
+    double deleted;                  // Share of rows written with Active 0
+    double gaps;                     // Share of TestIDs that skip ahead
+    int max_gap;                     // Largest skip, in IDs
+    double duplicates;               // Share of rows reusing a recent TestID
+} GeneratorOptions;
+
+// Operations timed into the session metrics
+typedef enum
+{
+    METRIC_LOAD,
+    METRIC_SAVE,
+    METRIC_SEARCH,
+    METRIC_LOOKUP,
+    METRIC_DELETE,
+    METRIC_OPS
+} MetricOp;
+
+// Log-bucketed latency counts in nanoseconds: exact below 16 ns, then 16
+// sub-buckets per power of two
+typedef struct
+{
+    uint64_t calls; // Every call, timed or not
+    uint64_t count; // Timed calls, which the buckets hold
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t buckets[METRIC_BUCKETS];
+} LatencyHistogram;
+
+typedef struct
+{
+    LatencyHistogram ops[METRIC_OPS];
+    uint64_t bytes_read;    // Database files and journals loaded
+    uint64_t bytes_written; // Saves and journal entries
+} Metrics;
+
+// One begin or end mark in the trace ring
+typedef struct
+{
+    const char *name; // Always a string literal
+    uint64_t timestamp_ns;
+    uint32_t thread;
+    char phase; // 'B' or 'E'
+} TraceEvent;
+
+// One full screen of text, one line per entry without the newline
+typedef struct
+{
+    char lines[SCREEN_MAX_LINES][SCREEN_LINE_SIZE];
+    int count;
+} ScreenFrame;
+
+// Full-screen renderer. The frame on the terminal is kept so the next one
+// rewrites only the lines that differ, all in a single write
+typedef struct
+{
+    ScreenFrame frames[2];
+    int shown;       // Frame on the terminal; the other is being composed
+    int shown_valid; // 0 once anything else may have been printed over it
+    int ansi;        // Escape sequences understood: -1 until checked, 0 or 1
+    int shown_rows;  // Terminal size the shown frame was drawn for
+    int shown_columns;
+    char output[(SCREEN_MAX_LINES + 1) * (SCREEN_LINE_SIZE + 32)];
+    size_t output_length;
+} Screen;
+
+// Column-oriented storage: row i is test_ids[i], system_codes[i], ... so a
+// filter only pulls the columns it reads into cache. Use database_get_record()
+// and database_set_record() for whole rows.
 typedef struct
 {
-    TestRecord records[MAX_RECORDS];
+    int *test_ids;
+    uint32_t *system_codes;
+    uint32_t *type_codes;
+    int8_t *results;
+    uint64_t *active_bits; // Bit i set = row i active; bits from count on are always 0
     int count;
+    int capacity; // Columns grow together, see database_reserve()
     char filename[MAX_PATH];
     int next_id;
+    StringBlock *strings;
+    StringDictionary systems;
+    StringDictionary types;
+    IdIndex ids;
+    TrigramIndex system_grams; // Over db.systems codes
+    TrigramIndex type_grams;   // Over db.types codes
+    TrigramIndex id_grams;     // Over rows, digit trigrams of the TestID; 0 indexed = rebuild
+    Statistics stats;
+    char *snapshot; // Loaded .tdb file the dictionaries (and maybe columns) point into
+    size_t snapshot_size;
+    int columns_mapped; // Columns are still inside snapshot; copied out before growing
+    FILE *journal; // Opened on the first change after a load or checkpoint
+    long journal_bytes; // Size of <filename>.journal, 0 = no pending changes
+    int journal_unsynced; // Entries written since the last fsync
+    int batch_depth; // Inside database_begin_batch(), see journal_sync_due()
 } Database;
 
+// Row numbers into the database columns, e.g. the records a listing shows
+typedef struct
+{
+    uint32_t *rows;
+    int count;
+} RowSet;
+
+// Compiled filter expression: each node tests one row through its eval function.
+// Name predicates are resolved against the dictionaries at compile time, so rows
+// are only checked by code, result, ID and active bit.
+typedef struct QueryNode QueryNode;
+typedef int (*QueryPredicate)(const QueryNode *node, int row);
+struct QueryNode
+{
+    QueryPredicate eval;
+    QueryNode *left;  // and, or, not
+    QueryNode *right; // and, or
+    uint8_t *codes;   // system, type: hit per dictionary code
+    uint32_t code_count;
+    int low; // id: inclusive range
+    int high;
+    unsigned result_mask; // result: bit per TestResult
+};
+
+typedef enum
+{
+    QUERY_END,
+    QUERY_WORD,
+    QUERY_STRING,
+    QUERY_SYMBOL
+} QueryTokenType;
+
+typedef struct
+{
+    const char *text;
+    size_t pos;         // Just past the current token
+    size_t token_start; // For error positions
+    QueryTokenType type;
+    char token[MAX_LINE];
+    char *error;
+    size_t error_size;
+} QueryParser;
+
 // Global database instance
 Database db = {0};
 
+// Set TDM_LOADER=buffered to read files with stdio instead of mmap
+int use_mapped_loader = 1;
+
+DurabilityMode durability_mode = DURABILITY_COMMIT;
+
+// Parser threads for the mapped loader, 0 = one per online CPU (TDM_LOAD_THREADS)
+int load_threads = 0;
+
+// Serializer threads for large saves, 0 = one per online CPU (TDM_SAVE_THREADS)
+int save_threads = 0;
+
+// Set by batch_main: warnings from loading and the journal then go to stderr,
+// keeping stdout to one record/ok/error line per result
+int batch_mode = 0;
+
+// Session latency histograms and byte counts, shown by the Metrics screen
+Metrics metrics;
+const char *metrics_json_path = NULL; // --metrics-json, written when the program exits
+// --trace <file>: spans are recorded into a ring by any thread and written as
+// Chrome trace_event JSON at exit
+int tracing = 0;
+const char *trace_path = NULL;
+TraceEvent *trace_events = NULL;
+uint64_t trace_head = 0; // Events ever recorded; the next one goes in slot head % TRACE_CAPACITY
+uint64_t trace_start_ns = 0;
+uint32_t trace_next_thread = 0;
+__thread uint32_t trace_thread_id = 0; // 1 for the thread that started tracing
+
+const char *metric_names[METRIC_OPS] = {"load_database", "save_database", "search_records", "find_record_by_id",
+                                        "delete_record"};
+
+// Renderer for full-screen pages such as the paginated record listing
+Screen screen = {.ansi = -1};
+
+// Invalid TestResult seen by a loader thread, reported once rows are in order
+typedef struct
+{
+    int test_id;
+    const char *token;
+} LoadWarning;
+
+// Bitmask of ',', '\n', '\r' and NUL bytes in a 64-byte block
+typedef uint64_t (*StructuralMaskFn)(const char *block);
+
+// Walks structural characters 64 bytes at a time (TDM_SIMD=scalar|sse2|avx2)
+typedef struct
+{
+    const char *block; // Start of the block that mask describes
+    const char *end;
+    uint64_t mask; // Structural positions not consumed yet
+} StructuralScanner;
+
+StructuralMaskFn structural_mask = NULL;
+const char *structural_kernel_name = "scalar";
+
+// ASCII case-insensitive substring search over a counted haystack, like strcasestr
+typedef const char *(*SubstringSearchFn)(const char *haystack, size_t haystack_len,
+                                         const char *needle, size_t needle_len);
+
+SubstringSearchFn substring_search = NULL;
+const char *substring_kernel_name = "scalar";
+
+// Picked on first use: the popcnt instruction when the CPU has it
+size_t (*popcount_words)(const uint64_t *words, size_t count) = NULL;
+
+// Set TDM_SEARCH_INDEX=off to always search by brute force
+int use_search_index = 1;
+
+// One newline-aligned slice of the mapped file, parsed independently
+typedef struct
+{
+    char *begin;
+    char *end;
+    TestRecord *records;
+    int count;
+    int capacity;
+    int max_id;
+    LoadWarning *warnings;
+    int warning_count;
+    int warning_capacity;
+    int failed;
+    int offset; // First destination row in the database columns
+    StringDictionary *systems; // db dictionaries, or the chunk's own below
+    StringDictionary *types;
+    StringDictionary local_systems; // Point into the mapping, merged after parsing
+    StringDictionary local_types;
+    uint32_t *system_map; // Local code -> db code
+    uint32_t *type_map;
+} LoadChunk;
+
+// One contiguous row range of a parallel save, written at its own file offset
+typedef struct
+{
+    int first;
+    int end;
+    int fd;
+    long long offset; // Where the range starts in the file
+    size_t size;      // Bytes the range renders to
+    const char (*result_fields)[16];
+    const size_t *result_lengths;
+    int failed;
+} SaveChunk;
+
 // Function declarations
 // File management
 int scan_csv_files(char files[][MAX_PATH]);
 int validate_csv_header(const char *filename);
 int create_new_csv(const char *filename);
 int load_database(const char *filename);
+int load_database_mapped(const char *filename);
+int load_database_buffered(const char *filename);
+int split_csv_fields(char *line, char *fields[], int max_fields);
+int split_journal_fields(char *line, char *fields[], int max_fields);
+int parse_record_line(char *line, TestRecord *record, const char **bad_result);
+int fill_record_fields(TestRecord *record, char *fields[], int field_count,
+                       StringDictionary *systems, StringDictionary *types, const char **bad_result);
+void init_structural_scanner(void);
+uint64_t structural_mask_scalar(const char *block);
+void scanner_init(StructuralScanner *scanner, const char *begin, const char *end);
+const char *scanner_next(StructuralScanner *scanner);
+char *scan_record_fields(StructuralScanner *scanner, char *line, char *fields[], int *field_count);
+int parse_load_chunk(LoadChunk *chunk);
+void *load_chunk_worker(void *arg);
+void *stitch_chunk_worker(void *arg);
+uint32_t *merge_chunk_dictionary(StringDictionary *dest, const StringDictionary *local);
+void run_chunk_workers(void *chunks, size_t chunk_size, int chunk_count, void *(*worker)(void *));
+int get_load_thread_count(size_t size);
 int save_database(void);
+int write_database_csv(const char *path);
+size_t serialize_row(char *out, int row, const char result_fields[][16], const size_t *result_lengths);
+int write_fully(int fd, const char *data, size_t size);
+int get_save_thread_count(int rows);
+int pwrite_fully(int fd, const char *data, size_t size, long long offset);
+void *size_save_chunk_worker(void *arg);
+void *write_save_chunk_worker(void *arg);
+int write_rows_parallel(int fd, long long offset, int thread_count, const char result_fields[][16],
+                        const size_t *result_lengths);
+
+// Binary snapshots
+int is_snapshot_file(const char *filename);
+uint64_t snapshot_checksum(const void *data, size_t size);
+int write_database_snapshot(const char *path);
+char *map_snapshot_file(const char *filename, size_t *size);
+void unmap_snapshot_file(char *data, size_t size);
+int snapshot_section_ok(const SnapshotHeader *header, int section, uint64_t expected_size, size_t file_size);
+int validate_snapshot(const char *data, size_t size);
+int load_database_snapshot(const char *filename);
+int database_own_columns(void);
+
+// Compressed archives
+int is_archive_file(const char *filename);
+int is_binary_database_file(const char *filename);
+int replace_file_contents(const char *path, const void *data, size_t size);
+void archive_put_byte(ArchiveBuffer *buffer, unsigned char byte);
+void archive_put_bytes(ArchiveBuffer *buffer, const void *data, size_t size);
+void archive_put_varint(ArchiveBuffer *buffer, uint64_t value);
+void archive_put_bits(ArchiveBuffer *buffer, uint32_t value, int bits);
+void archive_flush_bits(ArchiveBuffer *buffer);
+uint64_t archive_get_varint(ArchiveReader *reader);
+uint32_t archive_get_bits(ArchiveReader *reader, int bits);
+int archive_code_bits(uint32_t count);
+int write_database_archive(const char *path);
+int load_database_archive(const char *filename);
+
+// Write-ahead journal
+void journal_path(char *path, size_t size, const char *filename);
+int journal_csv_stamp(const char *filename, long long *size, long long *mtime);
+int journal_append(char op, int index, const TestRecord *record);
+int journal_apply_line(char *line);
+long journal_read_line(FILE *file, char **line, size_t *capacity);
+int journal_replay(void);
+void journal_close(void);
+int truncate_file(const char *path, long size);
+int sync_file(FILE *file);
+int sync_directory(const char *path);
+int journal_sync(void);
+int journal_sync_due(void);
+void database_begin_batch(void);
+int database_end_batch(void);
+DurabilityMode parse_durability_mode(const char *name);
+int database_checkpoint(void);
+void journal_maybe_checkpoint(void);
+int database_insert_record(const TestRecord *record);
+int database_update_record(int index, const TestRecord *record);
+int database_set_active(int index, int active);
+int database_purge_record(int index);
+
+// Record storage
+int database_reserve(int min_capacity);
+TestRecord database_get_record(int index);
+void database_set_record(int index, const TestRecord *record);
+int database_append_record(const TestRecord *record);
+void database_remove_record(int index);
+char *database_store_string(const char *str, size_t len);
+void database_reset(void);
+int rowset_init(RowSet *set, int capacity);
+void rowset_free(RowSet *set);
+int rowset_select(RowSet *set, int active);
+
+// Active/deleted bitmap
+int database_is_active(int index);
+void database_mark_active(int index, int active);
+void bitmap_remove_bit(uint64_t *words, size_t index, size_t count);
+size_t bitmap_popcount_portable(const uint64_t *words, size_t count);
+size_t bitmap_popcount(const uint64_t *words, size_t count);
+int database_count_active(void);
+int database_count_deleted(void);
+int database_next_row(int from, int active);
+
+// TestID index
+uint32_t id_index_home(int test_id, uint32_t slot_count);
+int id_index_build(void);
+int id_index_sync(void);
+int id_index_lookup(int test_id);
+int id_index_insert(int test_id, int row);
+void id_index_set(int test_id, int row);
+void id_index_erase(int test_id);
+void id_index_remove_row(int index, int removed_id);
+int id_index_grow_direct(int test_id);
+int id_index_grow_slots(void);
+void id_index_free(void);
+
+// Substring search
+unsigned char fold_ascii(unsigned char c);
+int equal_fold_ascii(const char *a, const char *b, size_t len);
+const char *substring_search_scalar(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len);
+void init_substring_search(void);
+const char *find_substring_ci(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len);
+int contains_ci(const char *text, const char *term);
+
+// Statistics
+int stats_reserve(uint32_t systems, uint32_t types);
+void stats_apply(const TestRecord *record, int delta);
+int stats_rebuild(void);
+int stats_ensure(void);
+void stats_free(void);
+int stats_system_total(uint32_t code);
+int stats_system_share(const void *a, const void *b);
+int stats_type_share(const void *a, const void *b);
+void print_statistics(void);
+void display_statistics(void);
+
+// Trigram search index
+uint32_t trigram_key(const char *text);
+uint32_t trigram_slot(const TrigramIndex *index, uint32_t key);
+Posting *trigram_find(const TrigramIndex *index, uint32_t key);
+int trigram_add(TrigramIndex *index, uint32_t key, uint32_t id);
+int trigram_add_text(TrigramIndex *index, const char *text, size_t len, uint32_t id);
+int trigram_sync_dictionary(TrigramIndex *index, const StringDictionary *dict);
+int trigram_sync_ids(void);
+void trigram_remove_row(TrigramIndex *index, uint32_t row);
+int trigram_candidates(const TrigramIndex *index, const char *term, uint32_t **ids, uint32_t *count);
+void trigram_free(TrigramIndex *index);
+int test_id_length(int test_id);
+int format_test_id(int test_id, char *buffer);
+int search_matching_rows(const char *term, RowSet *results);
+
+// Filter queries
+int query_eval_and(const QueryNode *node, int row);
+int query_eval_or(const QueryNode *node, int row);
+int query_eval_not(const QueryNode *node, int row);
+int query_eval_system(const QueryNode *node, int row);
+int query_eval_type(const QueryNode *node, int row);
+int query_eval_result(const QueryNode *node, int row);
+int query_eval_id(const QueryNode *node, int row);
+int query_eval_active(const QueryNode *node, int row);
+int query_eval_deleted(const QueryNode *node, int row);
+QueryNode *query_node(QueryPredicate eval, QueryNode *left, QueryNode *right);
+void query_free(QueryNode *node);
+QueryNode *query_fail(QueryParser *parser, const char *message, QueryNode *partial);
+int query_next_token(QueryParser *parser);
+int query_token_is(const QueryParser *parser, const char *word);
+int query_parse_int(QueryParser *parser, int *value);
+int query_parse_values(QueryParser *parser, char values[][MAX_LINE], int max_values);
+QueryNode *query_parse_names(QueryParser *parser, const StringDictionary *dict, TrigramIndex *grams,
+                             QueryPredicate eval);
+QueryNode *query_parse_comparison(QueryParser *parser);
+QueryNode *query_parse_unary(QueryParser *parser);
+QueryNode *query_parse_and(QueryParser *parser);
+QueryNode *query_parse_or(QueryParser *parser);
+QueryNode *query_compile(const char *text, char *error, size_t error_size);
+int query_requires_active(const QueryNode *node);
+int query_select(const QueryNode *query, RowSet *results);
+
+// String dictionaries
+uint32_t dictionary_hash(const char *str, size_t len);
+uint32_t dictionary_find(const StringDictionary *dict, const char *str, size_t len);
+uint32_t dictionary_intern(StringDictionary *dict, const char *str, size_t len);
+void dictionary_free(StringDictionary *dict);
+uint8_t *dictionary_match(const StringDictionary *dict, TrigramIndex *grams, const char *term);
+const char *record_system_name(const TestRecord *record);
+const char *record_test_type(const TestRecord *record);
+TestRecord make_record(int test_id, const char *system_name, const char *test_type, TestResult result, int active);
 
 // Input validation
 int validate_system_name(const char *input);
@@ -80,12 +703,26 @@ void delete_record(int test_id, int soft_delete);
 void recovery_data(void);
 
 // Display functions
+void format_record_row(char *out, size_t size, const TestRecord *record, int index);
 void display_record(const TestRecord *record, int index);
-void display_records_paginated(TestRecord *records, int count, const char *title);
+void compose_records_page(const RowSet *set, int page);
+void display_records_paginated(const RowSet *set, const char *title);
 void display_welcome_message(void);
 void clear_screen(void);
 void pause_screen(void);
 
+// Terminal rendering
+int screen_ansi_enabled(void);
+void screen_size(int *rows, int *columns);
+int screen_text_width(const char *text);
+void screen_invalidate(void);
+void screen_begin(void);
+char *screen_line(void);
+void screen_add(const char *text);
+void screen_put(const char *text, size_t length);
+int screen_compose(const char *prompt, int terminal_rows, int terminal_columns);
+void screen_present(const char *prompt);
+
 // Utility functions
 const char *test_result_to_string(TestResult result);
 TestResult string_to_test_result(const char *str);
@@ -94,16 +731,93 @@ int get_next_test_id(void);
 int create_new_database_prompt(void);
 int enter_manual_path_prompt(void);
 
+// Benchmarks
+double now_ms(void);
+char *read_file_contents(const char *filename, size_t *size);
+long bench_tokenize_strtok(char *buffer, size_t size);
+long bench_tokenize_scanner(char *buffer, size_t size);
+void run_tokenizer_benchmark(void);
+void run_layout_benchmark(void);
+void run_journal_benchmark(void);
+int write_database_csv_stdio(const char *path);
+void run_save_benchmark(void);
+void run_snapshot_benchmark(void);
+void run_search_benchmark(void);
+void run_substring_benchmark(void);
+void run_screen_benchmark(void);
+void run_benchmarks(void);
+int bench_fill_database(int rows);
+int bench_compare_ms(const void *a, const void *b);
+int bench_case_load_csv(void);
+int bench_case_load_snapshot(void);
+int bench_case_load_archive(void);
+int bench_case_save_csv(void);
+int bench_case_save_snapshot(void);
+int bench_case_save_archive(void);
+int bench_case_find_record(void);
+int bench_case_search(void);
+int bench_case_query(void);
+int bench_case_stats(void);
+int bench_case_validators(void);
+long long parse_row_count(const char *text, char **end);
+int bench_parse_sizes(const char *text, int *sizes);
+int bench_main(int argc, char *argv[]);
+
+// Session metrics
+uint64_t now_ns(void);
+int metric_bucket(uint64_t ns);
+uint64_t metric_bucket_limit(int bucket);
+void metrics_record(MetricOp op, uint64_t start_ns);
+uint64_t metrics_percentile(const LatencyHistogram *histogram, double percentile);
+long long file_size_or_zero(const char *path);
+void print_metrics(void);
+void display_metrics(void);
+int write_metrics_json(const char *path);
+void write_metrics_json_at_exit(void);
+
+// Tracing
+int trace_enable(void);
+void trace_disable(void);
+void trace_record(const char *name, char phase);
+int write_trace_json(const char *path);
+void write_trace_at_exit(void);
+
+// Dataset generator
+uint64_t generator_random(uint64_t *state);
+uint64_t generator_threshold(double probability);
+int generator_parse_options(int argc, char *argv[], int first, GeneratorOptions *options);
+int generate_dataset(const char *path, const GeneratorOptions *options);
+int generate_main(int argc, char *argv[]);
+
 // Test functions
 void run_unit_tests(void);
 void run_e2e_tests(void);
 void test_input_validation(void);
 void test_crud_operations(void);
+Database *test_database_begin(const char *filename);
+void test_database_end(Database *original_db);
+void test_record_storage(void);
+void test_search(void);
+void test_persistence(void);
+void test_binary_formats(void);
+void test_statistics(void);
+void test_batch_mode(void);
+void test_instrumentation(void);
+void test_screen_renderer(void);
 void run_all_tests(void);
 
 // Memory management
 void cleanup_memory(void);
 
+// Batch mode
+FILE *diagnostic_stream(void);
+void print_usage(const char *program);
+int split_batch_line(char *line, char **fields, int max_fields);
+void batch_print_record(FILE *out, int row);
+int batch_execute(FILE *out, char **fields, int field_count, int line);
+int batch_run_script(FILE *out, FILE *script);
+int batch_main(int argc, char *argv[]);
+
 // Main menu functions
 void show_main_menu(void);
 int select_database(void);
@@ -113,20 +827,202 @@ int change_database(void);
 #ifdef _WIN32
 void clear_screen(void)
 {
-    system("cls");
+    TRACE_BEGIN("clear_screen");
+    screen_invalidate();
+    if (screen_ansi_enabled())
+        fputs(SCREEN_CLEAR, stdout);
+    else
+        system("cls"); // Consoles without virtual terminal support
+    TRACE_END("clear_screen");
 }
 #else
+// Goes out with the next flush instead of forking clear(1); nothing when
+// output is redirected or TERM=dumb
 void clear_screen(void)
 {
-    system("clear");
+    TRACE_BEGIN("clear_screen");
+    screen_invalidate();
+    if (screen_ansi_enabled())
+        fputs(SCREEN_CLEAR, stdout);
+    TRACE_END("clear_screen");
 }
 #endif
 
 void pause_screen(void)
 {
     printf("\nPress Enter to continue...");
+    TRACE_BEGIN("wait_for_input");
     while (getchar() != '\n')
         ;
+    TRACE_END("wait_for_input");
+}
+
+#ifdef _WIN32
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+
+int screen_ansi_enabled(void)
+{
+    if (screen.ansi < 0)
+    {
+        // Windows 10 consoles take escape sequences once asked to
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+        screen.ansi = GetConsoleMode(console, &mode) &&
+                      SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+    return screen.ansi;
+}
+
+void screen_size(int *rows, int *columns)
+{
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    *rows = *columns = 0;
+    if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info))
+        return;
+    *rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+    *columns = info.srWindow.Right - info.srWindow.Left + 1;
+}
+#else
+int screen_ansi_enabled(void)
+{
+    if (screen.ansi < 0)
+    {
+        const char *term = getenv("TERM");
+        screen.ansi = isatty(STDOUT_FILENO) && term && *term && strcmp(term, "dumb") != 0;
+    }
+    return screen.ansi;
+}
+
+// Terminal height and width, 0 when unknown
+void screen_size(int *rows, int *columns)
+{
+    struct winsize size;
+    *rows = *columns = 0;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0)
+        return;
+    *rows = size.ws_row;
+    *columns = size.ws_col;
+}
+#endif
+
+// Columns text takes up, counting one per UTF-8 character; right for the
+// box drawing and Latin text of the listings
+int screen_text_width(const char *text)
+{
+    int width = 0;
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++)
+        width += (*p & 0xC0) != 0x80;
+    return width;
+}
+
+// Forces the next screen_present to redraw everything
+void screen_invalidate(void)
+{
+    screen.shown_valid = 0;
+}
+
+void screen_begin(void)
+{
+    screen.frames[!screen.shown].count = 0;
+}
+
+// Next line of the frame being composed, to be filled in with snprintf.
+// Past SCREEN_MAX_LINES the last line is reused
+char *screen_line(void)
+{
+    ScreenFrame *frame = &screen.frames[!screen.shown];
+    if (frame->count < SCREEN_MAX_LINES)
+        frame->count++;
+    frame->lines[frame->count - 1][0] = '\0';
+    return frame->lines[frame->count - 1];
+}
+
+void screen_add(const char *text)
+{
+    snprintf(screen_line(), SCREEN_LINE_SIZE, "%s", text);
+}
+
+void screen_put(const char *text, size_t length)
+{
+    size_t room = sizeof(screen.output) - screen.output_length;
+    if (length > room)
+        length = room;
+    memcpy(screen.output + screen.output_length, text, length);
+    screen.output_length += length;
+}
+
+// Renders the composed frame and the prompt under it into screen.output and
+// makes it the shown frame. Returns the number of frame lines written: all of
+// them after a clear, otherwise only those that changed
+int screen_compose(const char *prompt, int terminal_rows, int terminal_columns)
+{
+    ScreenFrame *next = &screen.frames[!screen.shown];
+    const ScreenFrame *shown = &screen.frames[screen.shown];
+    char prompt_line[SCREEN_LINE_SIZE];
+    snprintf(prompt_line, sizeof(prompt_line), "%s", prompt);
+    screen.output_length = 0;
+
+    int written = 0;
+    int ansi = screen_ansi_enabled();
+    // Lines are addressed by row, so each must take exactly one row: none may
+    // wrap, and nothing may have scrolled. The prompt sits on row count + 1 and
+    // the Enter that answers it moves to row count + 2
+    int wraps = terminal_columns > 0 && screen_text_width(prompt_line) >= terminal_columns;
+    for (int i = 0; !wraps && terminal_columns > 0 && i < next->count; i++)
+        wraps = screen_text_width(next->lines[i]) > terminal_columns;
+    int redraw = !ansi || !screen.shown_valid || wraps || shown->count != next->count ||
+                 terminal_rows != screen.shown_rows || terminal_columns != screen.shown_columns ||
+                 (terminal_rows > 0 && next->count + 2 > terminal_rows);
+    if (redraw)
+    {
+        if (ansi)
+            screen_put(SCREEN_CLEAR, strlen(SCREEN_CLEAR));
+        for (int i = 0; i < next->count; i++)
+        {
+            screen_put(next->lines[i], strlen(next->lines[i]));
+            screen_put("\n", 1);
+        }
+        screen_put(prompt_line, strlen(prompt_line));
+        written = next->count;
+    }
+    else
+    {
+        char move[32];
+        for (int i = 0; i < next->count; i++)
+        {
+            if (strcmp(next->lines[i], shown->lines[i]) == 0)
+                continue;
+            int length = snprintf(move, sizeof(move), "\x1b[%d;1H", i + 1);
+            screen_put(move, (size_t)length);
+            screen_put(next->lines[i], strlen(next->lines[i]));
+            screen_put("\x1b[K", 3); // Clear what the old line left to the right
+            written++;
+        }
+        // Rewrite the prompt and erase the input echoed below it
+        int length = snprintf(move, sizeof(move), "\x1b[%d;1H", next->count + 1);
+        screen_put(move, (size_t)length);
+        screen_put(prompt_line, strlen(prompt_line));
+        screen_put("\x1b[J", 3);
+    }
+
+    screen.shown = !screen.shown;
+    screen.shown_valid = ansi && !wraps; // A wrapped frame cannot be updated by row
+    screen.shown_rows = terminal_rows;
+    screen.shown_columns = terminal_columns;
+    return written;
+}
+
+void screen_present(const char *prompt)
+{
+    TRACE_BEGIN("render_screen");
+    int rows, columns;
+    screen_size(&rows, &columns);
+    screen_compose(prompt, rows, columns);
+    fflush(stdout); // Anything printed before goes first
+    write_fully(fileno(stdout), screen.output, screen.output_length);
+    TRACE_END("render_screen");
 }
 
 char *trim_string(char *str)
@@ -245,7 +1141,10 @@ int get_yes_no(const char *prompt, int default_answer, int max_attempts)
     do
     {
         printf("%s (y/n): ", prompt);
-        if (!fgets(input, sizeof(input), stdin))
+        TRACE_BEGIN("wait_for_input");
+        char *line = fgets(input, sizeof(input), stdin);
+        TRACE_END("wait_for_input");
+        if (!line)
         {
             attempts++;
             printf("Error reading input. Please try again.\n");
@@ -295,7 +1194,10 @@ int get_valid_input(char *buffer, int max_len, int (*validator)(const char *), c
     while (attempts < MAX_ATTEMPTS)
     {
         printf("%s: ", prompt);
-        if (!fgets(buffer, max_len, stdin))
+        TRACE_BEGIN("wait_for_input");
+        char *line = fgets(buffer, max_len, stdin);
+        TRACE_END("wait_for_input");
+        if (!line)
         {
             attempts++;
             printf("Error reading input. Please try again.\n");
@@ -312,7 +1214,10 @@ int get_valid_input(char *buffer, int max_len, int (*validator)(const char *), c
             continue;
         }
 
-        if (validator != NULL && !validator(buffer))
+        TRACE_BEGIN("validate_input");
+        int valid = validator == NULL || validator(buffer);
+        TRACE_END("validate_input");
+        if (!valid)
         {
             attempts++;
             printf("Invalid input format. Please try again.\n");
@@ -336,7 +1241,10 @@ int get_menu_choice(int min, int max)
     while (attempts < MAX_ATTEMPTS)
     {
         printf("Enter your choice (%d-%d): ", min, max);
-        if (!fgets(input, sizeof(input), stdin))
+        TRACE_BEGIN("wait_for_input");
+        char *line = fgets(input, sizeof(input), stdin);
+        TRACE_END("wait_for_input");
+        if (!line)
         {
             attempts++;
             continue;
@@ -365,22 +1273,25 @@ int scan_csv_files(char files[][MAX_PATH])
     HANDLE hFind;
     int count = 0;
 
-    hFind = FindFirstFile("*.csv", &findFileData);
-    if (hFind == INVALID_HANDLE_VALUE)
-    {
-        return 0;
-    }
+    const char *patterns[] = {"*.csv", "*" SNAPSHOT_SUFFIX, "*" ARCHIVE_SUFFIX};
 
-    do
+    for (int i = 0; i < 3 && count < MAX_FILES; i++)
     {
-        if (count < MAX_FILES)
+        hFind = FindFirstFile(patterns[i], &findFileData);
+        if (hFind == INVALID_HANDLE_VALUE)
+            continue;
+
+        do
         {
-            strcpy(files[count], findFileData.cFileName);
-            count++;
-        }
-    } while (FindNextFile(hFind, &findFileData) != 0 && count < MAX_FILES);
+            if (count < MAX_FILES)
+            {
+                strcpy(files[count], findFileData.cFileName);
+                count++;
+            }
+        } while (FindNextFile(hFind, &findFileData) != 0 && count < MAX_FILES);
 
-    FindClose(hFind);
+        FindClose(hFind);
+    }
     return count;
 }
 #else
@@ -397,7 +1308,7 @@ int scan_csv_files(char files[][MAX_PATH])
     while ((entry = readdir(dir)) != NULL && count < MAX_FILES)
     {
         char *ext = strrchr(entry->d_name, '.');
-        if (ext && strcmp(ext, ".csv") == 0)
+        if (ext && (strcmp(ext, ".csv") == 0 || strcmp(ext, SNAPSHOT_SUFFIX) == 0 || strcmp(ext, ARCHIVE_SUFFIX) == 0))
         {
             strcpy(files[count], entry->d_name);
             count++;
@@ -460,8 +1371,13 @@ int create_new_csv(const char *filename)
     fprintf(file, "%s\n", REQUIRED_HEADER);
     fclose(file);
 
+    // A journal left behind by an earlier file of the same name does not apply
+    char journal[MAX_PATH + sizeof(JOURNAL_SUFFIX)];
+    journal_path(journal, sizeof(journal), full_filename);
+    remove(journal);
+
+    database_reset();
     strcpy(db.filename, full_filename);
-    db.count = 0;
     db.next_id = 1;
 
     return 1;
@@ -488,1176 +1404,5382 @@ TestResult string_to_test_result(const char *str)
 {
     if (!str)
         return INVALID_RESULT;
-    if (strcasecmp(str, "Failed") == 0)
-        return FAILED;
-    if (strcasecmp(str, "Passed") == 0)
-        return PASSED;
-    if (strcasecmp(str, "Pending") == 0)
-        return PENDING;
-    if (strcasecmp(str, "Success") == 0)
-        return SUCCESS;
-    return INVALID_RESULT;
+
+    // Dispatch on the first letter so the loader compares at most twice
+    switch (tolower((unsigned char)str[0]))
+    {
+    case 'f':
+        return strcasecmp(str, "Failed") == 0 ? FAILED : INVALID_RESULT;
+    case 'p':
+        if (strcasecmp(str, "Passed") == 0)
+            return PASSED;
+        return strcasecmp(str, "Pending") == 0 ? PENDING : INVALID_RESULT;
+    case 's':
+        return strcasecmp(str, "Success") == 0 ? SUCCESS : INVALID_RESULT;
+    default:
+        return INVALID_RESULT;
+    }
 }
 
-int load_database(const char *filename)
+int database_reserve(int min_capacity)
 {
-    FILE *file = fopen(filename, "r");
-    if (!file)
+    if (min_capacity <= db.capacity)
+        return 1;
+    if (db.columns_mapped && !database_own_columns())
         return 0;
 
-    char line[MAX_LINE];
-    int count = 0;
-    int max_id = 0;
-
-    // Skip header
-    if (!fgets(line, sizeof(line), file))
-    {
-        fclose(file);
+    // Double until large enough so appends stay amortised O(1)
+    size_t new_capacity = db.capacity > 0 ? (size_t)db.capacity : INITIAL_CAPACITY;
+    while (new_capacity < (size_t)min_capacity)
+        new_capacity *= 2;
+    if (new_capacity > INT_MAX)
+        new_capacity = INT_MAX;
+
+    // Each column is swapped in as soon as it grows, so a failure part way
+    // through leaves every column at least db.capacity long
+    int *test_ids = realloc(db.test_ids, new_capacity * sizeof(int));
+    if (!test_ids)
         return 0;
-    }
-
-    memset(&db, 0, sizeof(db));
-
-    // Read records
-    while (fgets(line, sizeof(line), file) && count < MAX_RECORDS)
-    {
-        line[strcspn(line, "\n\r")] = '\0';
-
-        char *token = strtok(line, ",");
-        if (!token)
-            continue;
+    db.test_ids = test_ids;
 
-        TestRecord *record = &db.records[count];
-
-        if (atoi(token) > 0)
-            record->test_id = atoi(token);
-        else
-            continue;
-
-        if (record->test_id > max_id)
-        {
-            max_id = record->test_id;
-        }
-
-        token = strtok(NULL, ",");
-        if (token)
-        {
-            strncpy(record->system_name, token, sizeof(record->system_name) - 1);
-            record->system_name[sizeof(record->system_name) - 1] = '\0';
-        }
-
-        token = strtok(NULL, ",");
-        if (token)
-        {
-            strncpy(record->test_type, token, sizeof(record->test_type) - 1);
-            record->test_type[sizeof(record->test_type) - 1] = '\0';
-        }
-
-        token = strtok(NULL, ",");
-        if (token)
-        {
-            TestResult result = string_to_test_result(token);
-            if (result == INVALID_RESULT)
-            {
-                printf("Warning: Invalid test result '%s' in record %d, defaulting to PENDING\n", token, record->test_id);
-                record->test_result = PENDING;
-            }
-            else
-            {
-                record->test_result = result;
-            }
-        }
+    uint32_t *system_codes = realloc(db.system_codes, new_capacity * sizeof(uint32_t));
+    if (!system_codes)
+        return 0;
+    db.system_codes = system_codes;
 
-        token = strtok(NULL, ",");
-        if (token)
-        {
-            char *endptr;
-            long val = strtol(token, &endptr, 10);
-            if (*endptr == '\0')
-            {
-                record->active = (int)val;
-            }
-            else
-            {
-                record->active = 0;
-            }
-        }
+    uint32_t *type_codes = realloc(db.type_codes, new_capacity * sizeof(uint32_t));
+    if (!type_codes)
+        return 0;
+    db.type_codes = type_codes;
 
-        count++;
-    }
+    int8_t *results = realloc(db.results, new_capacity * sizeof(int8_t));
+    if (!results)
+        return 0;
+    db.results = results;
 
-    fclose(file);
-    db.count = count;
-    db.next_id = max_id + 1;
-    strcpy(db.filename, filename);
+    size_t old_words = ((size_t)db.capacity + 63) / 64;
+    size_t new_words = (new_capacity + 63) / 64;
+    uint64_t *active_bits = realloc(db.active_bits, new_words * sizeof(uint64_t));
+    if (!active_bits)
+        return 0;
+    memset(active_bits + old_words, 0, (new_words - old_words) * sizeof(uint64_t));
+    db.active_bits = active_bits;
 
+    db.capacity = (int)new_capacity;
     return 1;
 }
 
-int save_database(void)
+TestRecord database_get_record(int index)
 {
-    FILE *file = fopen(db.filename, "w");
-    if (!file)
-        return 0;
+    TestRecord record;
+    record.test_id = db.test_ids[index];
+    record.system_code = db.system_codes[index];
+    record.type_code = db.type_codes[index];
+    record.test_result = db.results[index];
+    record.active = (uint8_t)database_is_active(index);
+    return record;
+}
 
-    fprintf(file, "%s\n", REQUIRED_HEADER);
+void database_set_record(int index, const TestRecord *record)
+{
+    // Changing an indexed row's ID is rare enough to just rebuild on the next lookup
+    if (index < db.ids.rows && db.test_ids[index] != record->test_id)
+        db.ids.rows = 0;
+    if ((uint32_t)index < db.id_grams.indexed && db.test_ids[index] != record->test_id)
+        db.id_grams.indexed = 0;
+    db.test_ids[index] = record->test_id;
+    db.system_codes[index] = record->system_code;
+    db.type_codes[index] = record->type_code;
+    db.results[index] = record->test_result;
+    database_mark_active(index, record->active);
+}
 
-    for (int i = 0; i < db.count; i++)
-    {
-        TestRecord *record = &db.records[i];
-        fprintf(file, "%d,%s,%s,%s,%d\n",
-                record->test_id,
-                record->system_name,
-                record->test_type,
-                test_result_to_string(record->test_result),
-                record->active);
-    }
+int database_append_record(const TestRecord *record)
+{
+    if (!database_reserve(db.count + 1))
+        return 0;
 
-    fclose(file);
+    database_set_record(db.count++, record);
     return 1;
 }
 
-void display_welcome_message(void)
+void database_remove_record(int index)
 {
-    clear_screen();
-    printf("╔══════════════════════════════════════════════════════════════╗\n");
-    printf("║                    SYSTEM TESTING DATA MANAGER               ║\n");
-    printf("║                     ระบบจัดการข้อมูลการทดสอบระบบ                ║\n");
-    printf("╠══════════════════════════════════════════════════════════════╣\n");
-    printf("║ Current Database: %-42s ║\n", db.filename);
-    printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+    int removed_id = db.test_ids[index];
+    size_t tail = (size_t)(db.count - index - 1);
+    memmove(db.test_ids + index, db.test_ids + index + 1, tail * sizeof(int));
+    memmove(db.system_codes + index, db.system_codes + index + 1, tail * sizeof(uint32_t));
+    memmove(db.type_codes + index, db.type_codes + index + 1, tail * sizeof(uint32_t));
+    memmove(db.results + index, db.results + index + 1, tail * sizeof(int8_t));
+    bitmap_remove_bit(db.active_bits, (size_t)index, (size_t)db.count);
+    db.count--;
+    id_index_remove_row(index, removed_id);
+    trigram_remove_row(&db.id_grams, (uint32_t)index);
 }
 
-void display_record(const TestRecord *record, int index)
+int database_is_active(int index)
 {
-    if (!record)
-        return;
+    return (int)(db.active_bits[index >> 6] >> (index & 63)) & 1;
+}
 
-    printf("│ %-3d │ %-6d │ %-30s │ %-25s │ %-8s │ %-7s │\n",
-           index + 1,
-           record->test_id,
-           record->system_name,
-           record->test_type,
-           test_result_to_string(record->test_result),
-           record->active ? "Active" : "Deleted");
+void database_mark_active(int index, int active)
+{
+    uint64_t bit = 1ULL << (index & 63);
+    if (active)
+        db.active_bits[index >> 6] |= bit;
+    else
+        db.active_bits[index >> 6] &= ~bit;
 }
 
-void display_records_paginated(TestRecord *records, int count, const char *title)
+// Shifts bits [index + 1, count) down by one, dropping bit index
+void bitmap_remove_bit(uint64_t *words, size_t index, size_t count)
 {
-    if (count == 0)
+    size_t word = index / 64;
+    size_t last = (count + 63) / 64;
+    uint64_t low = words[word] & ((1ULL << (index % 64)) - 1);
+    uint64_t high = (words[word] >> (index % 64)) >> 1 << (index % 64);
+    words[word] = low | high;
+    for (; word + 1 < last; word++)
     {
-        printf("No records found.\n");
-        return;
+        words[word] |= words[word + 1] << 63;
+        words[word + 1] >>= 1;
     }
-    if (count > PAGINATION_SIZE)
-    {
-        if (!get_yes_no("Large dataset detected. Display all?", 1, 1))
-        {
-            // Paginated display
-            int page = 0;
-            int total_pages = (count + PAGINATION_SIZE - 1) / PAGINATION_SIZE;
-
-            while (1)
-            {
-                clear_screen();
-                printf("┌─────┬────────┬────────────────────────────────┬───────────────────────────┬──────────┬─────────┐\n");
-                printf("│ No. │ TestID │ SystemName                     │ TestType                  │ Result   │ Status  │\n");
-                printf("├─────┼────────┼────────────────────────────────┼───────────────────────────┼──────────┼─────────┤\n");
-                int start = page * PAGINATION_SIZE;
-                int end = (start + PAGINATION_SIZE < count) ? start + PAGINATION_SIZE : count;
-
-                for (int i = start; i < end; i++)
-                {
-                    display_record(&records[i], i);
-                }
-
-                printf("└─────┴────────┴────────────────────────────────┴───────────────────────────┴──────────┴─────────┘\n");
-                printf("Page %d of %d | (p)revious (n)ext (q)uit: ", page + 1, total_pages);
-
-                char nav[10];
-                fgets(nav, sizeof(nav), stdin);
+}
 
-                if (nav[0] == 'q' || nav[0] == 'Q')
-                    break;
-                if (nav[0] == 'n' || nav[0] == 'N')
-                {
-                    page = (page + 1) % total_pages;
-                }
-                if (nav[0] == 'p' || nav[0] == 'P')
-                {
-                    page = (page - 1 + total_pages) % total_pages;
-                }
-                if (nav[0] == '\n')
-                {
-                    page = (page + 1) % total_pages;
-                }
-            }
-            return;
-        }
-        clear_screen();
-    }
-    clear_screen();
-    printf("\n%s (Total: %d records)\n", title, count);
-    printf("┌─────┬────────┬────────────────────────────────┬───────────────────────────┬──────────┬─────────┐\n");
-    printf("│ No. │ TestID │ SystemName                     │ TestType                  │ Result   │ Status  │\n");
-    printf("├─────┼────────┼────────────────────────────────┼───────────────────────────┼──────────┼─────────┤\n");
+size_t bitmap_popcount_portable(const uint64_t *words, size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+        total += (size_t)__builtin_popcountll(words[i]);
+    return total;
+}
 
-    // Display all records
-    for (int i = 0; i < count; i++)
-    {
-        display_record(&records[i], i);
-    }
-    printf("└─────┴────────┴────────────────────────────────┴───────────────────────────┴──────────┴─────────┘\n");
+#ifdef HAVE_X86_SIMD
+__attribute__((target("popcnt")))
+size_t bitmap_popcount_hardware(const uint64_t *words, size_t count)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+        total += (size_t)__builtin_popcountll(words[i]);
+    return total;
 }
+#endif
 
-int find_record_by_id(int test_id)
+size_t bitmap_popcount(const uint64_t *words, size_t count)
 {
-    for (int i = 0; i < db.count; i++)
+    if (!popcount_words)
     {
-        if (db.records[i].test_id == test_id)
-        {
-            return i;
-        }
+        popcount_words = bitmap_popcount_portable;
+#ifdef HAVE_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("popcnt"))
+            popcount_words = bitmap_popcount_hardware;
+#endif
     }
-    return -1;
+    return popcount_words(words, count);
 }
 
-int get_next_test_id(void)
+int database_count_active(void)
 {
-    return db.next_id++;
+    return (int)bitmap_popcount(db.active_bits, ((size_t)db.count + 63) / 64);
 }
 
-void list_all_records(void)
+int database_count_deleted(void)
 {
-    clear_screen();
-    printf("LIST ALL ACTIVE RECORDS\n");
-    printf("========================\n");
-
-    // Filter active records
-    TestRecord *active_records = malloc(db.count * sizeof(TestRecord));
-    if (active_records == NULL)
-    {
-        fprintf(stderr, "Error: Unable to allocate memory for active records.\n");
-        pause_screen();
-        return;
-    }
-    int active_count = 0;
+    return db.count - database_count_active();
+}
 
-    for (int i = 0; i < db.count; i++)
+// First row at or after from whose state is active (1) or deleted (0), or -1
+int database_next_row(int from, int active)
+{
+    if (from >= db.count)
+        return -1;
+
+    size_t words = ((size_t)db.count + 63) / 64;
+    size_t w = (size_t)from / 64;
+    uint64_t flip = active ? 0 : ~0ULL; // Deleted rows are the zero bits
+    uint64_t word = (db.active_bits[w] ^ flip) & (~0ULL << (from % 64));
+    while (!word)
     {
-        if (db.records[i].active)
-        {
-            active_records[active_count++] = db.records[i];
-        }
+        if (++w >= words)
+            return -1;
+        word = db.active_bits[w] ^ flip;
     }
 
-    display_records_paginated(active_records, active_count, "Active Records");
-    free(active_records);
-    pause_screen();
+    size_t row = w * 64 + (size_t)__builtin_ctzll(word);
+    return row < (size_t)db.count ? (int)row : -1;
 }
 
-void add_new_record(void)
+// Fills set with every active (1) or deleted (0) row, sized from the popcount
+int rowset_select(RowSet *set, int active)
 {
-    clear_screen();
-    printf("ADD NEW RECORD\n");
-    printf("==============\n");
-
-    if (db.count >= MAX_RECORDS)
-    {
-        printf("Database is full. Cannot add new records.\n");
-        pause_screen();
-        return;
-    }
+    int matching = active ? database_count_active() : database_count_deleted();
+    if (!rowset_init(set, matching))
+        return 0;
 
-    TestRecord new_record = {0};
-    new_record.test_id = get_next_test_id();
-    new_record.active = 1;
+    for (int row = database_next_row(0, active); row >= 0; row = database_next_row(row + 1, active))
+        set->rows[set->count++] = (uint32_t)row;
+    return 1;
+}
 
-    char buffer[256];
+void stats_free(void)
+{
+    free(db.stats.system_results);
+    free(db.stats.type_counts);
+    memset(&db.stats, 0, sizeof(db.stats));
+}
 
-    // Get System Name
-    if (!get_valid_input(buffer, sizeof(buffer), validate_system_name,
-                         "Enter System Name (min 3 chars, alphanumeric + ()[]- allowed)"))
+// Grows the per-code arrays (zero-filled) to cover the dictionaries
+int stats_reserve(uint32_t systems, uint32_t types)
+{
+    if (systems > db.stats.system_capacity)
     {
-        return;
+        uint32_t capacity = db.stats.system_capacity > 0 ? db.stats.system_capacity : 16;
+        while (capacity < systems)
+            capacity *= 2;
+        int *grown = realloc(db.stats.system_results, (size_t)capacity * (SUCCESS + 1) * sizeof(int));
+        if (!grown)
+            return 0;
+        memset(grown + (size_t)db.stats.system_capacity * (SUCCESS + 1), 0,
+               (size_t)(capacity - db.stats.system_capacity) * (SUCCESS + 1) * sizeof(int));
+        db.stats.system_results = grown;
+        db.stats.system_capacity = capacity;
     }
-    strcpy(new_record.system_name, trim_string(buffer));
 
-    // Get Test Type
-    if (!get_valid_input(buffer, sizeof(buffer), validate_test_type,
-                         "\nEnter Test Type (min 3 chars, alphanumeric only)"))
+    if (types > db.stats.type_capacity)
     {
-        return;
+        uint32_t capacity = db.stats.type_capacity > 0 ? db.stats.type_capacity : 16;
+        while (capacity < types)
+            capacity *= 2;
+        int *grown = realloc(db.stats.type_counts, (size_t)capacity * sizeof(int));
+        if (!grown)
+            return 0;
+        memset(grown + db.stats.type_capacity, 0, (size_t)(capacity - db.stats.type_capacity) * sizeof(int));
+        db.stats.type_counts = grown;
+        db.stats.type_capacity = capacity;
     }
-    strcpy(new_record.test_type, trim_string(buffer));
-
-    // Get Test Result
-    printf("\nSelect Test Result:\n");
-    printf("1. Pending\n");
-    printf("2. Failed\n");
-    printf("3. Passed\n");
-    printf("4. Success\n");
+    return 1;
+}
 
-    int choice = get_menu_choice(1, 4);
-    if (choice == -1)
+// Adds (delta 1) or removes (delta -1) one row; deleted rows are not counted
+void stats_apply(const TestRecord *record, int delta)
+{
+    if (!db.stats.valid || !record->active)
         return;
-
-    switch (choice)
+    if (record->test_result < FAILED || record->test_result > SUCCESS ||
+        !stats_reserve(record->system_code + 1, record->type_code + 1))
     {
-    case 1:
-        new_record.test_result = PENDING;
-        break;
-    case 2:
-        new_record.test_result = FAILED;
-        break;
-    case 3:
-        new_record.test_result = PASSED;
-        break;
-    case 4:
-        new_record.test_result = SUCCESS;
-        break;
+        db.stats.valid = 0; // Recount on the next read instead
+        return;
     }
 
-    // Add record to database
-    db.records[db.count++] = new_record;
+    db.stats.by_result[record->test_result] += delta;
+    db.stats.system_results[(size_t)record->system_code * (SUCCESS + 1) + record->test_result] += delta;
+    db.stats.type_counts[record->type_code] += delta;
+}
 
-    if (save_database())
+// One pass over the columns; load_database calls this once rows are in
+int stats_rebuild(void)
+{
+    stats_free();
+    if (!stats_reserve(db.systems.count, db.types.count))
     {
-        printf("\n✓ Record added successfully! (TestID: %d)\n", new_record.test_id);
-        printf("1 record added to database.\n");
+        stats_free();
+        return 0;
     }
-    else
+
+    for (int row = database_next_row(0, 1); row >= 0; row = database_next_row(row + 1, 1))
     {
-        printf("✗ Error saving to database.\n");
-        db.count--; // Rollback
+        int result = db.results[row];
+        if (result < FAILED || result > SUCCESS)
+            continue;
+        db.stats.by_result[result]++;
+        db.stats.system_results[(size_t)db.system_codes[row] * (SUCCESS + 1) + result]++;
+        db.stats.type_counts[db.type_codes[row]]++;
     }
+    db.stats.valid = 1;
+    return 1;
+}
 
-    pause_screen();
+// Current counts, recounting only if a mutation could not be applied
+int stats_ensure(void)
+{
+    return db.stats.valid || stats_rebuild();
 }
 
-void search_records(void)
+int stats_system_total(uint32_t code)
 {
-    clear_screen();
-    printf("SEARCH RECORDS\n");
-    printf("==============\n");
+    const int *counts = db.stats.system_results + (size_t)code * (SUCCESS + 1);
+    return counts[FAILED] + counts[PASSED] + counts[PENDING] + counts[SUCCESS];
+}
+
+// qsort orders: most records first, then by name
+int stats_system_share(const void *a, const void *b)
+{
+    uint32_t left = *(const uint32_t *)a;
+    uint32_t right = *(const uint32_t *)b;
+    int diff = stats_system_total(right) - stats_system_total(left);
+    return diff ? diff : strcmp(db.systems.strings[left], db.systems.strings[right]);
+}
+
+int stats_type_share(const void *a, const void *b)
+{
+    uint32_t left = *(const uint32_t *)a;
+    uint32_t right = *(const uint32_t *)b;
+    int diff = db.stats.type_counts[right] - db.stats.type_counts[left];
+    return diff ? diff : strcmp(db.types.strings[left], db.types.strings[right]);
+}
 
-    char search_term[256];
-    if (!get_valid_input(search_term, sizeof(search_term), NULL,
-                         "Enter search term (min 3 characters)"))
+void print_statistics(void)
+{
+    if (!stats_ensure())
     {
+        printf("Error: Unable to allocate memory for statistics.\n");
         return;
     }
 
-    if (strlen(trim_string(search_term)) < 3)
+    int active = db.stats.by_result[FAILED] + db.stats.by_result[PASSED] +
+                 db.stats.by_result[PENDING] + db.stats.by_result[SUCCESS];
+    printf("Records: %d active, %d deleted\n\n", active, database_count_deleted());
+
+    printf("By TestResult\n");
+    printf("┌──────────┬──────────┬─────────┐\n");
+    printf("│ Result   │ Records  │ Share   │\n");
+    printf("├──────────┼──────────┼─────────┤\n");
+    const TestResult order[] = {PASSED, SUCCESS, FAILED, PENDING};
+    for (int i = 0; i < 4; i++)
     {
-        printf("Search term must be at least 3 characters.\n");
-        pause_screen();
-        return;
+        int count = db.stats.by_result[order[i]];
+        printf("│ %-8s │ %8d │ %6.1f%% │\n", test_result_to_string(order[i]), count,
+               active ? 100.0 * count / active : 0.0);
     }
+    printf("└──────────┴──────────┴─────────┘\n");
 
-    // Search in all fields
-    TestRecord *results = malloc(db.count * sizeof(TestRecord));
-    if (results == NULL && db.count > 0)
+    // Only the distinct names are sorted, never the rows
+    uint32_t group_count = db.systems.count > db.types.count ? db.systems.count : db.types.count;
+    uint32_t *codes = malloc((group_count + 1) * sizeof(uint32_t));
+    if (!codes)
     {
-        printf("Error: Unable to allocate memory for search results.\n");
-        pause_screen();
+        printf("Error: Unable to allocate memory for statistics.\n");
         return;
     }
-    int result_count = 0;
 
-    for (int i = 0; i < db.count; i++)
+    uint32_t shown = 0;
+    for (uint32_t code = 0; code < db.systems.count; code++)
     {
-        if (!db.records[i].active)
-            continue;
-
-        char id_str[20];
-        snprintf(id_str, sizeof(id_str), "%d", db.records[i].test_id);
-
-        if (strstr(id_str, search_term) ||
-            strcasestr(db.records[i].system_name, search_term) ||
-            strcasestr(db.records[i].test_type, search_term) ||
-            strcasestr(test_result_to_string(db.records[i].test_result), search_term))
-        {
-
-            results[result_count++] = db.records[i];
-        }
+        if (stats_system_total(code) > 0)
+            codes[shown++] = code;
     }
-
-    if (result_count == 0)
+    qsort(codes, shown, sizeof(uint32_t), stats_system_share);
+    printf("\nBy SystemName (%u with active records)\n", shown);
+    printf("┌────────────────────────────────┬──────────┬──────────┬──────────────┐\n");
+    printf("│ SystemName                     │ Records  │ Failed   │ Failure rate │\n");
+    printf("├────────────────────────────────┼──────────┼──────────┼──────────────┤\n");
+    for (uint32_t i = 0; i < shown && i < STATS_TOP_GROUPS; i++)
     {
-        printf("No records found matching '%s'.\n", search_term);
-        free(results);
-        pause_screen();
-        return;
+        int total = stats_system_total(codes[i]);
+        int failed = db.stats.system_results[(size_t)codes[i] * (SUCCESS + 1) + FAILED];
+        printf("│ %-30.30s │ %8d │ %8d │ %11.1f%% │\n", db.systems.strings[codes[i]], total, failed,
+               100.0 * failed / total);
     }
+    printf("└────────────────────────────────┴──────────┴──────────┴──────────────┘\n");
+    if (shown > STATS_TOP_GROUPS)
+        printf("... and %u more\n", shown - STATS_TOP_GROUPS);
 
-    display_records_paginated(results, result_count, "Search Results");
-
-    // Action menu for search results
-    printf("\nSelect an action:\n");
-    printf("1. Update a record\n");
-    printf("2. Delete a record\n");
-    printf("3. Return to main menu\n");
-
-    int action = get_menu_choice(1, 3);
-    if (action == -1 || action == 3)
+    shown = 0;
+    for (uint32_t code = 0; code < db.types.count; code++)
     {
-        free(results);
-        return;
+        if (db.stats.type_counts[code] > 0)
+            codes[shown++] = code;
     }
-
-    char input_buffer[20];
-    if (!get_valid_input(input_buffer, sizeof(input_buffer), validate_test_id, "Enter TestID from search results"))
+    qsort(codes, shown, sizeof(uint32_t), stats_type_share);
+    printf("\nBy TestType (%u with active records)\n", shown);
+    printf("┌───────────────────────────┬──────────┬─────────┐\n");
+    printf("│ TestType                  │ Records  │ Share   │\n");
+    printf("├───────────────────────────┼──────────┼─────────┤\n");
+    for (uint32_t i = 0; i < shown && i < STATS_TOP_GROUPS; i++)
     {
-        free(results);
-        return;
+        int count = db.stats.type_counts[codes[i]];
+        printf("│ %-25.25s │ %8d │ %6.1f%% │\n", db.types.strings[codes[i]], count, 100.0 * count / active);
     }
+    printf("└───────────────────────────┴──────────┴─────────┘\n");
+    if (shown > STATS_TOP_GROUPS)
+        printf("... and %u more\n", shown - STATS_TOP_GROUPS);
 
-    int test_id = atoi(trim_string(input_buffer));
+    free(codes);
+}
 
-    // Verify TestID is in search results
-    int found = 0;
-    for (int i = 0; i < result_count; i++)
+void display_statistics(void)
+{
+    clear_screen();
+    printf("STATISTICS\n");
+    printf("==========\n");
+    print_statistics();
+    pause_screen();
+}
+
+int metric_bucket(uint64_t ns)
+{
+    if (ns < METRIC_SUB_BUCKETS)
+        return (int)ns;
+    int shift = 63 - __builtin_clzll(ns) - 4; // Keeps the top five bits: 1 and the sub-bucket
+    return (shift + 1) * METRIC_SUB_BUCKETS + (int)((ns >> shift) & (METRIC_SUB_BUCKETS - 1));
+}
+
+// Largest value that lands in bucket
+uint64_t metric_bucket_limit(int bucket)
+{
+    if (bucket < METRIC_SUB_BUCKETS)
+        return (uint64_t)bucket;
+    int shift = bucket / METRIC_SUB_BUCKETS - 1;
+    uint64_t sub = (uint64_t)(bucket % METRIC_SUB_BUCKETS);
+    return ((METRIC_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void metrics_record(MetricOp op, uint64_t start_ns)
+{
+    uint64_t elapsed = now_ns() - start_ns;
+    LatencyHistogram *histogram = &metrics.ops[op];
+    histogram->calls++;
+    histogram->count++;
+    histogram->total_ns += elapsed;
+    if (elapsed > histogram->max_ns)
+        histogram->max_ns = elapsed;
+    histogram->buckets[metric_bucket(elapsed)]++;
+}
+
+// Upper edge of the bucket holding the given percentile, never above the maximum
+uint64_t metrics_percentile(const LatencyHistogram *histogram, double percentile)
+{
+    if (histogram->count == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)histogram->count + 0.999999);
+    rank = rank < 1 ? 1 : rank;
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < METRIC_BUCKETS; bucket++)
     {
-        if (results[i].test_id == test_id)
+        seen += histogram->buckets[bucket];
+        if (seen >= rank)
         {
-            found = 1;
-            break;
+            uint64_t limit = metric_bucket_limit(bucket);
+            return limit < histogram->max_ns ? limit : histogram->max_ns;
         }
     }
+    return histogram->max_ns;
+}
 
-    if (!found)
-    {
-        printf("TestID %d not found in search results.\n", test_id);
-        free(results);
-        pause_screen();
-        return;
-    }
-
-    free(results);
+long long file_size_or_zero(const char *path)
+{
+    long long size, mtime;
+    return journal_csv_stamp(path, &size, &mtime) ? size : 0;
+}
 
-    if (action == 1)
+void print_metrics(void)
+{
+    printf("┌────────────────────┬──────────┬────────────┬────────────┬────────────┬────────────┐\n");
+    printf("│ Operation          │ Count    │ p50        │ p90        │ p99        │ Max        │\n");
+    printf("├────────────────────┼──────────┼────────────┼────────────┼────────────┼────────────┤\n");
+    for (int op = 0; op < METRIC_OPS; op++)
     {
-        // Update record
-        int index = find_record_by_id(test_id);
-        if (index != -1)
+        const LatencyHistogram *histogram = &metrics.ops[op];
+        printf("│ %-18s │ %8llu │", metric_names[op], (unsigned long long)histogram->calls);
+        const uint64_t values[] = {metrics_percentile(histogram, 50), metrics_percentile(histogram, 90),
+                                   metrics_percentile(histogram, 99), histogram->max_ns};
+        for (int i = 0; i < 4; i++)
         {
-            clear_screen();
-            printf("--- Record to Update ---\n");
-            printf("TestID: %d\n", db.records[index].test_id);
-            printf("SystemName: %s\n", db.records[index].system_name);
-            printf("TestType: %s\n", db.records[index].test_type);
-            printf("TestResult: %s\n", test_result_to_string(db.records[index].test_result));
-
-            update_record_by_id(test_id);
+            // Microseconds below a millisecond, then milliseconds
+            if (histogram->count == 0)
+                printf(" %10s │", "-");
+            else if (values[i] < 1000000ULL)
+                printf(" %8.1fµs │", (double)values[i] / 1e3);
+            else
+                printf(" %8.1fms │", (double)values[i] / 1e6);
         }
+        printf("\n");
     }
-    else if (action == 2)
-    {
-        delete_record(test_id, 1);
-    }
+    printf("└────────────────────┴──────────┴────────────┴────────────┴────────────┴────────────┘\n");
+    printf("Bytes read: %llu, bytes written: %llu\n", (unsigned long long)metrics.bytes_read,
+           (unsigned long long)metrics.bytes_written);
+    printf("find_record_by_id times one call in %d; the others are counted only.\n", METRIC_LOOKUP_SAMPLE);
 }
 
-void update_record(void)
+void display_metrics(void)
 {
     clear_screen();
-    printf("UPDATE RECORD\n");
-    printf("==============\n");
-    char input_buffer[20];
-    if (!get_valid_input(input_buffer, sizeof(input_buffer), validate_test_id, "Enter TestID to update"))
-    {
-        return;
-    }
-    int test_id = atoi(trim_string(input_buffer));
+    printf("METRICS (this session)\n");
+    printf("======================\n");
+    print_metrics();
+    pause_screen();
+}
 
-    update_record_by_id(test_id);
-}
-
-void update_record_by_id(int test_id)
+// Times in nanoseconds; "-" writes to stdout
+int write_metrics_json(const char *path)
 {
-    int index = find_record_by_id(test_id);
-    if (index == -1 || !db.records[index].active)
+    int to_stdout = strcmp(path, "-") == 0;
+    FILE *out = to_stdout ? stdout : fopen(path, "w");
+    if (!out)
+        return 0;
+
+    fprintf(out, "{\n  \"unit\": \"ns\",\n  \"bytes_read\": %llu,\n  \"bytes_written\": %llu,\n  \"operations\": {",
+            (unsigned long long)metrics.bytes_read, (unsigned long long)metrics.bytes_written);
+    for (int op = 0; op < METRIC_OPS; op++)
     {
-        printf("Record not found or has been deleted.\n");
-        pause_screen();
-        return;
+        const LatencyHistogram *histogram = &metrics.ops[op];
+        fprintf(out,
+                "%s\n    \"%s\": {\"count\": %llu, \"timed\": %llu, \"mean\": %llu, \"p50\": %llu, \"p90\": %llu, "
+                "\"p99\": %llu, \"max\": %llu}",
+                op ? "," : "", metric_names[op], (unsigned long long)histogram->calls,
+                (unsigned long long)histogram->count,
+                (unsigned long long)(histogram->count ? histogram->total_ns / histogram->count : 0),
+                (unsigned long long)metrics_percentile(histogram, 50),
+                (unsigned long long)metrics_percentile(histogram, 90),
+                (unsigned long long)metrics_percentile(histogram, 99), (unsigned long long)histogram->max_ns);
     }
+    fprintf(out, "\n  }\n}\n");
+    return to_stdout ? fflush(out) == 0 : fclose(out) == 0;
+}
 
-    TestRecord *record = &db.records[index];
-    TestRecord backup = *record; // Backup for rollback
+void write_metrics_json_at_exit(void)
+{
+    if (metrics_json_path && !write_metrics_json(metrics_json_path))
+        fprintf(stderr, "error,0,unable to write %s\n", metrics_json_path);
+}
 
-    clear_screen();
-    printf("You are about to modify the following record:\n");
-    printf("┌────────┬────────────────────────────────┬───────────────────────────┬──────────┐\n");
-    printf("│ TestID │ SystemName                     │ TestType                  │ Result   │\n");
-    printf("├────────┼────────────────────────────────┼───────────────────────────┼──────────┤\n");
-    printf("│ %-6d │ %-30s │ %-25s │ %-8s │\n", record->test_id, record->system_name, record->test_type,
-           test_result_to_string(record->test_result));
-    printf("└────────┴────────────────────────────────┴───────────────────────────┴──────────┘\n");
+// Allocates the ring and opens the "session" span
+int trace_enable(void)
+{
+    trace_events = calloc(TRACE_CAPACITY, sizeof(TraceEvent));
+    if (!trace_events)
+        return 0;
+    trace_head = 0;
+    trace_start_ns = now_ns();
+    tracing = 1;
+    trace_record("session", 'B');
+    return 1;
+}
 
-    printf("\nSelect action:\n");
-    printf("1. Update record\n");
-    printf("2. Delete record\n");
-    printf("3. Return to menu\n");
+void trace_disable(void)
+{
+    tracing = 0;
+    free(trace_events);
+    trace_events = NULL;
+}
 
-    printf("\n");
+// Lock-free: each event claims its own slot with one atomic add
+void trace_record(const char *name, char phase)
+{
+    if (trace_thread_id == 0)
+        trace_thread_id = __atomic_add_fetch(&trace_next_thread, 1, __ATOMIC_RELAXED);
+    uint64_t slot = __atomic_fetch_add(&trace_head, 1, __ATOMIC_RELAXED);
+    TraceEvent *event = &trace_events[slot & (TRACE_CAPACITY - 1)];
+    event->name = name;
+    event->timestamp_ns = now_ns();
+    event->thread = trace_thread_id;
+    event->phase = phase;
+}
 
-    int action = get_menu_choice(1, 3);
-    if (action == -1 || action == 3)
-        return;
+// Writes the newest TRACE_CAPACITY events; open in Perfetto or chrome://tracing.
+// Call once the worker threads have finished.
+int write_trace_json(const char *path)
+{
+    FILE *out = fopen(path, "w");
+    if (!out)
+        return 0;
 
-    if (action == 2)
+    uint64_t head = trace_head;
+    uint64_t first = head > TRACE_CAPACITY ? head - TRACE_CAPACITY : 0;
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_events\": %llu}, \"traceEvents\": [\n",
+            (unsigned long long)first);
+    for (uint32_t thread = 1; thread <= trace_next_thread; thread++)
     {
-        delete_record(test_id, 1);
-        return;
+        fprintf(out, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": ", thread);
+        if (thread == 1)
+            fprintf(out, "\"main\"}},\n");
+        else
+            fprintf(out, "\"worker %u\"}},\n", thread - 1);
+    }
+    for (uint64_t i = first; i < head; i++)
+    {
+        const TraceEvent *event = &trace_events[i & (TRACE_CAPACITY - 1)];
+        fprintf(out, "{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %u}%s\n", event->name,
+                event->phase, (double)(event->timestamp_ns - trace_start_ns) / 1e3, event->thread,
+                i + 1 < head ? "," : "");
     }
+    fprintf(out, "]}\n");
+    return fclose(out) == 0;
+}
 
-    // Update mode
-    int changes_made = 0;
+void write_trace_at_exit(void)
+{
+    if (!tracing)
+        return;
+    trace_record("session", 'E');
+    if (!write_trace_json(trace_path))
+        fprintf(stderr, "error,0,unable to write %s\n", trace_path);
+    trace_disable();
+}
 
-    while (1)
+unsigned char fold_ascii(unsigned char c)
+{
+    return (unsigned char)(c - 'A') < 26 ? (unsigned char)(c | 0x20) : c;
+}
+
+int equal_fold_ascii(const char *a, const char *b, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
     {
-        clear_screen();
-        printf("--- Current Record (Unsaved) ---\n");
-        printf("┌────────┬────────────────────────────────┬───────────────────────────┬──────────┐\n");
-        printf("│ TestID │ SystemName                     │ TestType                  │ Result   │\n");
-        printf("├────────┼────────────────────────────────┼───────────────────────────┼──────────┤\n");
-        printf("│ %-6d │ %-30s │ %-25s │ %-8s │\n", record->test_id, record->system_name, record->test_type,
-               test_result_to_string(record->test_result));
-        printf("└────────┴────────────────────────────────┴───────────────────────────┴──────────┘\n");
+        if (fold_ascii((unsigned char)a[i]) != fold_ascii((unsigned char)b[i]))
+            return 0;
+    }
+    return 1;
+}
 
-        printf("\nSelect field to update:\n");
-        printf("1. SystemName\n");
-        printf("2. TestType\n");
-        printf("3. TestResult\n");
-        printf("\nOther Options:\n");
-        printf("4. Save changes\n");
-        printf("5. Cancel (discard changes)\n");
+const char *substring_search_scalar(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len)
+{
+    if (needle_len == 0)
+        return haystack;
+    if (needle_len > haystack_len)
+        return NULL;
 
-        printf("\n");
+    unsigned char first = fold_ascii((unsigned char)needle[0]);
+    unsigned char last = fold_ascii((unsigned char)needle[needle_len - 1]);
+    size_t middle = needle_len > 2 ? needle_len - 2 : 0;
+    for (size_t i = 0; i + needle_len <= haystack_len; i++)
+    {
+        if (fold_ascii((unsigned char)haystack[i]) == first &&
+            fold_ascii((unsigned char)haystack[i + needle_len - 1]) == last &&
+            equal_fold_ascii(haystack + i + 1, needle + 1, middle))
+            return haystack + i;
+    }
+    return NULL;
+}
 
-        int field_choice = get_menu_choice(1, 5);
-        if (field_choice == -1)
-            continue;
+// Candidates are positions whose first and last needle bytes both match.
+// OR-ing 0x20 folds case only when the needle byte is a letter, so the
+// filter is exact for those bytes and the middle is checked per candidate.
+#ifdef HAVE_X86_SIMD
+__attribute__((target("sse2")))
+const char *substring_search_sse2(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len)
+{
+    if (needle_len == 0)
+        return haystack;
+    if (needle_len > haystack_len)
+        return NULL;
 
-        if (field_choice == 5)
-        {
-            if (get_yes_no("Discard all changes?", 0, 1))
-            {
-                *record = backup; // Restore backup
-                printf("Changes discarded.\n");
-                pause_screen();
-                return;
-            }
-            continue;
-        }
+    unsigned char first = fold_ascii((unsigned char)needle[0]);
+    unsigned char last = fold_ascii((unsigned char)needle[needle_len - 1]);
+    const __m128i first_v = _mm_set1_epi8((char)first);
+    const __m128i last_v = _mm_set1_epi8((char)last);
+    const __m128i first_case = _mm_set1_epi8((unsigned char)(first - 'a') < 26 ? 0x20 : 0);
+    const __m128i last_case = _mm_set1_epi8((unsigned char)(last - 'a') < 26 ? 0x20 : 0);
+    size_t middle = needle_len > 2 ? needle_len - 2 : 0;
 
-        if (field_choice == 4)
+    size_t i = 0;
+    for (; i + needle_len - 1 + 16 <= haystack_len; i += 16)
+    {
+        __m128i head = _mm_loadu_si128((const __m128i *)(haystack + i));
+        __m128i tail = _mm_loadu_si128((const __m128i *)(haystack + i + needle_len - 1));
+        __m128i hit = _mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(head, first_case), first_v),
+                                    _mm_cmpeq_epi8(_mm_or_si128(tail, last_case), last_v));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(hit);
+        while (mask)
         {
-            if (save_database())
-            {
-                printf("✓ Record updated successfully!\n");
-                if (changes_made)
-                {
-                    printf("1 record updated in database.\n");
-                }
-                else
-                {
-                    printf("No changes were made.\n");
-                }
-            }
-            else
-            {
-                printf("✗ Error saving to database.\n");
-                *record = backup; // Restore backup
-            }
-            pause_screen();
-            return;
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (equal_fold_ascii(haystack + at + 1, needle + 1, middle))
+                return haystack + at;
+            mask &= mask - 1;
         }
+    }
+    return substring_search_scalar(haystack + i, haystack_len - i, needle, needle_len);
+}
 
-        char buffer[256];
-        switch (field_choice)
-        {
-        case 1: // SystemName
-            if (get_valid_input(buffer, sizeof(buffer), validate_system_name,
-                                "Enter new System Name"))
-            {
-                strcpy(record->system_name, trim_string(buffer));
-                changes_made = 1;
-                printf("✓ SystemName updated.\n");
-            }
-            break;
+__attribute__((target("avx2")))
+const char *substring_search_avx2(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len)
+{
+    if (needle_len == 0)
+        return haystack;
+    if (needle_len > haystack_len)
+        return NULL;
 
-        case 2: // TestType
-            if (get_valid_input(buffer, sizeof(buffer), validate_test_type,
-                                "Enter new Test Type"))
-            {
-                strcpy(record->test_type, trim_string(buffer));
-                changes_made = 1;
-                printf("✓ TestType updated.\n");
-            }
-            break;
+    unsigned char first = fold_ascii((unsigned char)needle[0]);
+    unsigned char last = fold_ascii((unsigned char)needle[needle_len - 1]);
+    const __m256i first_v = _mm256_set1_epi8((char)first);
+    const __m256i last_v = _mm256_set1_epi8((char)last);
+    const __m256i first_case = _mm256_set1_epi8((unsigned char)(first - 'a') < 26 ? 0x20 : 0);
+    const __m256i last_case = _mm256_set1_epi8((unsigned char)(last - 'a') < 26 ? 0x20 : 0);
+    size_t middle = needle_len > 2 ? needle_len - 2 : 0;
 
-        case 3: // TestResult
-            printf("Select new Test Result:\n");
-            printf("1. Pending\n2. Failed\n3. Passed\n4. Success\n");
-            int result_choice = get_menu_choice(1, 4);
-            if (result_choice != -1)
-            {
-                TestResult old_result = record->test_result;
-                switch (result_choice)
-                {
-                case 1:
-                    record->test_result = PENDING;
-                    break;
-                case 2:
-                    record->test_result = FAILED;
-                    break;
-                case 3:
-                    record->test_result = PASSED;
-                    break;
-                case 4:
-                    record->test_result = SUCCESS;
-                    break;
-                }
-                if (record->test_result != old_result)
-                {
-                    changes_made = 1;
-                    printf("✓ TestResult updated.\n");
-                }
-            }
-            break;
+    size_t i = 0;
+    for (; i + needle_len - 1 + 32 <= haystack_len; i += 32)
+    {
+        __m256i head = _mm256_loadu_si256((const __m256i *)(haystack + i));
+        __m256i tail = _mm256_loadu_si256((const __m256i *)(haystack + i + needle_len - 1));
+        __m256i hit = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_or_si256(head, first_case), first_v),
+                                       _mm256_cmpeq_epi8(_mm256_or_si256(tail, last_case), last_v));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(hit);
+        while (mask)
+        {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (equal_fold_ascii(haystack + at + 1, needle + 1, middle))
+                return haystack + at;
+            mask &= mask - 1;
         }
     }
+    return substring_search_sse2(haystack + i, haystack_len - i, needle, needle_len);
 }
+#endif
 
-void delete_record(int test_id, int soft_delete)
+void init_substring_search(void)
 {
-    int index = find_record_by_id(test_id);
-    if (index == -1)
-    {
-        printf("Record with TestID %d not found.\n", test_id);
-        pause_screen();
+    if (substring_search)
         return;
-    }
 
-    TestRecord *record = &db.records[index];
+    const char *forced = getenv("TDM_SIMD");
+    substring_search = substring_search_scalar;
+    substring_kernel_name = "scalar";
+    if (forced && strcmp(forced, "scalar") == 0)
+        return;
 
-    if (soft_delete && !record->active)
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && !(forced && strcmp(forced, "sse2") == 0))
     {
-        printf("Record is already deleted.\n");
-        pause_screen();
-        return;
+        substring_search = substring_search_avx2;
+        substring_kernel_name = "avx2";
     }
-
-    if (!soft_delete && record->active)
+    else if (__builtin_cpu_supports("sse2"))
     {
-        printf("Record must be soft-deleted first.\n");
-        pause_screen();
-        return;
+        substring_search = substring_search_sse2;
+        substring_kernel_name = "sse2";
     }
+#endif
+}
 
-    clear_screen();
-    printf("You are about to %s the following record:\n", soft_delete ? "delete" : "permanently delete");
-    printf("┌────────┬────────────────────────────────┬───────────────────────────┬──────────┐\n");
-    printf("│ TestID │ SystemName                     │ TestType                  │ Result   │\n");
-    printf("├────────┼────────────────────────────────┼───────────────────────────┼──────────┤\n");
-    printf("│ %-6d │ %-30s │ %-25s │ %-8s │\n", record->test_id, record->system_name, record->test_type,
-           test_result_to_string(record->test_result));
-    printf("└────────┴────────────────────────────────┴───────────────────────────┴──────────┘\n");
+const char *find_substring_ci(const char *haystack, size_t haystack_len, const char *needle, size_t needle_len)
+{
+    if (!substring_search)
+        init_substring_search();
+    return substring_search(haystack, haystack_len, needle, needle_len);
+}
 
-    printf("\n");
+int contains_ci(const char *text, const char *term)
+{
+    return find_substring_ci(text, strlen(text), term, strlen(term)) != NULL;
+}
 
-    if (!get_yes_no(soft_delete ? "Are you sure you want to delete this record?" : "Are you sure you want to permanently delete this record?", 0, 3))
-    {
-        printf("Operation cancelled.\n");
-        pause_screen();
-        return;
-    }
+uint32_t trigram_key(const char *text)
+{
+    return (uint32_t)tolower((unsigned char)text[0]) << 16 |
+           (uint32_t)tolower((unsigned char)text[1]) << 8 |
+           (uint32_t)tolower((unsigned char)text[2]);
+}
 
-    if (soft_delete)
+uint32_t trigram_slot(const TrigramIndex *index, uint32_t key)
+{
+    uint32_t mask = index->slot_count - 1;
+    uint32_t i = (key * 2654435761u) & mask;
+    while (index->keys[i] != 0 && index->keys[i] != key + 1)
+        i = (i + 1) & mask;
+    return i;
+}
+
+Posting *trigram_find(const TrigramIndex *index, uint32_t key)
+{
+    if (index->slot_count == 0)
+        return NULL;
+
+    uint32_t i = trigram_slot(index, key);
+    return index->keys[i] ? &index->lists[i] : NULL;
+}
+
+// Appends id to the trigram's list; ids arrive in ascending order, so a
+// repeated trigram within one entry only needs a check against the tail
+int trigram_add(TrigramIndex *index, uint32_t key, uint32_t id)
+{
+    if ((index->used + 1) * 2 > index->slot_count)
     {
-        record->active = 0;
-        if (save_database())
+        uint32_t old_count = index->slot_count;
+        uint32_t *old_keys = index->keys;
+        Posting *old_lists = index->lists;
+        uint32_t slot_count = old_count > 0 ? old_count * 2 : 256;
+        uint32_t *keys = calloc(slot_count, sizeof(uint32_t));
+        Posting *lists = calloc(slot_count, sizeof(Posting));
+        if (!keys || !lists)
         {
-            printf("✓ Record soft-deleted successfully!\n");
-            printf("1 record deleted from active records.\n");
+            free(keys);
+            free(lists);
+            return 0;
         }
-        else
+
+        index->keys = keys;
+        index->lists = lists;
+        index->slot_count = slot_count;
+        for (uint32_t i = 0; i < old_count; i++)
         {
-            printf("✗ Error saving to database.\n");
-            record->active = 1; // Rollback
+            if (old_keys[i])
+            {
+                uint32_t slot = trigram_slot(index, old_keys[i] - 1);
+                index->keys[slot] = old_keys[i];
+                index->lists[slot] = old_lists[i];
+            }
         }
+        free(old_keys);
+        free(old_lists);
     }
-    else
+
+    uint32_t slot = trigram_slot(index, key);
+    if (!index->keys[slot])
     {
-        // Permanent delete - remove from array
-        for (int i = index; i < db.count - 1; i++)
-        {
-            db.records[i] = db.records[i + 1];
-        }
-        db.count--;
+        index->keys[slot] = key + 1;
+        index->used++;
+    }
 
-        if (save_database())
-        {
-            printf("✓ Record permanently deleted!\n");
-            printf("1 record permanently removed from database.\n");
-        }
-        else
-        {
-            printf("✗ Error saving to database.\n");
-            // Rollback is complex for permanent delete, so we'll leave it as is
-        }
+    Posting *list = &index->lists[slot];
+    if (list->count > 0 && list->items[list->count - 1] == id)
+        return 1;
+    if (list->count == list->capacity)
+    {
+        uint32_t capacity = list->capacity > 0 ? list->capacity * 2 : 4;
+        uint32_t *items = realloc(list->items, capacity * sizeof(uint32_t));
+        if (!items)
+            return 0;
+        list->items = items;
+        list->capacity = capacity;
     }
-    pause_screen();
+    list->items[list->count++] = id;
+    return 1;
 }
 
-void recovery_data(void)
+int trigram_add_text(TrigramIndex *index, const char *text, size_t len, uint32_t id)
 {
-    clear_screen();
-    printf("RECOVERY DATA\n");
-    printf("=============\n");
-
-    // Filter deleted records
-    TestRecord *deleted_records = malloc(db.count * sizeof(TestRecord));
-    if (deleted_records == NULL)
+    for (size_t i = 0; i + 3 <= len; i++)
     {
-        printf("Memory allocation failed. Unable to recover deleted records.\n");
-        pause_screen();
-        return;
+        if (!trigram_add(index, trigram_key(text + i), id))
+            return 0;
     }
-    int deleted_count = 0;
+    return 1;
+}
 
-    for (int i = 0; i < db.count; i++)
+void trigram_free(TrigramIndex *index)
+{
+    for (uint32_t i = 0; i < index->slot_count; i++)
     {
-        if (!db.records[i].active)
-        {
-            deleted_records[deleted_count++] = db.records[i];
-        }
+        free(index->lists[i].items);
     }
+    free(index->keys);
+    free(index->lists);
+    memset(index, 0, sizeof(*index));
+}
 
-    if (deleted_count == 0)
+// Dictionaries only ever gain codes, so catching up is enough
+int trigram_sync_dictionary(TrigramIndex *index, const StringDictionary *dict)
+{
+    for (uint32_t code = index->indexed; code < dict->count; code++)
     {
-        printf("No deleted records found.\n");
-        free(deleted_records);
-        pause_screen();
-        return;
+        if (!trigram_add_text(index, dict->strings[code], dict->lengths[code], code))
+        {
+            trigram_free(index);
+            return 0;
+        }
+        index->indexed = code + 1;
     }
+    return 1;
+}
 
-    display_records_paginated(deleted_records, deleted_count, "Deleted Records");
-
-    printf("\nSelect action:\n");
-    printf("1. Recover a record\n");
-    printf("2. Permanently delete a record\n");
-    printf("3. Return to main menu\n");
-
-    printf("\n");
+// Characters "%d" prints for test_id
+int test_id_length(int test_id)
+{
+    unsigned int value = test_id < 0 ? 0u - (unsigned int)test_id : (unsigned int)test_id;
+    int len = test_id < 0 ? 2 : 1;
+    for (; value >= 10; value /= 10)
+        len++;
+    return len;
+}
 
-    int action = get_menu_choice(1, 3);
-    if (action == -1 || action == 3)
+// Same text as "%d"; writes two digits per step from the end, buffer needs 12 bytes
+int format_test_id(int test_id, char *buffer)
+{
+    static const char digit_pairs[] = "00010203040506070809101112131415161718192021222324"
+                                      "25262728293031323334353637383940414243444546474849"
+                                      "50515253545556575859606162636465666768697071727374"
+                                      "75767778798081828384858687888990919293949596979899";
+    unsigned int value = test_id < 0 ? 0u - (unsigned int)test_id : (unsigned int)test_id;
+    int len = test_id_length(test_id);
+
+    buffer[0] = '-';
+    buffer[len] = '\0';
+    char *p = buffer + len;
+    while (value >= 100)
     {
-        free(deleted_records);
-        return;
+        unsigned int pair = (value % 100) * 2;
+        value /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if (value >= 10)
+    {
+        *--p = digit_pairs[value * 2 + 1];
+        *--p = digit_pairs[value * 2];
     }
+    else
+    {
+        *--p = (char)('0' + value);
+    }
+    return len;
+}
 
-    int attempts = 0;
-    while (attempts < MAX_ATTEMPTS)
+int trigram_sync_ids(void)
+{
+    if (db.id_grams.indexed == 0 || db.id_grams.indexed > (uint32_t)db.count)
+        trigram_free(&db.id_grams);
+
+    for (uint32_t row = db.id_grams.indexed; row < (uint32_t)db.count; row++)
     {
-        char input_buffer[20];
-        if (!get_valid_input(input_buffer, sizeof(input_buffer), validate_test_id, "Enter TestID"))
+        char id_str[16];
+        int len = format_test_id(db.test_ids[row], id_str);
+        if (!trigram_add_text(&db.id_grams, id_str, (size_t)len, row))
         {
-            free(deleted_records);
-            return;
+            trigram_free(&db.id_grams);
+            return 0;
         }
-        int test_id = atoi(trim_string(input_buffer));
+        db.id_grams.indexed = row + 1;
+    }
+    return 1;
+}
 
-        int index = find_record_by_id(test_id);
-        if (index == -1 || db.records[index].active)
+// Drops row from every list and renumbers the rows after it, matching the
+// shift done by database_remove_record()
+void trigram_remove_row(TrigramIndex *index, uint32_t row)
+{
+    if (row >= index->indexed)
+        return;
+
+    for (uint32_t i = 0; i < index->slot_count; i++)
+    {
+        Posting *list = &index->lists[i];
+        uint32_t kept = 0;
+        for (uint32_t j = 0; j < list->count; j++)
         {
-            attempts++;
-            printf("TestID %d not found in deleted records.\n", test_id);
-            continue;
+            uint32_t id = list->items[j];
+            if (id != row)
+                list->items[kept++] = id > row ? id - 1 : id;
         }
+        list->count = kept;
+    }
+    index->indexed--;
+}
 
-        // Show the record
-        TestRecord *record = &db.records[index];
-        clear_screen();
-        printf("You are about to %s the following record:\n", action == 1 ? "recover" : "permanently delete");
-        printf("┌────────┬────────────────────────────────┬───────────────────────────┬──────────┐\n");
-        printf("│ TestID │ SystemName                     │ TestType                  │ Result   │\n");
-        printf("├────────┼────────────────────────────────┼───────────────────────────┼──────────┤\n");
-        printf("│ %-6d │ %-30s │ %-25s │ %-8s │\n", record->test_id, record->system_name, record->test_type,
-               test_result_to_string(record->test_result));
-        printf("└────────┴────────────────────────────────┴───────────────────────────┴──────────┘\n");
+// Intersects the lists of every trigram in term into a malloc'd ascending
+// array (NULL when empty). Returns 0 if term is too short or memory runs out.
+int trigram_candidates(const TrigramIndex *index, const char *term, uint32_t **ids, uint32_t *count)
+{
+    size_t len = strlen(term);
+    *ids = NULL;
+    *count = 0;
+    if (len < 3)
+        return 0;
 
-        if (action == 1)
-        {
-            if (get_yes_no("Confirm recovery of this record?", 0, 3))
-            {
-                record->active = 1;
-                if (save_database())
-                {
-                    printf("✓ Record recovered successfully!\n");
-                    printf("1 record recovered.\n");
-                }
-                else
-                {
-                    printf("✗ Error saving to database.\n");
-                    record->active = 0; // Rollback
-                }
-            }
-            else
-            {
-                printf("Recovery cancelled.\n");
-            }
-        }
-        else if (action == 2)
-        {
-            printf("\n⚠️  WARNING: This will permanently delete the record.\n");
+    const Posting *shortest = NULL;
+    for (size_t i = 0; i + 3 <= len; i++)
+    {
+        const Posting *list = trigram_find(index, trigram_key(term + i));
+        if (!list || list->count == 0)
+            return 1;
+        if (!shortest || list->count < shortest->count)
+            shortest = list;
+    }
 
-            char confirm_input[20];
-            char expected_id[20];
-            snprintf(expected_id, sizeof(expected_id), "%d", test_id);
+    uint32_t *result = malloc(shortest->count * sizeof(uint32_t));
+    if (!result)
+        return 0;
+    memcpy(result, shortest->items, shortest->count * sizeof(uint32_t));
+    uint32_t result_count = shortest->count;
 
-            if (!get_valid_input(confirm_input, sizeof(confirm_input), NULL,
-                                 "Type the TestID again to confirm permanent deletion"))
-            {
-                free(deleted_records);
-                return;
-            }
+    for (size_t i = 0; i + 3 <= len && result_count > 0; i++)
+    {
+        const Posting *list = trigram_find(index, trigram_key(term + i));
+        if (list == shortest)
+            continue;
 
-            if (strcmp(trim_string(confirm_input), expected_id) == 0)
-            {
-                delete_record(test_id, 0);
-                free(deleted_records);
-                return;
-            }
-            else
-            {
-                printf("TestID mismatch. Operation cancelled.\n");
-            }
+        // Both sides are ascending: merge, keeping ids present in each
+        uint32_t kept = 0;
+        uint32_t j = 0;
+        for (uint32_t k = 0; k < result_count; k++)
+        {
+            while (j < list->count && list->items[j] < result[k])
+                j++;
+            if (j < list->count && list->items[j] == result[k])
+                result[kept++] = result[k];
         }
-
-        free(deleted_records);
-        pause_screen();
-        return;
+        result_count = kept;
     }
 
-    printf("Maximum attempts reached. Returning to main menu.\n");
-    free(deleted_records);
-    pause_screen();
+    if (result_count == 0)
+    {
+        free(result);
+        return 1;
+    }
+    *ids = result;
+    *count = result_count;
+    return 1;
 }
 
-int create_new_database_prompt(void)
+// Fills results (room for db.count rows) with the active rows that contain
+// term in any field, in row order. Returns the number found, or -1 if out of memory.
+int search_matching_rows(const char *term, RowSet *results)
 {
-    char filename[MAX_PATH];
-    if (get_valid_input(filename, sizeof(filename), NULL, "Enter database name"))
+    results->count = 0;
+    uint8_t *system_hits = dictionary_match(&db.systems, &db.system_grams, term);
+    uint8_t *type_hits = dictionary_match(&db.types, &db.type_grams, term);
+    if (!system_hits || !type_hits)
     {
-        if (create_new_csv(filename))
+        free(system_hits);
+        free(type_hits);
+        return -1;
+    }
+
+    uint8_t result_hits[SUCCESS + 1];
+    int any_hit = 0;
+    for (int r = FAILED; r <= SUCCESS; r++)
+    {
+        result_hits[r] = contains_ci(test_result_to_string((TestResult)r), term);
+        any_hit |= result_hits[r];
+    }
+    for (uint32_t code = 0; code < db.systems.count && !any_hit; code++)
+        any_hit = system_hits[code];
+    for (uint32_t code = 0; code < db.types.count && !any_hit; code++)
+        any_hit = type_hits[code];
+
+    // TestIDs are digits, so only an all-digit term can match one
+    int digits_only = term[0] != '\0';
+    for (const char *c = term; *c && digits_only; c++)
+        digits_only = isdigit((unsigned char)*c);
+
+    uint32_t *id_rows = NULL;
+    uint32_t id_row_count = 0;
+    int scan_ids = 0;
+    if (digits_only)
+    {
+        if (use_search_index && trigram_sync_ids() &&
+            trigram_candidates(&db.id_grams, term, &id_rows, &id_row_count))
         {
-            printf("✓ Database created successfully: %s\n", db.filename);
-            pause_screen();
-            return 1;
+            uint32_t kept = 0;
+            for (uint32_t i = 0; i < id_row_count; i++)
+            {
+                char id_str[16];
+                format_test_id(db.test_ids[id_rows[i]], id_str);
+                if (strstr(id_str, term))
+                    id_rows[kept++] = id_rows[i];
+            }
+            id_row_count = kept;
         }
         else
         {
-            printf("✗ Error creating database.\n");
-            pause_screen();
-            return 0;
+            scan_ids = 1; // Index off, short term or no memory for the index
         }
     }
-    return 0;
-}
 
-int enter_manual_path_prompt(void)
-{
-    char path[MAX_PATH];
-    if (get_valid_input(path, sizeof(path), NULL, "Enter CSV file path"))
+    if (!any_hit && !scan_ids)
     {
-        if (validate_csv_header(path) && load_database(path))
+        // Nothing matched by name or result: the ID candidates are the answer
+        for (uint32_t i = 0; i < id_row_count; i++)
         {
-            printf("✓ Database loaded successfully: %s\n", db.filename);
-            pause_screen();
-            return 1;
+            if (database_is_active((int)id_rows[i]))
+                results->rows[results->count++] = id_rows[i];
         }
-        else
+    }
+    else
+    {
+        uint32_t next_id_row = 0;
+        for (int i = 0; i < db.count; i++)
         {
-            printf("✗ Invalid CSV file or header format.\n");
-            pause_screen();
-            return 0;
+            while (next_id_row < id_row_count && id_rows[next_id_row] < (uint32_t)i)
+                next_id_row++;
+            if (!database_is_active(i))
+                continue;
+
+            int result = db.results[i];
+            int hit = system_hits[db.system_codes[i]] || type_hits[db.type_codes[i]] ||
+                      (result >= FAILED && result <= SUCCESS && result_hits[result]) ||
+                      (next_id_row < id_row_count && id_rows[next_id_row] == (uint32_t)i);
+            if (!hit && scan_ids)
+            {
+                char id_str[16];
+                format_test_id(db.test_ids[i], id_str);
+                hit = strstr(id_str, term) != NULL;
+            }
+
+            if (hit)
+                results->rows[results->count++] = (uint32_t)i;
         }
     }
-    return 0;
+
+    free(id_rows);
+    free(system_hits);
+    free(type_hits);
+    return results->count;
 }
 
-int select_database(void)
+int query_eval_and(const QueryNode *node, int row)
 {
-    clear_screen();
-    printf("SELECT DATABASE\n");
-    printf("===============\n");
-
-    char files[MAX_FILES][MAX_PATH];
-    int file_count = scan_csv_files(files);
+    return node->left->eval(node->left, row) && node->right->eval(node->right, row);
+}
 
-    if (file_count == 0)
-    {
-        printf("No CSV files found in current directory.\n\n");
-        printf("Options:\n");
-        printf("1. Create new database\n");
-        printf("2. Enter manual path\n");
-        printf("3. Do nothing\n");
-        printf("\n");
+int query_eval_or(const QueryNode *node, int row)
+{
+    return node->left->eval(node->left, row) || node->right->eval(node->right, row);
+}
 
-        int choice = get_menu_choice(1, 3);
-        if (choice == -1 || choice == 3)
-            return 0;
+int query_eval_not(const QueryNode *node, int row)
+{
+    return !node->left->eval(node->left, row);
+}
 
-        if (choice == 1)
-        {
-            return create_new_database_prompt();
-        }
+int query_eval_system(const QueryNode *node, int row)
+{
+    uint32_t code = db.system_codes[row];
+    return code < node->code_count && node->codes[code];
+}
 
-        if (choice == 2)
-        {
+int query_eval_type(const QueryNode *node, int row)
+{
+    uint32_t code = db.type_codes[row];
+    return code < node->code_count && node->codes[code];
+}
 
-            return enter_manual_path_prompt();
-        }
-    }
+int query_eval_result(const QueryNode *node, int row)
+{
+    return (node->result_mask >> db.results[row]) & 1;
+}
 
-    printf("Found %d CSV file(s):\n", file_count);
-    for (int i = 0; i < file_count; i++)
-    {
-        printf("%d. %s\n", i + 1, files[i]);
-    }
+int query_eval_id(const QueryNode *node, int row)
+{
+    return db.test_ids[row] >= node->low && db.test_ids[row] <= node->high;
+}
 
-    printf("\nOther Options:\n");
+int query_eval_active(const QueryNode *node, int row)
+{
+    (void)node;
+    return database_is_active(row);
+}
 
-    printf("%d. Create new database\n", file_count + 1);
-    printf("%d. Enter manual path\n", file_count + 2);
-    printf("%d. Do nothing\n", file_count + 3);
+int query_eval_deleted(const QueryNode *node, int row)
+{
+    (void)node;
+    return !database_is_active(row);
+}
 
-    printf("\n");
+// Takes ownership of left and right; frees them if out of memory
+QueryNode *query_node(QueryPredicate eval, QueryNode *left, QueryNode *right)
+{
+    QueryNode *node = calloc(1, sizeof(QueryNode));
+    if (!node)
+    {
+        query_free(left);
+        query_free(right);
+        return NULL;
+    }
+    node->eval = eval;
+    node->left = left;
+    node->right = right;
+    return node;
+}
 
-    int choice = get_menu_choice(1, file_count + 3);
-    if (choice == -1 || choice == file_count + 3)
-        return 0;
+void query_free(QueryNode *node)
+{
+    if (!node)
+        return;
+    query_free(node->left);
+    query_free(node->right);
+    free(node->codes);
+    free(node);
+}
 
-    if (choice == file_count + 1)
+// Records the first error with its position and releases the partial tree
+QueryNode *query_fail(QueryParser *parser, const char *message, QueryNode *partial)
+{
+    if (parser->error[0] == '\0')
     {
-        return create_new_database_prompt();
+        if (parser->type == QUERY_END)
+            snprintf(parser->error, parser->error_size, "%s at end of filter", message);
+        else
+            snprintf(parser->error, parser->error_size, "%s at position %zu ('%s')", message,
+                     parser->token_start + 1, parser->token);
     }
+    query_free(partial);
+    return NULL;
+}
 
-    if (choice == file_count + 2)
+// Tokens: words (letters, digits, _ . -), "quoted strings" and ( ) , ~ = != < <= > >=
+int query_next_token(QueryParser *parser)
+{
+    const char *text = parser->text;
+    while (isspace((unsigned char)text[parser->pos]))
+        parser->pos++;
+
+    parser->token_start = parser->pos;
+    parser->token[0] = '\0';
+    char c = text[parser->pos];
+    size_t len = 0;
+    if (c == '\0')
     {
-        return enter_manual_path_prompt();
+        parser->type = QUERY_END;
+        return 1;
     }
 
-    // Load selected file
-    char *selected_file = files[choice - 1];
-
-    if (!validate_csv_header(selected_file))
+    if (c == '"')
     {
-        printf("✗ Invalid header format in %s\n", selected_file);
-        printf("Required header: %s\n", REQUIRED_HEADER);
-
-        if (get_yes_no("Try another file?", 0, 1))
+        parser->pos++;
+        while (text[parser->pos] != '"')
         {
-            return select_database();
+            if (text[parser->pos] == '\0' || len + 1 >= sizeof(parser->token))
+            {
+                snprintf(parser->error, parser->error_size, "Unterminated string at position %zu",
+                         parser->token_start + 1);
+                return 0;
+            }
+            parser->token[len++] = text[parser->pos++];
         }
-        return 0;
+        parser->pos++;
+        parser->token[len] = '\0';
+        parser->type = QUERY_STRING;
+        return 1;
     }
 
-    if (load_database(selected_file))
+    if (isalnum((unsigned char)c) || c == '_' || c == '.' || c == '-')
     {
-        printf("✓ Database loaded successfully: %s\n", db.filename);
-        printf("Records loaded: %d\n", db.count);
-        pause_screen();
+        while ((isalnum((unsigned char)text[parser->pos]) || text[parser->pos] == '_' || text[parser->pos] == '.' ||
+                text[parser->pos] == '-') &&
+               len + 1 < sizeof(parser->token))
+        {
+            parser->token[len++] = text[parser->pos++];
+        }
+        parser->token[len] = '\0';
+        parser->type = QUERY_WORD;
         return 1;
     }
-    else
+
+    if ((c == '!' || c == '<' || c == '>') && text[parser->pos + 1] == '=')
     {
-        printf("✗ Error loading database.\n");
-        pause_screen();
+        parser->token[len++] = text[parser->pos++];
+    }
+    else if (!strchr("(),~=<>", c))
+    {
+        parser->token[0] = c;
+        parser->token[1] = '\0';
+        parser->type = QUERY_SYMBOL;
+        query_fail(parser, "Unexpected character", NULL);
         return 0;
     }
+    parser->token[len++] = text[parser->pos++];
+    parser->token[len] = '\0';
+    parser->type = QUERY_SYMBOL;
+    return 1;
 }
 
-int change_database(void)
+// Keywords and symbols; keywords are case-insensitive, quoted strings never match
+int query_token_is(const QueryParser *parser, const char *word)
 {
-    if (!get_yes_no("Current database will be closed. Continue?", 0, 1))
+    if (parser->type == QUERY_SYMBOL)
+        return strcmp(parser->token, word) == 0;
+    return parser->type == QUERY_WORD && strcasecmp(parser->token, word) == 0;
+}
+
+int query_parse_int(QueryParser *parser, int *value)
+{
+    char *end;
+    long long parsed = strtoll(parser->token, &end, 10);
+    if (parser->type != QUERY_WORD || *end != '\0' || end == parser->token || parsed < INT_MIN || parsed > INT_MAX)
     {
+        query_fail(parser, "Expected a number", NULL);
         return 0;
     }
+    *value = (int)parsed;
+    return query_next_token(parser);
+}
 
-    if (select_database())
+// One value, or "in (a, b, ...)"; the current token is the value or "in"
+int query_parse_values(QueryParser *parser, char values[][MAX_LINE], int max_values)
+{
+    int list = query_token_is(parser, "in");
+    if (list && (!query_next_token(parser) || !query_token_is(parser, "(") || !query_next_token(parser)))
     {
-        printf("Database changed successfully.\n");
-        return 1;
+        query_fail(parser, "Expected '(' after in", NULL);
+        return 0;
     }
-    else
+
+    int count = 0;
+    while (1)
     {
-        printf("No database selected. Exiting to main menu.\n");
-        return 0;
+        if (parser->type != QUERY_WORD && parser->type != QUERY_STRING)
+        {
+            query_fail(parser, "Expected a value", NULL);
+            return 0;
+        }
+        if (count == max_values)
+        {
+            query_fail(parser, "Too many values", NULL);
+            return 0;
+        }
+        strcpy(values[count++], parser->token);
+        if (!query_next_token(parser))
+            return 0;
+        if (!list)
+            return count;
+        if (query_token_is(parser, ")"))
+            return query_next_token(parser) ? count : 0;
+        if (!query_token_is(parser, ",") || !query_next_token(parser))
+        {
+            query_fail(parser, "Expected ',' or ')'", NULL);
+            return 0;
+        }
     }
 }
-void test_input_validation(void)
-{
-    printf("Running Input Validation Tests...\n");
 
-    // Test validate_system_name function
-    printf("Testing validate_system_name...\n");
+// system/type ~ "part", ~ in (parts), = name, != name or in (names): matched once per dictionary entry
+QueryNode *query_parse_names(QueryParser *parser, const StringDictionary *dict, TrigramIndex *grams,
+                             QueryPredicate eval)
+{
+    int negate = query_token_is(parser, "!=");
+    int contains = query_token_is(parser, "~");
+    int list = query_token_is(parser, "in");
+    if (!negate && !contains && !list && !query_token_is(parser, "="))
+        return query_fail(parser, "Expected ~, =, != or in", NULL);
+    if (!list && !query_next_token(parser))
+        return NULL;
 
-    // Valid system names
-    assert(validate_system_name("System123") == 1);
-    assert(validate_system_name("Test-System_v1.0") == 1);
-    assert(validate_system_name("System (Main)") == 1);
-    assert(validate_system_name("System[Backend]") == 1);
-    assert(validate_system_name("API Gateway Server") == 1);
-    assert(validate_system_name("DB-Server_v2.1") == 1);
+    char values[8][MAX_LINE];
+    int value_count = query_parse_values(parser, values, 8);
+    if (value_count == 0)
+        return NULL;
 
-    // Invalid system names - too short
-    assert(validate_system_name("AB") == 0);
-    assert(validate_system_name("X") == 0);
-    assert(validate_system_name("") == 0);
+    QueryNode *node = query_node(eval, NULL, NULL);
+    if (!node)
+        return query_fail(parser, "Out of memory", NULL);
+    node->code_count = dict->count;
+    if (contains)
+    {
+        // With a list, a name matches if it contains any of the parts
+        node->codes = dictionary_match(dict, grams, values[0]);
+        for (int v = 1; node->codes && v < value_count; v++)
+        {
+            uint8_t *more = dictionary_match(dict, grams, values[v]);
+            for (uint32_t code = 0; more && code < dict->count; code++)
+                node->codes[code] |= more[code];
+            if (!more)
+            {
+                free(node->codes);
+                node->codes = NULL;
+            }
+            free(more);
+        }
+    }
+    else
+    {
+        node->codes = calloc(dict->count + 1, 1);
+        for (int v = 0; node->codes && v < value_count; v++)
+        {
+            size_t len = strlen(values[v]);
+            for (uint32_t code = 0; code < dict->count; code++)
+            {
+                if (dict->lengths[code] == len && equal_fold_ascii(dict->strings[code], values[v], len))
+                    node->codes[code] = 1;
+            }
+        }
+    }
+    if (!node->codes)
+        return query_fail(parser, "Out of memory", node);
+    return negate ? query_node(query_eval_not, node, NULL) : node;
+}
 
-    // Invalid system names - invalid characters
-    assert(validate_system_name("System@Test") == 0);
-    assert(validate_system_name("System#Test") == 0);
-    assert(validate_system_name("System$Test") == 0);
-    assert(validate_system_name("System%Test") == 0);
-    assert(validate_system_name("System&Test") == 0);
-    assert(validate_system_name("System*Test") == 0);
-    assert(validate_system_name("System+Test") == 0);
-    assert(validate_system_name("System=Test") == 0);
-    assert(validate_system_name("System/Test") == 0);
-    assert(validate_system_name("System\\Test") == 0);
-    assert(validate_system_name("System|Test") == 0);
-    assert(validate_system_name("System<Test") == 0);
-    assert(validate_system_name("System>Test") == 0);
-    assert(validate_system_name("System?Test") == 0);
-    assert(validate_system_name("System!Test") == 0);
-    assert(validate_system_name("System\"Test") == 0);
-    assert(validate_system_name("System'Test") == 0);
-    assert(validate_system_name("System:Test") == 0);
-    assert(validate_system_name("System;Test") == 0);
-    assert(validate_system_name("System,Test") == 0);
+QueryNode *query_parse_comparison(QueryParser *parser)
+{
+    if (parser->type != QUERY_WORD)
+        return query_fail(parser, "Expected a field", NULL);
 
-    // Edge cases
-    assert(validate_system_name(NULL) == 0);
-    assert(validate_system_name("   ") == 0);     // Only whitespace
-    assert(validate_system_name("  ABC  ") == 1); // Should trim and pass
+    if (query_token_is(parser, "active") || query_token_is(parser, "deleted"))
+    {
+        QueryNode *node = query_node(query_token_is(parser, "active") ? query_eval_active : query_eval_deleted,
+                                     NULL, NULL);
+        if (!node)
+            return query_fail(parser, "Out of memory", NULL);
+        return query_next_token(parser) ? node : query_fail(parser, "", node);
+    }
 
-    printf("✓ validate_system_name tests passed\n");
+    char field[MAX_LINE];
+    strcpy(field, parser->token);
+    if (!query_next_token(parser))
+        return NULL;
 
-    // Test validate_test_type function
-    printf("Testing validate_test_type...\n");
+    if (strcasecmp(field, "system") == 0 || strcasecmp(field, "systemname") == 0)
+        return query_parse_names(parser, &db.systems, &db.system_grams, query_eval_system);
+    if (strcasecmp(field, "type") == 0 || strcasecmp(field, "testtype") == 0)
+        return query_parse_names(parser, &db.types, &db.type_grams, query_eval_type);
 
-    // Valid test types
-    assert(validate_test_type("API") == 1);
-    assert(validate_test_type("UnitTest") == 1);
-    assert(validate_test_type("IntegrationTest") == 1);
-    assert(validate_test_type("SystemTest") == 1);
-    assert(validate_test_type("PerformanceTest") == 1);
-    assert(validate_test_type("SecurityTest") == 1);
-    assert(validate_test_type("ABC123") == 1);
-    assert(validate_test_type("Test123") == 1);
+    if (strcasecmp(field, "result") == 0 || strcasecmp(field, "testresult") == 0)
+    {
+        int negate = query_token_is(parser, "!=");
+        if (!negate && !query_token_is(parser, "=") && !query_token_is(parser, "in"))
+            return query_fail(parser, "Expected =, != or in", NULL);
+        if (!query_token_is(parser, "in") && !query_next_token(parser))
+            return NULL;
+
+        char values[SUCCESS + 1][MAX_LINE];
+        int value_count = query_parse_values(parser, values, SUCCESS + 1);
+        if (value_count == 0)
+            return NULL;
+        unsigned mask = 0;
+        for (int v = 0; v < value_count; v++)
+        {
+            TestResult result = string_to_test_result(values[v]);
+            if (result == INVALID_RESULT)
+            {
+                snprintf(parser->error, parser->error_size, "Unknown TestResult '%s'", values[v]);
+                return NULL;
+            }
+            mask |= 1u << result;
+        }
 
-    // Invalid test types - too short
-    assert(validate_test_type("AB") == 0);
-    assert(validate_test_type("X") == 0);
-    assert(validate_test_type("") == 0);
+        QueryNode *node = query_node(query_eval_result, NULL, NULL);
+        if (!node)
+            return query_fail(parser, "Out of memory", NULL);
+        node->result_mask = negate ? ~mask : mask;
+        return node;
+    }
 
-    // Invalid test types - invalid characters
-    assert(validate_test_type("Test-Case") == 0);  // Hyphen not allowed
-    assert(validate_test_type("Test_Case") == 0);  // Underscore not allowed
-    assert(validate_test_type("Test Case") == 0);  // Space not allowed
-    assert(validate_test_type("Test.Case") == 0);  // Dot not allowed
-    assert(validate_test_type("Test(Case)") == 0); // Parentheses not allowed
-    assert(validate_test_type("Test[Case]") == 0); // Brackets not allowed
-    assert(validate_test_type("Test@Case") == 0);
-    assert(validate_test_type("Test#Case") == 0);
-    assert(validate_test_type("Test$Case") == 0);
-    assert(validate_test_type("Test%Case") == 0);
-    assert(validate_test_type("Test&Case") == 0);
-    assert(validate_test_type("Test*Case") == 0);
+    if (strcasecmp(field, "id") == 0 || strcasecmp(field, "testid") == 0)
+    {
+        int low = INT_MIN;
+        int high = INT_MAX;
+        int negate = query_token_is(parser, "!=");
+        int value;
+        if (query_token_is(parser, "between"))
+        {
+            if (!query_next_token(parser) || !query_parse_int(parser, &low))
+                return NULL;
+            if (!query_token_is(parser, "and"))
+                return query_fail(parser, "Expected and", NULL);
+            if (!query_next_token(parser) || !query_parse_int(parser, &high))
+                return NULL;
+        }
+        else if (query_token_is(parser, "=") || negate)
+        {
+            if (!query_next_token(parser) || !query_parse_int(parser, &value))
+                return NULL;
+            low = high = value;
+        }
+        else if (query_token_is(parser, "<") || query_token_is(parser, "<="))
+        {
+            int strict = query_token_is(parser, "<");
+            if (!query_next_token(parser) || !query_parse_int(parser, &value))
+                return NULL;
+            high = value;
+            if (strict && value > INT_MIN)
+                high = value - 1;
+            else if (strict)
+                low = 1, high = 0; // Nothing is below INT_MIN
+        }
+        else if (query_token_is(parser, ">") || query_token_is(parser, ">="))
+        {
+            int strict = query_token_is(parser, ">");
+            if (!query_next_token(parser) || !query_parse_int(parser, &value))
+                return NULL;
+            low = value;
+            if (strict && value < INT_MAX)
+                low = value + 1;
+            else if (strict)
+                low = 1, high = 0;
+        }
+        else
+        {
+            return query_fail(parser, "Expected =, !=, <, <=, >, >= or between", NULL);
+        }
 
-    // Edge cases
-    assert(validate_test_type(NULL) == 0);
-    assert(validate_test_type("   ") == 0);     // Only whitespace
-    assert(validate_test_type("  ABC  ") == 1); // Should trim and pass
+        QueryNode *node = query_node(query_eval_id, NULL, NULL);
+        if (!node)
+            return query_fail(parser, "Out of memory", NULL);
+        node->low = low;
+        node->high = high;
+        return negate ? query_node(query_eval_not, node, NULL) : node;
+    }
 
-    printf("✓ validate_test_type tests passed\n");
+    snprintf(parser->error, parser->error_size,
+             "Unknown field '%s' (use id, system, type, result, active or deleted)", field);
+    return NULL;
+}
 
-    // Test validate_test_id function
-    printf("Testing validate_test_id...\n");
+QueryNode *query_parse_unary(QueryParser *parser)
+{
+    if (query_token_is(parser, "not"))
+    {
+        if (!query_next_token(parser))
+            return NULL;
+        QueryNode *operand = query_parse_unary(parser);
+        return operand ? query_node(query_eval_not, operand, NULL) : NULL;
+    }
 
-    // Valid test IDs
-    assert(validate_test_id("1") == 1);
-    assert(validate_test_id("123") == 1);
-    assert(validate_test_id("999999") == 1);
-    assert(validate_test_id("  123  ") == 1); // Should trim and pass
+    if (query_token_is(parser, "("))
+    {
+        if (!query_next_token(parser))
+            return NULL;
+        QueryNode *inner = query_parse_or(parser);
+        if (!inner)
+            return NULL;
+        if (!query_token_is(parser, ")"))
+            return query_fail(parser, "Expected ')'", inner);
+        return query_next_token(parser) ? inner : query_fail(parser, "", inner);
+    }
 
-    // Invalid test IDs - zero or negative
-    assert(validate_test_id("0") == 0);
-    assert(validate_test_id("-1") == 0);
-    assert(validate_test_id("-123") == 0);
+    return query_parse_comparison(parser);
+}
 
-    // Invalid test IDs - non-numeric
-    assert(validate_test_id("ABC") == 0);
-    assert(validate_test_id("12A") == 0);
-    assert(validate_test_id("A123") == 0);
-    assert(validate_test_id("12.34") == 0);
-    assert(validate_test_id("12-34") == 0);
-    assert(validate_test_id("12 34") == 0);
-    assert(validate_test_id("") == 0);
+QueryNode *query_parse_and(QueryParser *parser)
+{
+    QueryNode *left = query_parse_unary(parser);
+    while (left && query_token_is(parser, "and"))
+    {
+        if (!query_next_token(parser))
+            return query_fail(parser, "", left);
+        QueryNode *right = query_parse_unary(parser);
+        if (!right)
+            return query_fail(parser, "", left);
+        left = query_node(query_eval_and, left, right);
+    }
+    return left;
+}
 
-    // Edge cases
-    assert(validate_test_id(NULL) == 0);
-    assert(validate_test_id("   ") == 0); // Only whitespace
+QueryNode *query_parse_or(QueryParser *parser)
+{
+    QueryNode *left = query_parse_and(parser);
+    while (left && query_token_is(parser, "or"))
+    {
+        if (!query_next_token(parser))
+            return query_fail(parser, "", left);
+        QueryNode *right = query_parse_and(parser);
+        if (!right)
+            return query_fail(parser, "", left);
+        left = query_node(query_eval_or, left, right);
+    }
+    return left;
+}
 
-    printf("✓ validate_test_id tests passed\n");
+// Parses text such as: system~"API" and result in (Failed,Pending) and id between 100 and 5000 and active
+// Returns the tree (free with query_free), or NULL with a message in error.
+QueryNode *query_compile(const char *text, char *error, size_t error_size)
+{
+    QueryParser parser = {0};
+    parser.text = text;
+    parser.error = error;
+    parser.error_size = error_size;
+    error[0] = '\0';
 
-    // Test trim_string function
-    printf("Testing trim_string...\n");
+    if (!query_next_token(&parser))
+        return NULL;
+    if (parser.type == QUERY_END)
+    {
+        snprintf(error, error_size, "Empty filter");
+        return NULL;
+    }
 
-    char test_str1[] = "  hello  ";
-    char *result1 = trim_string(test_str1);
-    assert(strcmp(result1, "hello") == 0);
+    QueryNode *query = query_parse_or(&parser);
+    if (query && parser.type != QUERY_END)
+        return query_fail(&parser, "Unexpected token", query);
+    if (!query && error[0] == '\0')
+        snprintf(error, error_size, "Out of memory");
+    return query;
+}
 
-    char test_str2[] = "hello";
-    char *result2 = trim_string(test_str2);
-    assert(strcmp(result2, "hello") == 0);
+// True when only active rows can match, so the scan can skip deleted ones
+int query_requires_active(const QueryNode *node)
+{
+    if (node->eval == query_eval_active)
+        return 1;
+    if (node->eval == query_eval_and)
+        return query_requires_active(node->left) || query_requires_active(node->right);
+    if (node->eval == query_eval_or)
+        return query_requires_active(node->left) && query_requires_active(node->right);
+    return 0;
+}
 
-    char test_str3[] = "  hello";
-    char *result3 = trim_string(test_str3);
-    assert(strcmp(result3, "hello") == 0);
+// Fills results (room for db.count rows) with the matching rows in row order, in one pass
+int query_select(const QueryNode *query, RowSet *results)
+{
+    results->count = 0;
+    if (query_requires_active(query))
+    {
+        for (int row = database_next_row(0, 1); row >= 0; row = database_next_row(row + 1, 1))
+        {
+            if (query->eval(query, row))
+                results->rows[results->count++] = (uint32_t)row;
+        }
+        return results->count;
+    }
 
-    char test_str4[] = "hello  ";
-    char *result4 = trim_string(test_str4);
-    assert(strcmp(result4, "hello") == 0);
+    for (int row = 0; row < db.count; row++)
+    {
+        if (query->eval(query, row))
+            results->rows[results->count++] = (uint32_t)row;
+    }
+    return results->count;
+}
 
-    char test_str5[] = "   ";
-    char *result5 = trim_string(test_str5);
-    assert(strcmp(result5, "") == 0);
+uint32_t id_index_home(int test_id, uint32_t slot_count)
+{
+    return ((uint32_t)test_id * 2654435761u) & (slot_count - 1);
+}
 
-    char test_str6[] = "";
-    char *result6 = trim_string(test_str6);
-    assert(strcmp(result6, "") == 0);
+void id_index_free(void)
+{
+    free(db.ids.direct);
+    free(db.ids.slots);
+    memset(&db.ids, 0, sizeof(db.ids));
+}
 
-    // Test NULL input
-    assert(trim_string(NULL) == NULL);
+// Picks the layout from the ID range: a direct array while at least about
+// half of its entries would be used, otherwise the hash table
+int id_index_build(void)
+{
+    id_index_free();
+    if (db.count == 0)
+        return 1;
 
-    printf("✓ trim_string tests passed\n");
+    int min_id = db.test_ids[0];
+    int max_id = db.test_ids[0];
+    for (int i = 1; i < db.count; i++)
+    {
+        if (db.test_ids[i] < min_id)
+            min_id = db.test_ids[i];
+        if (db.test_ids[i] > max_id)
+            max_id = db.test_ids[i];
+    }
 
-    // Test string_to_test_result function
-    printf("Testing string_to_test_result...\n");
+    long long span = (long long)max_id - min_id + 1;
+    if (span <= 2LL * db.count + INITIAL_CAPACITY)
+    {
+        db.ids.direct = calloc((size_t)span, sizeof(int));
+        if (!db.ids.direct)
+            return 0;
+        db.ids.base = min_id;
+        db.ids.span = (int)span;
+    }
+    else
+    {
+        uint32_t slot_count = 16;
+        while (slot_count < 2u * (uint32_t)db.count)
+            slot_count *= 2;
+        db.ids.slots = calloc(slot_count, sizeof(uint64_t));
+        if (!db.ids.slots)
+            return 0;
+        db.ids.slot_count = slot_count;
+        db.ids.sparse = 1;
+    }
 
-    assert(string_to_test_result("Failed") == FAILED);
-    assert(string_to_test_result("failed") == FAILED);
-    assert(string_to_test_result("FAILED") == FAILED);
-    assert(string_to_test_result("Passed") == PASSED);
-    assert(string_to_test_result("passed") == PASSED);
-    assert(string_to_test_result("PASSED") == PASSED);
+    for (int i = 0; i < db.count; i++)
+    {
+        if (!id_index_insert(db.test_ids[i], i))
+        {
+            id_index_free();
+            return 0;
+        }
+    }
+    db.ids.rows = db.count;
+    return 1;
+}
+
+// Brings the index up to db.count; returns 0 if it could not be allocated
+int id_index_sync(void)
+{
+    if (db.ids.rows == 0 || db.ids.rows > db.count)
+        return id_index_build();
+
+    // Count each row as it goes in: a move to the hash table re-enters [0, rows)
+    for (int i = db.ids.rows; i < db.count; i++)
+    {
+        if (!id_index_insert(db.test_ids[i], i))
+        {
+            id_index_free();
+            return 0;
+        }
+        db.ids.rows = i + 1;
+    }
+    return 1;
+}
+
+int id_index_lookup(int test_id)
+{
+    if (!db.ids.sparse)
+    {
+        long long offset = (long long)test_id - db.ids.base;
+        if (offset < 0 || offset >= db.ids.span)
+            return -1;
+        return db.ids.direct[offset] - 1;
+    }
+
+    if (db.ids.slot_count == 0)
+        return -1;
+    uint32_t mask = db.ids.slot_count - 1;
+    for (uint32_t i = id_index_home(test_id, db.ids.slot_count);; i = (i + 1) & mask)
+    {
+        uint64_t slot = db.ids.slots[i];
+        if (slot == 0)
+            return -1;
+        if ((int)(uint32_t)(slot >> 32) == test_id)
+            return (int)(uint32_t)slot - 1;
+    }
+}
+
+// Points test_id at row, which must already have an entry or room for one
+void id_index_set(int test_id, int row)
+{
+    if (!db.ids.sparse)
+    {
+        db.ids.direct[test_id - db.ids.base] = row + 1;
+        return;
+    }
+
+    uint32_t mask = db.ids.slot_count - 1;
+    uint32_t i = id_index_home(test_id, db.ids.slot_count);
+    while (db.ids.slots[i] != 0 && (int)(uint32_t)(db.ids.slots[i] >> 32) != test_id)
+        i = (i + 1) & mask;
+    if (db.ids.slots[i] == 0)
+        db.ids.used++;
+    db.ids.slots[i] = (uint64_t)(uint32_t)test_id << 32 | (uint32_t)(row + 1);
+}
+
+void id_index_erase(int test_id)
+{
+    if (!db.ids.sparse)
+    {
+        long long offset = (long long)test_id - db.ids.base;
+        if (offset >= 0 && offset < db.ids.span)
+            db.ids.direct[offset] = 0;
+        return;
+    }
+
+    uint32_t mask = db.ids.slot_count - 1;
+    uint32_t i = id_index_home(test_id, db.ids.slot_count);
+    while (db.ids.slots[i] != 0 && (int)(uint32_t)(db.ids.slots[i] >> 32) != test_id)
+        i = (i + 1) & mask;
+    if (db.ids.slots[i] == 0)
+        return;
+
+    // Backward-shift deletion keeps every probe chain unbroken
+    db.ids.slots[i] = 0;
+    db.ids.used--;
+    for (uint32_t j = (i + 1) & mask; db.ids.slots[j] != 0; j = (j + 1) & mask)
+    {
+        uint32_t home = id_index_home((int)(uint32_t)(db.ids.slots[j] >> 32), db.ids.slot_count);
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+            db.ids.slots[i] = db.ids.slots[j];
+            db.ids.slots[j] = 0;
+            i = j;
+        }
+    }
+}
+
+// Widens the direct array to cover test_id, or moves to the hash table if
+// that would leave it mostly empty
+int id_index_grow_direct(int test_id)
+{
+    long long low = db.ids.span > 0 && db.ids.base < test_id ? db.ids.base : test_id;
+    long long high = db.ids.span > 0 && db.ids.base + (long long)db.ids.span - 1 > test_id
+                         ? db.ids.base + (long long)db.ids.span - 1
+                         : test_id;
+    if (high - low + 1 > 2LL * (db.ids.rows + 1) + INITIAL_CAPACITY)
+    {
+        // Re-enter every indexed row in a table sized for them
+        int rows = db.ids.rows;
+        id_index_free();
+        db.ids.sparse = 1;
+        db.ids.rows = rows;
+        for (int i = 0; i < rows; i++)
+        {
+            if (!id_index_insert(db.test_ids[i], i))
+                return 0;
+        }
+        return 1;
+    }
+
+    // Leave headroom above the range so ascending IDs grow amortised O(1)
+    long long span = high - low + 1;
+    if (test_id > low && span < 2LL * db.ids.span)
+        span = 2LL * db.ids.span;
+    if (span < INITIAL_CAPACITY)
+        span = INITIAL_CAPACITY;
+    if (low + span - 1 > INT_MAX)
+        span = (long long)INT_MAX - low + 1;
+
+    int *direct = calloc((size_t)span, sizeof(int));
+    if (!direct)
+        return 0;
+    if (db.ids.span > 0)
+        memcpy(direct + (db.ids.base - low), db.ids.direct, (size_t)db.ids.span * sizeof(int));
+    free(db.ids.direct);
+    db.ids.direct = direct;
+    db.ids.base = (int)low;
+    db.ids.span = (int)span;
+    return 1;
+}
+
+int id_index_grow_slots(void)
+{
+    uint32_t old_count = db.ids.slot_count;
+    uint64_t *old_slots = db.ids.slots;
+    uint32_t slot_count = old_count > 0 ? old_count * 2 : 16;
+    uint64_t *slots = calloc(slot_count, sizeof(uint64_t));
+    if (!slots)
+        return 0;
+
+    db.ids.slots = slots;
+    db.ids.slot_count = slot_count;
+    db.ids.used = 0;
+    for (uint32_t i = 0; i < old_count; i++)
+    {
+        if (old_slots[i])
+            id_index_set((int)(uint32_t)(old_slots[i] >> 32), (int)(uint32_t)old_slots[i] - 1);
+    }
+    free(old_slots);
+    return 1;
+}
+
+// Adds test_id unless an earlier row already has it
+int id_index_insert(int test_id, int row)
+{
+    if (!db.ids.sparse)
+    {
+        long long offset = (long long)test_id - db.ids.base;
+        if (db.ids.span == 0 || offset < 0 || offset >= db.ids.span)
+        {
+            if (!id_index_grow_direct(test_id))
+                return 0;
+            if (db.ids.sparse)
+                return id_index_insert(test_id, row);
+            offset = (long long)test_id - db.ids.base;
+        }
+        if (db.ids.direct[offset] == 0)
+            db.ids.direct[offset] = row + 1;
+        return 1;
+    }
+
+    if (id_index_lookup(test_id) >= 0)
+        return 1;
+    if ((db.ids.used + 1) * 2 > db.ids.slot_count && !id_index_grow_slots())
+        return 0;
+    id_index_set(test_id, row);
+    return 1;
+}
+
+// Called after database_remove_record() shifted rows index.. down by one
+void id_index_remove_row(int index, int removed_id)
+{
+    if (index >= db.ids.rows)
+        return;
+
+    if (id_index_lookup(removed_id) == index)
+        id_index_erase(removed_id);
+    db.ids.rows--;
+
+    // Rows that moved were at r + 1; a missing entry is a later duplicate of removed_id
+    for (int r = index; r < db.ids.rows; r++)
+    {
+        int current = id_index_lookup(db.test_ids[r]);
+        if (current == r + 1 || current == -1)
+            id_index_set(db.test_ids[r], r);
+    }
+
+    if (db.ids.rows == 0)
+        id_index_free(); // rows == 0 means rebuild; drop the now empty tables
+}
+
+char *database_store_string(const char *str, size_t len)
+{
+    StringBlock *block = db.strings;
+    if (!block || block->size - block->used < len + 1)
+    {
+        size_t size = len + 1 > STRING_BLOCK_SIZE ? len + 1 : STRING_BLOCK_SIZE;
+        block = malloc(sizeof(StringBlock) + size);
+        if (!block)
+            return NULL;
+        block->next = db.strings;
+        block->used = 0;
+        block->size = size;
+        db.strings = block;
+    }
+
+    char *copy = block->data + block->used;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    block->used += len + 1;
+    return copy;
+}
+
+int rowset_init(RowSet *set, int capacity)
+{
+    set->rows = malloc((size_t)(capacity > 0 ? capacity : 1) * sizeof(uint32_t));
+    set->count = 0;
+    return set->rows != NULL;
+}
+
+void rowset_free(RowSet *set)
+{
+    free(set->rows);
+    set->rows = NULL;
+    set->count = 0;
+}
+
+void database_reset(void)
+{
+    // Pending changes stay in the journal and are replayed by the next load
+    journal_close();
+    if (!db.columns_mapped)
+    {
+        free(db.test_ids);
+        free(db.system_codes);
+        free(db.type_codes);
+        free(db.results);
+        free(db.active_bits);
+    }
+    while (db.strings)
+    {
+        StringBlock *next = db.strings->next;
+        free(db.strings);
+        db.strings = next;
+    }
+    dictionary_free(&db.systems);
+    dictionary_free(&db.types);
+    id_index_free();
+    trigram_free(&db.system_grams);
+    trigram_free(&db.type_grams);
+    trigram_free(&db.id_grams);
+    stats_free();
+    if (db.snapshot)
+        unmap_snapshot_file(db.snapshot, db.snapshot_size);
+    memset(&db, 0, sizeof(db));
+}
+
+uint32_t dictionary_hash(const char *str, size_t len)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t dictionary_find(const StringDictionary *dict, const char *str, size_t len)
+{
+    if (dict->slot_count == 0)
+        return INVALID_CODE;
+
+    // The hash lives in the slot so probing stays inside one array
+    uint32_t hash = dictionary_hash(str, len);
+    for (uint32_t slot = hash & (dict->slot_count - 1);; slot = (slot + 1) & (dict->slot_count - 1))
+    {
+        uint64_t entry = dict->slots[slot];
+        if (entry == 0)
+            return INVALID_CODE;
+
+        uint32_t code = (uint32_t)entry - 1;
+        if ((uint32_t)(entry >> 32) == hash && dict->lengths[code] == len && memcmp(dict->strings[code], str, len) == 0)
+            return code;
+    }
+}
+
+uint32_t dictionary_intern(StringDictionary *dict, const char *str, size_t len)
+{
+    uint32_t code = dictionary_find(dict, str, len);
+    if (code != INVALID_CODE)
+        return code;
+
+    // Keep the table at most half full
+    if ((dict->count + 1) * 2 > dict->slot_count)
+    {
+        uint32_t slot_count = dict->slot_count ? dict->slot_count * 2 : 64;
+        uint64_t *slots = calloc(slot_count, sizeof(uint64_t));
+        if (!slots)
+            return INVALID_CODE;
+        for (uint32_t i = 0; i < dict->count; i++)
+        {
+            uint32_t slot = dict->hashes[i] & (slot_count - 1);
+            while (slots[slot])
+                slot = (slot + 1) & (slot_count - 1);
+            slots[slot] = (uint64_t)dict->hashes[i] << 32 | (i + 1);
+        }
+        free(dict->slots);
+        dict->slots = slots;
+        dict->slot_count = slot_count;
+    }
+
+    if (dict->count >= dict->capacity)
+    {
+        uint32_t capacity = dict->capacity ? dict->capacity * 2 : 32;
+        const char **strings = realloc(dict->strings, capacity * sizeof(*strings));
+        if (!strings)
+            return INVALID_CODE;
+        dict->strings = strings;
+        uint32_t *lengths = realloc(dict->lengths, capacity * sizeof(uint32_t));
+        if (!lengths)
+            return INVALID_CODE;
+        dict->lengths = lengths;
+        uint32_t *hashes = realloc(dict->hashes, capacity * sizeof(uint32_t));
+        if (!hashes)
+            return INVALID_CODE;
+        dict->hashes = hashes;
+        dict->capacity = capacity;
+    }
+
+    const char *stored = dict->borrows_strings ? str : database_store_string(str, len);
+    if (!stored)
+        return INVALID_CODE;
+
+    code = dict->count++;
+    dict->strings[code] = stored;
+    dict->lengths[code] = (uint32_t)len;
+    dict->hashes[code] = dictionary_hash(str, len);
+
+    uint32_t slot = dict->hashes[code] & (dict->slot_count - 1);
+    while (dict->slots[slot])
+        slot = (slot + 1) & (dict->slot_count - 1);
+    dict->slots[slot] = (uint64_t)dict->hashes[code] << 32 | (code + 1);
+    return code;
+}
+
+void dictionary_free(StringDictionary *dict)
+{
+    free(dict->strings);
+    free(dict->lengths);
+    free(dict->hashes);
+    free(dict->slots);
+    memset(dict, 0, sizeof(*dict));
+}
+
+uint8_t *dictionary_match(const StringDictionary *dict, TrigramIndex *grams, const char *term)
+{
+    uint8_t *hits = calloc(dict->count + 1, 1);
+    if (!hits)
+        return NULL;
+
+    // Only entries sharing every trigram of the term can contain it
+    size_t term_len = strlen(term);
+    uint32_t *candidates;
+    uint32_t candidate_count;
+    if (use_search_index && trigram_sync_dictionary(grams, dict) &&
+        trigram_candidates(grams, term, &candidates, &candidate_count))
+    {
+        for (uint32_t i = 0; i < candidate_count; i++)
+        {
+            uint32_t code = candidates[i];
+            hits[code] = find_substring_ci(dict->strings[code], dict->lengths[code], term, term_len) != NULL;
+        }
+        free(candidates);
+        return hits;
+    }
+
+    for (uint32_t code = 0; code < dict->count; code++)
+    {
+        hits[code] = find_substring_ci(dict->strings[code], dict->lengths[code], term, term_len) != NULL;
+    }
+    return hits;
+}
+
+const char *record_system_name(const TestRecord *record)
+{
+    return db.systems.strings[record->system_code];
+}
+
+const char *record_test_type(const TestRecord *record)
+{
+    return db.types.strings[record->type_code];
+}
+
+TestRecord make_record(int test_id, const char *system_name, const char *test_type, TestResult result, int active)
+{
+    TestRecord record = {0};
+    record.test_id = test_id;
+    record.system_code = dictionary_intern(&db.systems, system_name, strlen(system_name));
+    record.type_code = dictionary_intern(&db.types, test_type, strlen(test_type));
+    record.test_result = (int8_t)result;
+    record.active = active != 0;
+    return record;
+}
+
+int split_csv_fields(char *line, char *fields[], int max_fields)
+{
+    // Same semantics as repeated strtok(..., ","): empty fields are skipped
+    int count = 0;
+    char *p = line;
+
+    while (count < max_fields)
+    {
+        while (*p == ',')
+            p++;
+        if (*p == '\0')
+            break;
+
+        fields[count++] = p;
+        p += strcspn(p, ",");
+        if (*p == '\0')
+            break;
+        *p++ = '\0';
+    }
+
+    return count;
+}
+
+// Unlike split_csv_fields every comma separates, so empty names survive:
+// "U,2,3,System,,Failed,1" is seven fields. Returns max_fields + 1 if there are more
+int split_journal_fields(char *line, char *fields[], int max_fields)
+{
+    int count = 0;
+    char *p = line;
+
+    while (count < max_fields)
+    {
+        fields[count++] = p;
+        p += strcspn(p, ",");
+        if (*p == '\0')
+            return count;
+        *p++ = '\0';
+    }
+
+    return max_fields + 1;
+}
+
+uint64_t structural_mask_scalar(const char *block)
+{
+    uint64_t mask = 0;
+    for (int i = 0; i < SCAN_BLOCK; i++)
+    {
+        char c = block[i];
+        if (c == ',' || c == '\n' || c == '\r' || c == '\0')
+            mask |= 1ULL << i;
+    }
+    return mask;
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("sse2")))
+uint64_t structural_mask_sse2(const char *block)
+{
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriage = _mm_set1_epi8('\r');
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t mask = 0;
+
+    for (int i = 0; i < SCAN_BLOCK; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(block + i));
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, comma), _mm_cmpeq_epi8(v, newline)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(v, carriage), _mm_cmpeq_epi8(v, zero)));
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(hit) << i;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+uint64_t structural_mask_avx2(const char *block)
+{
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i carriage = _mm256_set1_epi8('\r');
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t mask = 0;
+
+    for (int i = 0; i < SCAN_BLOCK; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(block + i));
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, comma), _mm256_cmpeq_epi8(v, newline)),
+                                      _mm256_or_si256(_mm256_cmpeq_epi8(v, carriage), _mm256_cmpeq_epi8(v, zero)));
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(hit) << i;
+    }
+    return mask;
+}
+#endif
+
+void init_structural_scanner(void)
+{
+    if (structural_mask)
+        return;
+
+    const char *forced = getenv("TDM_SIMD");
+    structural_mask = structural_mask_scalar;
+    structural_kernel_name = "scalar";
+    if (forced && strcmp(forced, "scalar") == 0)
+        return;
+
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && !(forced && strcmp(forced, "sse2") == 0))
+    {
+        structural_mask = structural_mask_avx2;
+        structural_kernel_name = "avx2";
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        structural_mask = structural_mask_sse2;
+        structural_kernel_name = "sse2";
+    }
+#endif
+}
+
+uint64_t scanner_block_mask(const char *block, const char *end)
+{
+    if (end - block >= SCAN_BLOCK)
+        return structural_mask(block);
+
+    // Never read past end: another loader thread may own those bytes
+    char padded[SCAN_BLOCK] = {0};
+    size_t len = (size_t)(end - block);
+    memcpy(padded, block, len);
+    return structural_mask(padded) & ((1ULL << len) - 1);
+}
+
+void scanner_init(StructuralScanner *scanner, const char *begin, const char *end)
+{
+    init_structural_scanner();
+    scanner->block = begin;
+    scanner->end = end;
+    scanner->mask = begin < end ? scanner_block_mask(begin, end) : 0;
+}
+
+const char *scanner_next(StructuralScanner *scanner)
+{
+    while (scanner->mask == 0)
+    {
+        scanner->block += SCAN_BLOCK;
+        if (scanner->block >= scanner->end)
+            return scanner->end;
+        scanner->mask = scanner_block_mask(scanner->block, scanner->end);
+    }
+
+    int bit = __builtin_ctzll(scanner->mask);
+    scanner->mask &= scanner->mask - 1;
+    return scanner->block + bit;
+}
+
+char *scan_record_fields(StructuralScanner *scanner, char *line, char *fields[], int *field_count)
+{
+    // Same fields as parse_record_line: strtok semantics, content ends at the
+    // first CR or NUL, and the newline (or end) finishes the line
+    char *field = line;
+    int count = 0;
+    int in_content = 1;
+
+    while (1)
+    {
+        char *stop = (char *)scanner_next(scanner);
+        char c = stop < scanner->end ? *stop : '\n';
+
+        if (in_content && stop > field && count < RECORD_FIELDS)
+        {
+            fields[count++] = field;
+            if (stop < scanner->end)
+                *stop = '\0';
+        }
+
+        if (c == '\n')
+        {
+            *field_count = count;
+            return stop < scanner->end ? stop + 1 : stop;
+        }
+
+        if (c == ',')
+            field = stop + 1;
+        else
+            in_content = 0;
+    }
+}
+
+int parse_record_line(char *line, TestRecord *record, const char **bad_result)
+{
+    line[strcspn(line, "\n\r")] = '\0';
+
+    char *fields[RECORD_FIELDS];
+    int field_count = split_csv_fields(line, fields, RECORD_FIELDS);
+    return fill_record_fields(record, fields, field_count, &db.systems, &db.types, bad_result);
+}
+
+// Returns 1 for a record, 0 for a skipped line and -1 if interning ran out of memory
+int fill_record_fields(TestRecord *record, char *fields[], int field_count,
+                       StringDictionary *systems, StringDictionary *types, const char **bad_result)
+{
+    int test_id = field_count > 0 ? atoi(fields[0]) : 0;
+    if (test_id <= 0)
+        return 0;
+
+    memset(record, 0, sizeof(*record));
+    record->test_id = test_id;
+
+    const char *system_name = field_count > 1 ? fields[1] : "";
+    const char *test_type = field_count > 2 ? fields[2] : "";
+    record->system_code = dictionary_intern(systems, system_name, strlen(system_name));
+    record->type_code = dictionary_intern(types, test_type, strlen(test_type));
+    if (record->system_code == INVALID_CODE || record->type_code == INVALID_CODE)
+        return -1;
+
+    if (field_count > 3)
+    {
+        TestResult result = string_to_test_result(fields[3]);
+        if (result == INVALID_RESULT)
+        {
+            // Worker threads defer the warning so output keeps file order
+            if (bad_result)
+                *bad_result = fields[3];
+            else
+                fprintf(diagnostic_stream(), "Warning: Invalid test result '%s' in record %d, defaulting to PENDING\n",
+                        fields[3], record->test_id);
+            record->test_result = PENDING;
+        }
+        else
+        {
+            record->test_result = result;
+        }
+    }
+
+    if (field_count > 4)
+    {
+        char *endptr;
+        long val = strtol(fields[4], &endptr, 10);
+        if (*endptr == '\0')
+        {
+            record->active = val != 0;
+        }
+        else
+        {
+            record->active = 0;
+        }
+    }
+
+    return 1;
+}
+
+int load_database(const char *filename)
+{
+    uint64_t start = now_ns();
+    TRACE_BEGIN("load_database");
+    TRACE_BEGIN("parse");
+    int snapshot = is_snapshot_file(filename);
+    int ok = snapshot                    ? load_database_snapshot(filename)
+             : is_archive_file(filename) ? load_database_archive(filename)
+                                         : (use_mapped_loader && load_database_mapped(filename)) ||
+                                               load_database_buffered(filename);
+    TRACE_END("parse");
+
+    TRACE_BEGIN("journal_replay");
+    if (ok && !journal_replay())
+    {
+        fprintf(diagnostic_stream(), "Error: Unable to allocate memory for journal entries.\n");
+        database_reset();
+        ok = 0;
+    }
+    TRACE_END("journal_replay");
+
+    // Without memory for it the Statistics screen counts on demand instead.
+    // Snapshots always do, so opening one never walks the rows.
+    TRACE_BEGIN("stats_rebuild");
+    if (ok && !snapshot)
+        stats_rebuild();
+    TRACE_END("stats_rebuild");
+    if (ok)
+        metrics.bytes_read += (uint64_t)file_size_or_zero(filename) + (uint64_t)db.journal_bytes;
+    metrics_record(METRIC_LOAD, start);
+    TRACE_END("load_database");
+    return ok;
+}
+
+#ifdef _WIN32
+int load_database_mapped(const char *filename)
+{
+    (void)filename;
+    return 0;
+}
+#else
+int get_load_thread_count(size_t size)
+{
+    if (size < PARALLEL_LOAD_MIN_BYTES)
+        return 1;
+
+    long threads = load_threads > 0 ? load_threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_LOAD_THREADS)
+        threads = MAX_LOAD_THREADS;
+
+    // Keep at least one parallel threshold worth of bytes per thread
+    long by_size = (long)(size / (PARALLEL_LOAD_MIN_BYTES / 2));
+    return (int)(threads < by_size ? threads : by_size);
+}
+
+int parse_load_chunk(LoadChunk *chunk)
+{
+    // Every line in [begin, end) is newline-terminated
+    size_t estimate = (size_t)(chunk->end - chunk->begin) / 32 + 16;
+    chunk->records = malloc(estimate * sizeof(TestRecord));
+    if (!chunk->records)
+    {
+        chunk->failed = 1;
+        return 0;
+    }
+    chunk->capacity = (int)estimate;
+
+    StructuralScanner scanner;
+    scanner_init(&scanner, chunk->begin, chunk->end);
+
+    char *p = chunk->begin;
+    while (p < chunk->end)
+    {
+        char *fields[RECORD_FIELDS];
+        int field_count;
+        p = scan_record_fields(&scanner, p, fields, &field_count);
+
+        if (chunk->count >= chunk->capacity)
+        {
+            TestRecord *grown = realloc(chunk->records, (size_t)chunk->capacity * 2 * sizeof(TestRecord));
+            if (!grown)
+            {
+                chunk->failed = 1;
+                return 0;
+            }
+            chunk->records = grown;
+            chunk->capacity *= 2;
+        }
+
+        TestRecord *record = &chunk->records[chunk->count];
+        const char *bad_result = NULL;
+        int parsed = fill_record_fields(record, fields, field_count, chunk->systems, chunk->types, &bad_result);
+        if (parsed < 0)
+        {
+            chunk->failed = 1;
+            return 0;
+        }
+        if (parsed == 0)
+            continue;
+
+        if (bad_result)
+        {
+            if (chunk->warning_count >= chunk->warning_capacity)
+            {
+                int capacity = chunk->warning_capacity ? chunk->warning_capacity * 2 : 16;
+                LoadWarning *grown = realloc(chunk->warnings, (size_t)capacity * sizeof(LoadWarning));
+                if (!grown)
+                {
+                    chunk->failed = 1;
+                    return 0;
+                }
+                chunk->warnings = grown;
+                chunk->warning_capacity = capacity;
+            }
+            chunk->warnings[chunk->warning_count].test_id = record->test_id;
+            chunk->warnings[chunk->warning_count].token = bad_result;
+            chunk->warning_count++;
+        }
+
+        if (record->test_id > chunk->max_id)
+        {
+            chunk->max_id = record->test_id;
+        }
+
+        chunk->count++;
+    }
+
+    return 1;
+}
+
+void *load_chunk_worker(void *arg)
+{
+    TRACE_BEGIN("parse_chunk");
+    parse_load_chunk(arg);
+    TRACE_END("parse_chunk");
+    return NULL;
+}
+
+void *stitch_chunk_worker(void *arg)
+{
+    // Scatter rows into the columns, translating chunk-local codes to db codes
+    TRACE_BEGIN("stitch_chunk");
+    LoadChunk *chunk = arg;
+    int first = chunk->offset;
+    int end = chunk->offset + chunk->count;
+    uint64_t word = 0;
+    for (int i = 0; i < chunk->count; i++)
+    {
+        TestRecord record = chunk->records[i];
+        if (chunk->system_map)
+        {
+            record.system_code = chunk->system_map[record.system_code];
+            record.type_code = chunk->type_map[record.type_code];
+        }
+
+        int row = first + i;
+        db.test_ids[row] = record.test_id;
+        db.system_codes[row] = record.system_code;
+        db.type_codes[row] = record.type_code;
+        db.results[row] = record.test_result;
+
+        // Active bits go out a word at a time; words shared with the
+        // neighbouring chunk are merged atomically
+        word |= (uint64_t)record.active << (row & 63);
+        if ((row & 63) == 63 || row == end - 1)
+        {
+            int word_start = row & ~63;
+            if (word_start >= first && word_start + 64 <= end)
+                db.active_bits[row >> 6] = word;
+            else
+                __atomic_fetch_or(&db.active_bits[row >> 6], word, __ATOMIC_RELAXED);
+            word = 0;
+        }
+    }
+    TRACE_END("stitch_chunk");
+    return NULL;
+}
+
+// Interns a chunk's local strings into dest and returns the code translation
+uint32_t *merge_chunk_dictionary(StringDictionary *dest, const StringDictionary *local)
+{
+    uint32_t *map = malloc((local->count + 1) * sizeof(uint32_t));
+    if (!map)
+        return NULL;
+
+    for (uint32_t code = 0; code < local->count; code++)
+    {
+        map[code] = dictionary_intern(dest, local->strings[code], local->lengths[code]);
+        if (map[code] == INVALID_CODE)
+        {
+            free(map);
+            return NULL;
+        }
+    }
+    return map;
+}
+
+// Runs worker over every chunk (an array of chunk_size-byte items), on the
+// calling thread when there is only one
+void run_chunk_workers(void *chunks, size_t chunk_size, int chunk_count, void *(*worker)(void *))
+{
+    pthread_t threads[MAX_LOAD_THREADS];
+    char *items = chunks;
+    int started = 0;
+
+    for (int i = 1; i < chunk_count; i++)
+    {
+        if (pthread_create(&threads[i], NULL, worker, items + i * chunk_size) != 0)
+            break;
+        started = i;
+    }
+    worker(items);
+    for (int i = 1; i <= started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Finish anything a failed pthread_create left behind
+    for (int i = started + 1; i < chunk_count; i++)
+    {
+        worker(items + i * chunk_size);
+    }
+}
+
+int load_database_mapped(const char *filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    // Private writable mapping: fields are NUL-terminated in place and the
+    // changes never reach the file on disk. Only the dictionaries outlive it.
+    size_t size = (size_t)st.st_size;
+    char *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return 0;
+    madvise(data, size, MADV_SEQUENTIAL);
+    init_structural_scanner();
+
+    database_reset();
+
+    char *end = data + size;
+    char *body = memchr(data, '\n', size);
+    body = body ? body + 1 : end; // Skip header
+
+    // Unterminated last line has no room for a NUL inside the mapping
+    char *tail = NULL;
+    char *body_end = end;
+    if (body < end && end[-1] != '\n')
+    {
+        char *last_newline = memrchr(body, '\n', (size_t)(end - body));
+        body_end = last_newline ? last_newline + 1 : body;
+        tail = malloc((size_t)(end - body_end) + 1);
+        if (!tail)
+        {
+            munmap(data, size);
+            return 0;
+        }
+        memcpy(tail, body_end, (size_t)(end - body_end));
+        tail[end - body_end] = '\0';
+    }
+
+    // Split the body into newline-aligned chunks
+    LoadChunk chunks[MAX_LOAD_THREADS];
+    memset(chunks, 0, sizeof(chunks));
+    int chunk_count = get_load_thread_count((size_t)(body_end - body));
+    size_t body_size = (size_t)(body_end - body);
+    char *chunk_start = body;
+
+    for (int i = 0; i < chunk_count; i++)
+    {
+        char *chunk_end = body_end;
+        if (i < chunk_count - 1)
+        {
+            chunk_end = body + body_size / (size_t)chunk_count * (size_t)(i + 1);
+            if (chunk_end < chunk_start)
+                chunk_end = chunk_start;
+            char *newline = memchr(chunk_end, '\n', (size_t)(body_end - chunk_end));
+            chunk_end = newline ? newline + 1 : body_end;
+        }
+        chunks[i].begin = chunk_start;
+        chunks[i].end = chunk_end;
+        chunk_start = chunk_end;
+
+        // A lone chunk interns straight into the database; parallel chunks
+        // keep private dictionaries that are merged below
+        if (chunk_count == 1)
+        {
+            chunks[i].systems = &db.systems;
+            chunks[i].types = &db.types;
+        }
+        else
+        {
+            chunks[i].local_systems.borrows_strings = 1;
+            chunks[i].local_types.borrows_strings = 1;
+            chunks[i].systems = &chunks[i].local_systems;
+            chunks[i].types = &chunks[i].local_types;
+        }
+    }
+
+    run_chunk_workers(chunks, sizeof(LoadChunk), chunk_count, load_chunk_worker);
+
+    // Stitch chunks back in file order; next_id comes from the per-chunk maxima
+    int failed = 0;
+    long total = 0;
+    int max_id = 0;
+    for (int i = 0; i < chunk_count; i++)
+    {
+        failed |= chunks[i].failed;
+        chunks[i].offset = (int)total;
+        total += chunks[i].count;
+        if (chunks[i].max_id > max_id)
+            max_id = chunks[i].max_id;
+    }
+
+    if (!failed && total + 1 > INT_MAX)
+        failed = 1;
+
+    if (!failed && chunk_count > 1)
+    {
+        for (int i = 0; i < chunk_count && !failed; i++)
+        {
+            chunks[i].system_map = merge_chunk_dictionary(&db.systems, &chunks[i].local_systems);
+            chunks[i].type_map = merge_chunk_dictionary(&db.types, &chunks[i].local_types);
+            failed = !chunks[i].system_map || !chunks[i].type_map;
+        }
+    }
+
+    if (!failed)
+    {
+        if (database_reserve((int)total + 1))
+            run_chunk_workers(chunks, sizeof(LoadChunk), chunk_count, stitch_chunk_worker);
+        else
+            failed = 1;
+    }
+
+    for (int i = 0; i < chunk_count; i++)
+    {
+        for (int w = 0; !failed && w < chunks[i].warning_count; w++)
+        {
+            fprintf(diagnostic_stream(), "Warning: Invalid test result '%s' in record %d, defaulting to PENDING\n",
+                    chunks[i].warnings[w].token, chunks[i].warnings[w].test_id);
+        }
+        free(chunks[i].records);
+        free(chunks[i].warnings);
+        free(chunks[i].system_map);
+        free(chunks[i].type_map);
+        dictionary_free(&chunks[i].local_systems);
+        dictionary_free(&chunks[i].local_types);
+    }
+    munmap(data, size);
+
+    int count = (int)total;
+    if (!failed && tail)
+    {
+        TestRecord record;
+        int parsed = parse_record_line(tail, &record, NULL);
+        failed = parsed < 0;
+        if (parsed > 0)
+        {
+            if (record.test_id > max_id)
+                max_id = record.test_id;
+            database_set_record(count++, &record);
+        }
+    }
+    free(tail);
+
+    if (failed)
+    {
+        fprintf(diagnostic_stream(), "Error: Unable to allocate memory while loading %s.\n", filename);
+        database_reset();
+        return 0;
+    }
+
+    db.count = count;
+    db.next_id = max_id + 1;
+    strcpy(db.filename, filename);
+
+    return 1;
+}
+#endif
+
+int load_database_buffered(const char *filename)
+{
+    FILE *file = fopen(filename, "r");
+    if (!file)
+        return 0;
+
+    char line[MAX_LINE];
+    int count = 0;
+    int max_id = 0;
+
+    // Skip header
+    if (!fgets(line, sizeof(line), file))
+    {
+        fclose(file);
+        return 0;
+    }
+
+    database_reset();
+
+    // Read records
+    while (fgets(line, sizeof(line), file))
+    {
+        if (count >= db.capacity && !database_reserve(count + 1))
+        {
+            fprintf(diagnostic_stream(), "Error: Unable to allocate memory for %d records.\n", count + 1);
+            fclose(file);
+            database_reset();
+            return 0;
+        }
+
+        TestRecord record;
+        int parsed = parse_record_line(line, &record, NULL);
+        if (parsed < 0)
+        {
+            fprintf(diagnostic_stream(), "Error: Unable to allocate memory for record data.\n");
+            fclose(file);
+            database_reset();
+            return 0;
+        }
+        if (parsed == 0)
+            continue;
+
+        if (record.test_id > max_id)
+        {
+            max_id = record.test_id;
+        }
+
+        database_set_record(count++, &record);
+    }
+
+    fclose(file);
+    db.count = count;
+    db.next_id = max_id + 1;
+    strcpy(db.filename, filename);
+
+    return 1;
+}
+
+int save_database(void)
+{
+    uint64_t start = now_ns();
+    TRACE_BEGIN("save_database");
+    int ok = is_snapshot_file(db.filename)  ? write_database_snapshot(db.filename)
+             : is_archive_file(db.filename) ? write_database_archive(db.filename)
+                                            : write_database_csv(db.filename);
+    if (ok)
+        metrics.bytes_written += (uint64_t)file_size_or_zero(db.filename);
+    metrics_record(METRIC_SAVE, start);
+    TRACE_END("save_database");
+    return ok;
+}
+
+// Writes a sibling temp file and renames it over the CSV, so a crash or a full
+// disk leaves either the old file or the new one, never a truncated mix
+int write_database_csv(const char *path)
+{
+    char temp_path[MAX_PATH + sizeof(TEMP_SUFFIX)];
+    snprintf(temp_path, sizeof(temp_path), "%s%s", path, TEMP_SUFFIX);
+
+    FILE *file = fopen(temp_path, "w");
+    if (!file)
+        return 0;
+
+#ifndef _WIN32
+    // Keep the permissions of the file being replaced
+    struct stat info;
+    if (stat(path, &info) == 0)
+        fchmod(fileno(file), info.st_mode & 07777);
+#endif
+
+    // Rows are rendered into one buffer and written a megabyte at a time.
+    // "<result>," is padded to 16 bytes so every row copies a fixed size.
+    char result_fields[SUCCESS + 1][16] = {{0}};
+    size_t result_lengths[SUCCESS + 1];
+    for (int r = FAILED; r <= SUCCESS; r++)
+    {
+        result_lengths[r] = (size_t)snprintf(result_fields[r], sizeof(result_fields[r]), "%s,",
+                                             test_result_to_string((TestResult)r));
+    }
+
+    char *buffer = malloc(SAVE_BUFFER_SIZE);
+    int fd = fileno(file);
+    int ok = buffer != NULL;
+    size_t used = 0;
+    if (ok)
+    {
+        memcpy(buffer, REQUIRED_HEADER "\n", sizeof(REQUIRED_HEADER));
+        used = sizeof(REQUIRED_HEADER);
+    }
+
+    int thread_count = get_save_thread_count(db.count);
+    if (ok && thread_count > 1)
+    {
+        // Header first, then every row range at its own offset
+        ok = write_fully(fd, buffer, used) &&
+             write_rows_parallel(fd, (long long)used, thread_count, result_fields, result_lengths);
+        used = 0;
+    }
+
+    for (int i = 0; ok && thread_count <= 1 && i < db.count; i++)
+    {
+        // TestID, separators, active flag and newline fit in 32, plus the padded result
+        size_t row_bytes = 32 + db.systems.lengths[db.system_codes[i]] + db.types.lengths[db.type_codes[i]] +
+                           sizeof(result_fields[0]);
+        if (used + row_bytes > SAVE_BUFFER_SIZE)
+        {
+            ok = write_fully(fd, buffer, used);
+            used = 0;
+        }
+        if (ok && row_bytes > SAVE_BUFFER_SIZE)
+        {
+            // Names have no length cap, so a row may not fit the buffer at all
+            char *long_row = malloc(row_bytes);
+            ok = long_row && write_fully(fd, long_row, serialize_row(long_row, i, result_fields, result_lengths));
+            free(long_row);
+            continue;
+        }
+        used += serialize_row(buffer + used, i, result_fields, result_lengths);
+    }
+    if (ok && used > 0)
+        ok = write_fully(fd, buffer, used);
+    free(buffer);
+
+    if (ok && durability_mode != DURABILITY_NONE)
+        ok = sync_file(file);
+    if (fclose(file) != 0)
+        ok = 0;
+
+#ifdef _WIN32
+    if (ok)
+        ok = MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (ok)
+        ok = rename(temp_path, path) == 0;
+#endif
+    if (!ok)
+    {
+        remove(temp_path);
+        return 0;
+    }
+
+    // Make the rename itself durable
+    if (durability_mode != DURABILITY_NONE && !sync_directory(path))
+        return 0;
+    return 1;
+}
+
+// Renders row as "%d,%s,%s,%s,%d\n" would and returns its length; no terminator
+size_t serialize_row(char *out, int row, const char result_fields[][16], const size_t *result_lengths)
+{
+    char *p = out + format_test_id(db.test_ids[row], out);
+    *p++ = ',';
+
+    uint32_t code = db.system_codes[row];
+    memcpy(p, db.systems.strings[code], db.systems.lengths[code]);
+    p += db.systems.lengths[code];
+    *p++ = ',';
+
+    code = db.type_codes[row];
+    memcpy(p, db.types.strings[code], db.types.lengths[code]);
+    p += db.types.lengths[code];
+    *p++ = ',';
+
+    int result = db.results[row];
+    memcpy(p, result_fields[result], sizeof(result_fields[result]));
+    p += result_lengths[result];
+    *p++ = (char)('0' + ((db.active_bits[row >> 6] >> (row & 63)) & 1));
+    *p++ = '\n';
+    return (size_t)(p - out);
+}
+
+#ifdef _WIN32
+int write_fully(int fd, const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        unsigned int chunk = size > (1u << 30) ? (1u << 30) : (unsigned int)size;
+        int written = _write(fd, data, chunk);
+        if (written <= 0)
+            return 0;
+        data += written;
+        size -= (size_t)written;
+    }
+    return 1;
+}
+#else
+int write_fully(int fd, const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0)
+            return 0;
+        data += written;
+        size -= (size_t)written;
+    }
+    return 1;
+}
+#endif
+
+#ifdef _WIN32
+int get_save_thread_count(int rows)
+{
+    (void)rows;
+    return 1;
+}
+
+int write_rows_parallel(int fd, long long offset, int thread_count, const char result_fields[][16],
+                        const size_t *result_lengths)
+{
+    (void)fd;
+    (void)offset;
+    (void)thread_count;
+    (void)result_fields;
+    (void)result_lengths;
+    return 0;
+}
+#else
+int get_save_thread_count(int rows)
+{
+    if (rows < PARALLEL_SAVE_MIN_ROWS)
+        return 1;
+
+    long threads = save_threads > 0 ? save_threads : sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_LOAD_THREADS)
+        threads = MAX_LOAD_THREADS;
+
+    // Keep at least half the parallel threshold of rows per thread
+    long by_rows = rows / (PARALLEL_SAVE_MIN_ROWS / 2);
+    return (int)(threads < by_rows ? threads : by_rows);
+}
+
+int pwrite_fully(int fd, const char *data, size_t size, long long offset)
+{
+    while (size > 0)
+    {
+        ssize_t written = pwrite(fd, data, size, (off_t)offset);
+        if (written <= 0)
+            return 0;
+        data += written;
+        size -= (size_t)written;
+        offset += written;
+    }
+    return 1;
+}
+
+// First pass: the exact bytes a range renders to, so every range knows its offset
+void *size_save_chunk_worker(void *arg)
+{
+    TRACE_BEGIN("size_chunk");
+    SaveChunk *chunk = arg;
+    size_t size = 0;
+    for (int row = chunk->first; row < chunk->end; row++)
+    {
+        // Four commas, the active flag and the newline
+        size += (size_t)test_id_length(db.test_ids[row]) + db.systems.lengths[db.system_codes[row]] +
+                db.types.lengths[db.type_codes[row]] + chunk->result_lengths[db.results[row]] + 5;
+    }
+    chunk->size = size;
+    TRACE_END("size_chunk");
+    return NULL;
+}
+
+// Second pass: render the range through its own buffer and write it in place
+void *write_save_chunk_worker(void *arg)
+{
+    SaveChunk *chunk = arg;
+    char *buffer = malloc(SAVE_BUFFER_SIZE);
+    if (!buffer)
+    {
+        chunk->failed = 1;
+        return NULL;
+    }
+
+    TRACE_BEGIN("write_chunk");
+    long long position = chunk->offset;
+    size_t used = 0;
+    for (int row = chunk->first; row < chunk->end && !chunk->failed; row++)
+    {
+        size_t row_bytes = 32 + db.systems.lengths[db.system_codes[row]] + db.types.lengths[db.type_codes[row]] +
+                           sizeof(chunk->result_fields[0]);
+        if (used + row_bytes > SAVE_BUFFER_SIZE)
+        {
+            chunk->failed = !pwrite_fully(chunk->fd, buffer, used, position);
+            position += (long long)used;
+            used = 0;
+        }
+        if (!chunk->failed && row_bytes > SAVE_BUFFER_SIZE)
+        {
+            // Too long for the buffer: rendered and written on its own
+            char *long_row = malloc(row_bytes);
+            size_t length = long_row ? serialize_row(long_row, row, chunk->result_fields, chunk->result_lengths) : 0;
+            chunk->failed = !long_row || !pwrite_fully(chunk->fd, long_row, length, position);
+            position += (long long)length;
+            free(long_row);
+            continue;
+        }
+        used += serialize_row(buffer + used, row, chunk->result_fields, chunk->result_lengths);
+    }
+    if (!chunk->failed && used > 0)
+        chunk->failed = !pwrite_fully(chunk->fd, buffer, used, position);
+    position += (long long)used;
+    free(buffer);
+
+    // The sizing pass and the rendering must agree, or ranges would overlap
+    if (position != chunk->offset + (long long)chunk->size)
+        chunk->failed = 1;
+    TRACE_END("write_chunk");
+    return NULL;
+}
+
+// Writes every row from offset on: thread_count ranges are sized, given
+// consecutive offsets, then rendered and written concurrently
+int write_rows_parallel(int fd, long long offset, int thread_count, const char result_fields[][16],
+                        const size_t *result_lengths)
+{
+    SaveChunk chunks[MAX_LOAD_THREADS];
+    for (int i = 0; i < thread_count; i++)
+    {
+        chunks[i].first = (int)((long long)db.count * i / thread_count);
+        chunks[i].end = (int)((long long)db.count * (i + 1) / thread_count);
+        chunks[i].fd = fd;
+        chunks[i].result_fields = result_fields;
+        chunks[i].result_lengths = result_lengths;
+        chunks[i].failed = 0;
+    }
+    run_chunk_workers(chunks, sizeof(SaveChunk), thread_count, size_save_chunk_worker);
+
+    for (int i = 0; i < thread_count; i++)
+    {
+        chunks[i].offset = offset;
+        offset += (long long)chunks[i].size;
+    }
+
+    // Set the final size up front so the writers fill the file instead of each extending it
+    if (ftruncate(fd, (off_t)offset) != 0)
+        return 0;
+    run_chunk_workers(chunks, sizeof(SaveChunk), thread_count, write_save_chunk_worker);
+
+    for (int i = 0; i < thread_count; i++)
+    {
+        if (chunks[i].failed)
+            return 0;
+    }
+    return 1;
+}
+#endif
+
+int is_snapshot_file(const char *filename)
+{
+    size_t len = strlen(filename);
+    size_t suffix_len = strlen(SNAPSHOT_SUFFIX);
+    return len > suffix_len && strcasecmp(filename + len - suffix_len, SNAPSHOT_SUFFIX) == 0;
+}
+
+// 64-bit checksum in four independent lanes, so it keeps up with memory bandwidth
+uint64_t snapshot_checksum(const void *data, size_t size)
+{
+    const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    const unsigned char *p = data;
+    uint64_t lanes[4] = {prime1 + prime2, prime2, 0, 0 - prime1};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        for (int lane = 0; lane < 4; lane++)
+        {
+            uint64_t word;
+            memcpy(&word, p + i + lane * 8, 8);
+            lanes[lane] += word * prime2;
+            lanes[lane] = (lanes[lane] << 31 | lanes[lane] >> 33) * prime1;
+        }
+    }
+
+    uint64_t hash = (uint64_t)size;
+    for (int lane = 0; lane < 4; lane++)
+        hash = (hash ^ lanes[lane]) * prime1 + prime2;
+    for (; i < size; i++)
+        hash = (hash ^ p[i]) * prime1;
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+// Same temp-file-and-rename as the CSV. Every section is checksummed.
+int write_database_snapshot(const char *path)
+{
+    uint32_t string_count = db.systems.count + db.types.count;
+    uint32_t *lengths = malloc((string_count + 1) * sizeof(uint32_t));
+    size_t heap_size = 0;
+    for (uint32_t i = 0; lengths && i < string_count; i++)
+    {
+        lengths[i] = i < db.systems.count ? db.systems.lengths[i] : db.types.lengths[i - db.systems.count];
+        heap_size += lengths[i] + 1;
+    }
+    char *heap = lengths ? malloc(heap_size + 1) : NULL;
+    if (!heap)
+    {
+        free(lengths);
+        return 0;
+    }
+    char *cursor = heap;
+    for (uint32_t i = 0; i < string_count; i++)
+    {
+        const char *str = i < db.systems.count ? db.systems.strings[i] : db.types.strings[i - db.systems.count];
+        memcpy(cursor, str, lengths[i] + 1);
+        cursor += lengths[i] + 1;
+    }
+
+    size_t rows = (size_t)db.count;
+    const void *sections[SNAPSHOT_SECTIONS] = {db.test_ids, db.system_codes, db.type_codes, db.results,
+                                               db.active_bits, lengths, heap};
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.row_count = (uint32_t)rows;
+    header.next_id = db.next_id;
+    header.system_count = db.systems.count;
+    header.type_count = db.types.count;
+    header.sizes[SNAPSHOT_IDS] = rows * sizeof(int);
+    header.sizes[SNAPSHOT_SYSTEM_CODES] = rows * sizeof(uint32_t);
+    header.sizes[SNAPSHOT_TYPE_CODES] = rows * sizeof(uint32_t);
+    header.sizes[SNAPSHOT_RESULTS] = rows * sizeof(int8_t);
+    header.sizes[SNAPSHOT_ACTIVE] = (rows + 63) / 64 * sizeof(uint64_t);
+    header.sizes[SNAPSHOT_LENGTHS] = string_count * sizeof(uint32_t);
+    header.sizes[SNAPSHOT_STRINGS] = heap_size;
+
+    uint64_t offset = (sizeof(SnapshotHeader) + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+    for (int i = 0; i < SNAPSHOT_SECTIONS; i++)
+    {
+        header.offsets[i] = offset;
+        header.checksums[i] = snapshot_checksum(sections[i], (size_t)header.sizes[i]);
+        offset = (offset + header.sizes[i] + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+    }
+    header.file_size = offset;
+    header.header_checksum = snapshot_checksum(&header, sizeof(header));
+
+    char temp_path[MAX_PATH + sizeof(TEMP_SUFFIX)];
+    snprintf(temp_path, sizeof(temp_path), "%s%s", path, TEMP_SUFFIX);
+    FILE *file = fopen(temp_path, "wb");
+    if (!file)
+    {
+        free(lengths);
+        free(heap);
+        return 0;
+    }
+
+#ifndef _WIN32
+    // Keep the permissions of the file being replaced
+    struct stat info;
+    if (stat(path, &info) == 0)
+        fchmod(fileno(file), info.st_mode & 07777);
+#endif
+
+    static const char padding[SNAPSHOT_ALIGN] = {0};
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    uint64_t written = sizeof(header);
+    for (int i = 0; ok && i < SNAPSHOT_SECTIONS; i++)
+    {
+        ok = fwrite(padding, 1, (size_t)(header.offsets[i] - written), file) == header.offsets[i] - written &&
+             (header.sizes[i] == 0 || fwrite(sections[i], 1, (size_t)header.sizes[i], file) == header.sizes[i]);
+        written = header.offsets[i] + header.sizes[i];
+    }
+    ok = ok && fwrite(padding, 1, (size_t)(header.file_size - written), file) == header.file_size - written;
+    free(lengths);
+    free(heap);
+
+    if (ok && durability_mode != DURABILITY_NONE)
+        ok = sync_file(file);
+    if (fclose(file) != 0)
+        ok = 0;
+
+#ifdef _WIN32
+    if (ok)
+        ok = MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (ok)
+        ok = rename(temp_path, path) == 0;
+#endif
+    if (!ok)
+    {
+        remove(temp_path);
+        return 0;
+    }
+
+    if (durability_mode != DURABILITY_NONE && !sync_directory(path))
+        return 0;
+    return 1;
+}
+
+#ifdef _WIN32
+// No private file mappings here: the snapshot is read into one heap block
+char *map_snapshot_file(const char *filename, size_t *size)
+{
+    FILE *file = fopen(filename, "rb");
+    if (!file)
+        return NULL;
+
+    struct _stat64 info;
+    if (_fstat64(_fileno(file), &info) != 0 || info.st_size < (long long)sizeof(SnapshotHeader))
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    *size = (size_t)info.st_size;
+    char *data = malloc(*size);
+    if (data && fread(data, 1, *size, file) != *size)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+void unmap_snapshot_file(char *data, size_t size)
+{
+    (void)size;
+    free(data);
+}
+#else
+// Private writable mapping: pages are read on first touch and edits stay in memory
+char *map_snapshot_file(const char *filename, size_t *size)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size < (off_t)sizeof(SnapshotHeader))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    *size = (size_t)st.st_size;
+    char *data = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    return data == MAP_FAILED ? NULL : data;
+}
+
+void unmap_snapshot_file(char *data, size_t size)
+{
+    munmap(data, size);
+}
+#endif
+
+int snapshot_section_ok(const SnapshotHeader *header, int section, uint64_t expected_size, size_t file_size)
+{
+    uint64_t offset = header->offsets[section];
+    uint64_t size = header->sizes[section];
+    return size == expected_size && offset % SNAPSHOT_ALIGN == 0 && offset >= sizeof(SnapshotHeader) &&
+           offset <= file_size && size <= file_size - offset;
+}
+
+// Checks the header, every section's bounds and checksum, and that codes and
+// results are in range, so the columns can be used without further checks
+int validate_snapshot(const char *data, size_t size)
+{
+    SnapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    uint64_t stored_checksum = header.header_checksum;
+    header.header_checksum = 0;
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || header.version != SNAPSHOT_VERSION ||
+        header.byte_order != SNAPSHOT_BYTE_ORDER || header.file_size != size ||
+        snapshot_checksum(&header, sizeof(header)) != stored_checksum || header.row_count > INT_MAX ||
+        header.system_count > INT_MAX / 2 || header.type_count > INT_MAX / 2)
+        return 0;
+
+    uint64_t rows = header.row_count;
+    uint64_t strings = (uint64_t)header.system_count + header.type_count;
+    uint64_t expected[SNAPSHOT_SECTIONS] = {rows * sizeof(int), rows * sizeof(uint32_t), rows * sizeof(uint32_t),
+                                            rows * sizeof(int8_t), (rows + 63) / 64 * sizeof(uint64_t),
+                                            strings * sizeof(uint32_t), header.sizes[SNAPSHOT_STRINGS]};
+    for (int i = 0; i < SNAPSHOT_SECTIONS; i++)
+    {
+        if (!snapshot_section_ok(&header, i, expected[i], size) ||
+            snapshot_checksum(data + header.offsets[i], (size_t)header.sizes[i]) != header.checksums[i])
+            return 0;
+    }
+
+    // Every string ends with its NUL and the heap holds nothing else
+    const uint32_t *lengths = (const uint32_t *)(data + header.offsets[SNAPSHOT_LENGTHS]);
+    const char *heap = data + header.offsets[SNAPSHOT_STRINGS];
+    uint64_t heap_used = 0;
+    for (uint64_t i = 0; i < strings; i++)
+    {
+        heap_used += (uint64_t)lengths[i] + 1;
+        if (heap_used > header.sizes[SNAPSHOT_STRINGS] || heap[heap_used - 1] != '\0')
+            return 0;
+    }
+    if (heap_used != header.sizes[SNAPSHOT_STRINGS])
+        return 0;
+
+    const uint32_t *system_codes = (const uint32_t *)(data + header.offsets[SNAPSHOT_SYSTEM_CODES]);
+    const uint32_t *type_codes = (const uint32_t *)(data + header.offsets[SNAPSHOT_TYPE_CODES]);
+    const int8_t *results = (const int8_t *)(data + header.offsets[SNAPSHOT_RESULTS]);
+    uint32_t max_system = 0;
+    uint32_t max_type = 0;
+    uint8_t max_result = 0;
+    for (uint64_t row = 0; row < rows; row++)
+    {
+        max_system = system_codes[row] > max_system ? system_codes[row] : max_system;
+        max_type = type_codes[row] > max_type ? type_codes[row] : max_type;
+        max_result = (uint8_t)results[row] > max_result ? (uint8_t)results[row] : max_result;
+    }
+    if (rows > 0 && (max_system >= header.system_count || max_type >= header.type_count || max_result > SUCCESS))
+        return 0;
+
+    const uint64_t *active = (const uint64_t *)(data + header.offsets[SNAPSHOT_ACTIVE]);
+    return rows % 64 == 0 || (active[rows / 64] >> (rows % 64)) == 0;
+}
+
+// Opens a .tdb: the columns are used in place and the dictionaries point into
+// its string heap; only the distinct strings are hashed
+int load_database_snapshot(const char *filename)
+{
+    size_t size;
+    char *data = map_snapshot_file(filename, &size);
+    if (!data)
+        return 0;
+    if (!validate_snapshot(data, size))
+    {
+        fprintf(diagnostic_stream(), "Error: %s is not a valid snapshot (bad header or checksum).\n", filename);
+        unmap_snapshot_file(data, size);
+        return 0;
+    }
+
+    database_reset();
+    const SnapshotHeader *header = (const SnapshotHeader *)data;
+    db.snapshot = data;
+    db.snapshot_size = size;
+    db.columns_mapped = 1;
+    db.test_ids = (int *)(data + header->offsets[SNAPSHOT_IDS]);
+    db.system_codes = (uint32_t *)(data + header->offsets[SNAPSHOT_SYSTEM_CODES]);
+    db.type_codes = (uint32_t *)(data + header->offsets[SNAPSHOT_TYPE_CODES]);
+    db.results = (int8_t *)(data + header->offsets[SNAPSHOT_RESULTS]);
+    db.active_bits = (uint64_t *)(data + header->offsets[SNAPSHOT_ACTIVE]);
+    db.count = (int)header->row_count;
+    db.capacity = db.count;
+    db.next_id = header->next_id;
+
+    const uint32_t *lengths = (const uint32_t *)(data + header->offsets[SNAPSHOT_LENGTHS]);
+    const char *heap = data + header->offsets[SNAPSHOT_STRINGS];
+    db.systems.borrows_strings = 1;
+    db.types.borrows_strings = 1;
+    int ok = 1;
+    for (uint32_t i = 0; ok && i < header->system_count + header->type_count; i++)
+    {
+        StringDictionary *dict = i < header->system_count ? &db.systems : &db.types;
+        uint32_t expected_code = i < header->system_count ? i : i - header->system_count;
+        ok = dictionary_intern(dict, heap, lengths[i]) == expected_code; // Also rejects duplicates
+        heap += lengths[i] + 1;
+    }
+    db.systems.borrows_strings = 0;
+    db.types.borrows_strings = 0;
+    if (!ok)
+    {
+        fprintf(diagnostic_stream(), "Error: %s has an invalid string table.\n", filename);
+        database_reset();
+        return 0;
+    }
+
+    strcpy(db.filename, filename);
+    return 1;
+}
+
+// Copies columns that still point into the snapshot to the heap so they can grow
+int database_own_columns(void)
+{
+    size_t rows = (size_t)(db.capacity > 0 ? db.capacity : 1);
+    size_t words = (rows + 63) / 64;
+    int *test_ids = malloc(rows * sizeof(int));
+    uint32_t *system_codes = malloc(rows * sizeof(uint32_t));
+    uint32_t *type_codes = malloc(rows * sizeof(uint32_t));
+    int8_t *results = malloc(rows * sizeof(int8_t));
+    uint64_t *active_bits = calloc(words, sizeof(uint64_t));
+    if (!test_ids || !system_codes || !type_codes || !results || !active_bits)
+    {
+        free(test_ids);
+        free(system_codes);
+        free(type_codes);
+        free(results);
+        free(active_bits);
+        return 0;
+    }
+
+    memcpy(test_ids, db.test_ids, (size_t)db.count * sizeof(int));
+    memcpy(system_codes, db.system_codes, (size_t)db.count * sizeof(uint32_t));
+    memcpy(type_codes, db.type_codes, (size_t)db.count * sizeof(uint32_t));
+    memcpy(results, db.results, (size_t)db.count * sizeof(int8_t));
+    memcpy(active_bits, db.active_bits, ((size_t)db.count + 63) / 64 * sizeof(uint64_t));
+    db.test_ids = test_ids;
+    db.system_codes = system_codes;
+    db.type_codes = type_codes;
+    db.results = results;
+    db.active_bits = active_bits;
+    db.capacity = (int)rows;
+    db.columns_mapped = 0;
+    return 1;
+}
+
+int is_archive_file(const char *filename)
+{
+    size_t len = strlen(filename);
+    size_t suffix_len = strlen(ARCHIVE_SUFFIX);
+    return len > suffix_len && strcasecmp(filename + len - suffix_len, ARCHIVE_SUFFIX) == 0;
+}
+
+// Formats with their own integrity checks instead of the CSV header
+int is_binary_database_file(const char *filename)
+{
+    return is_snapshot_file(filename) || is_archive_file(filename);
+}
+
+// Writes data to a temp file and renames it over path, keeping its permissions
+int replace_file_contents(const char *path, const void *data, size_t size)
+{
+    char temp_path[MAX_PATH + sizeof(TEMP_SUFFIX)];
+    snprintf(temp_path, sizeof(temp_path), "%s%s", path, TEMP_SUFFIX);
+    FILE *file = fopen(temp_path, "wb");
+    if (!file)
+        return 0;
+
+#ifndef _WIN32
+    struct stat info;
+    if (stat(path, &info) == 0)
+        fchmod(fileno(file), info.st_mode & 07777);
+#endif
+
+    int ok = size == 0 || fwrite(data, 1, size, file) == size;
+    if (ok && durability_mode != DURABILITY_NONE)
+        ok = sync_file(file);
+    if (fclose(file) != 0)
+        ok = 0;
+
+#ifdef _WIN32
+    if (ok)
+        ok = MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (ok)
+        ok = rename(temp_path, path) == 0;
+#endif
+    if (!ok)
+    {
+        remove(temp_path);
+        return 0;
+    }
+    return durability_mode == DURABILITY_NONE || sync_directory(path);
+}
+
+void archive_put_byte(ArchiveBuffer *buffer, unsigned char byte)
+{
+    if (buffer->size == buffer->capacity)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        unsigned char *data = buffer->failed ? NULL : realloc(buffer->data, capacity);
+        if (!data)
+        {
+            buffer->failed = 1;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    buffer->data[buffer->size++] = byte;
+}
+
+void archive_put_bytes(ArchiveBuffer *buffer, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++)
+        archive_put_byte(buffer, bytes[i]);
+}
+
+// LEB128: seven bits per byte, high bit set while more follow
+void archive_put_varint(ArchiveBuffer *buffer, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        archive_put_byte(buffer, (unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    archive_put_byte(buffer, (unsigned char)value);
+}
+
+void archive_put_bits(ArchiveBuffer *buffer, uint32_t value, int bits)
+{
+    buffer->bit_buffer |= (uint64_t)value << buffer->bit_count;
+    buffer->bit_count += bits;
+    while (buffer->bit_count >= 8)
+    {
+        archive_put_byte(buffer, (unsigned char)buffer->bit_buffer);
+        buffer->bit_buffer >>= 8;
+        buffer->bit_count -= 8;
+    }
+}
+
+// Pads the last partial byte so the next stream starts on a byte boundary
+void archive_flush_bits(ArchiveBuffer *buffer)
+{
+    if (buffer->bit_count > 0)
+        archive_put_byte(buffer, (unsigned char)buffer->bit_buffer);
+    buffer->bit_buffer = 0;
+    buffer->bit_count = 0;
+}
+
+uint64_t archive_get_varint(ArchiveReader *reader)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (reader->pos >= reader->size)
+            break;
+        unsigned char byte = reader->data[reader->pos++];
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    reader->failed = 1;
+    return 0;
+}
+
+uint32_t archive_get_bits(ArchiveReader *reader, int bits)
+{
+    while (reader->bit_count < bits)
+    {
+        if (reader->pos >= reader->size)
+        {
+            reader->failed = 1;
+            return 0;
+        }
+        reader->bit_buffer |= (uint64_t)reader->data[reader->pos++] << reader->bit_count;
+        reader->bit_count += 8;
+    }
+    uint32_t value = (uint32_t)(reader->bit_buffer & ((1ULL << bits) - 1));
+    reader->bit_buffer >>= bits;
+    reader->bit_count -= bits;
+    return value;
+}
+
+// Bits needed for codes 0..count-1; none when every row has the same string
+int archive_code_bits(uint32_t count)
+{
+    int bits = 0;
+    while (bits < 32 && count > 1ULL << bits)
+        bits++;
+    return bits;
+}
+
+// Archive layout after the 8-byte magic, all integers LEB128 so it is byte
+// order independent, ending with a little-endian checksum of everything before:
+//   version, rows, next_id, system count, type count
+//   each system then each type name: length, bytes
+//   TestID runs: zigzag(delta from the previous TestID), run length
+//   system codes, type codes, then results, each bit-packed
+//   active: 0 then runs alternating from deleted rows, or 1 then a bitmap
+//   when the flags change too often for runs to pay off
+int write_database_archive(const char *path)
+{
+    ArchiveBuffer buffer = {0};
+    archive_put_bytes(&buffer, ARCHIVE_MAGIC, 8);
+    archive_put_varint(&buffer, ARCHIVE_VERSION);
+    archive_put_varint(&buffer, (uint64_t)db.count);
+    archive_put_varint(&buffer, (uint64_t)(uint32_t)db.next_id);
+    archive_put_varint(&buffer, db.systems.count);
+    archive_put_varint(&buffer, db.types.count);
+    for (uint32_t i = 0; i < db.systems.count + db.types.count; i++)
+    {
+        StringDictionary *dict = i < db.systems.count ? &db.systems : &db.types;
+        uint32_t code = i < db.systems.count ? i : i - db.systems.count;
+        archive_put_varint(&buffer, dict->lengths[code]);
+        archive_put_bytes(&buffer, dict->strings[code], dict->lengths[code]);
+    }
+
+    // Sequential TestIDs collapse to a single run of delta 1
+    int64_t previous = 0;
+    for (int row = 0; row < db.count;)
+    {
+        int64_t delta = (int64_t)db.test_ids[row] - previous;
+        int run = 1;
+        while (row + run < db.count && (int64_t)db.test_ids[row + run] - db.test_ids[row + run - 1] == delta)
+            run++;
+        archive_put_varint(&buffer, (uint64_t)delta << 1 ^ (uint64_t)(delta >> 63));
+        archive_put_varint(&buffer, (uint64_t)run);
+        previous = db.test_ids[row + run - 1];
+        row += run;
+    }
+
+    int system_bits = archive_code_bits(db.systems.count);
+    int type_bits = archive_code_bits(db.types.count);
+    for (int row = 0; row < db.count; row++)
+        archive_put_bits(&buffer, db.system_codes[row], system_bits);
+    archive_flush_bits(&buffer);
+    for (int row = 0; row < db.count; row++)
+        archive_put_bits(&buffer, db.type_codes[row], type_bits);
+    archive_flush_bits(&buffer);
+    for (int row = 0; row < db.count; row++)
+        archive_put_bits(&buffer, (uint32_t)db.results[row], 2);
+    archive_flush_bits(&buffer);
+
+    size_t runs_start = buffer.size;
+    archive_put_varint(&buffer, 0);
+    int active = 0;
+    for (int row = 0; row < db.count;)
+    {
+        int run = 0;
+        while (row + run < db.count && database_is_active(row + run) == active)
+            run++;
+        archive_put_varint(&buffer, (uint64_t)run);
+        row += run;
+        active = !active;
+    }
+    if (buffer.size - runs_start > 1 + ((size_t)db.count + 7) / 8)
+    {
+        buffer.size = runs_start;
+        archive_put_varint(&buffer, 1);
+        for (int row = 0; row < db.count; row++)
+            archive_put_bits(&buffer, (uint32_t)database_is_active(row), 1);
+        archive_flush_bits(&buffer);
+    }
+
+    uint64_t checksum = snapshot_checksum(buffer.data, buffer.size);
+    for (int i = 0; i < 8; i++)
+        archive_put_byte(&buffer, (unsigned char)(checksum >> (8 * i)));
+
+    int ok = !buffer.failed && replace_file_contents(path, buffer.data, buffer.size);
+    free(buffer.data);
+    return ok;
+}
+
+// Reads the whole archive and decodes each column straight into db
+int load_database_archive(const char *filename)
+{
+    size_t size;
+    unsigned char *data = (unsigned char *)read_file_contents(filename, &size);
+    if (!data)
+        return 0;
+
+    uint64_t checksum = 0;
+    for (int i = 0; size >= 16 && i < 8; i++)
+        checksum |= (uint64_t)data[size - 8 + i] << (8 * i);
+    if (size < 16 || memcmp(data, ARCHIVE_MAGIC, 8) != 0 || snapshot_checksum(data, size - 8) != checksum)
+    {
+        fprintf(diagnostic_stream(), "Error: %s is not a valid archive (bad header or checksum).\n", filename);
+        free(data);
+        return 0;
+    }
+
+    ArchiveReader reader = {data, size - 8, 8, 0, 0, 0};
+    uint64_t version = archive_get_varint(&reader);
+    uint64_t rows = archive_get_varint(&reader);
+    uint64_t next_id = archive_get_varint(&reader);
+    uint64_t system_count = archive_get_varint(&reader);
+    uint64_t type_count = archive_get_varint(&reader);
+    int ok = !reader.failed && version == ARCHIVE_VERSION && rows <= INT_MAX && next_id <= UINT32_MAX &&
+             system_count <= INT_MAX / 2 && type_count <= INT_MAX / 2;
+
+    database_reset();
+    ok = ok && database_reserve((int)rows);
+    for (uint64_t i = 0; ok && i < system_count + type_count; i++)
+    {
+        StringDictionary *dict = i < system_count ? &db.systems : &db.types;
+        uint64_t expected_code = i < system_count ? i : i - system_count;
+        uint64_t len = archive_get_varint(&reader);
+        ok = !reader.failed && len <= reader.size - reader.pos &&
+             dictionary_intern(dict, (const char *)data + reader.pos, (size_t)len) == expected_code;
+        reader.pos += ok ? (size_t)len : 0;
+    }
+
+    int64_t previous = 0;
+    for (uint64_t row = 0; ok && row < rows;)
+    {
+        uint64_t zigzag = archive_get_varint(&reader);
+        uint64_t run = archive_get_varint(&reader);
+        int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+        ok = !reader.failed && run > 0 && run <= rows - row;
+        for (uint64_t i = 0; ok && i < run; i++, row++)
+        {
+            previous += delta;
+            ok = previous >= INT_MIN && previous <= INT_MAX;
+            db.test_ids[row] = (int)previous;
+        }
+    }
+
+    int system_bits = archive_code_bits((uint32_t)system_count);
+    int type_bits = archive_code_bits((uint32_t)type_count);
+    for (uint64_t row = 0; ok && row < rows; row++)
+        db.system_codes[row] = archive_get_bits(&reader, system_bits);
+    reader.bit_buffer = 0;
+    reader.bit_count = 0;
+    for (uint64_t row = 0; ok && row < rows; row++)
+        db.type_codes[row] = archive_get_bits(&reader, type_bits);
+    reader.bit_buffer = 0;
+    reader.bit_count = 0;
+    for (uint64_t row = 0; ok && row < rows; row++)
+        db.results[row] = (int8_t)archive_get_bits(&reader, 2);
+    reader.bit_buffer = 0;
+    reader.bit_count = 0;
+
+    uint64_t active_bitmap = archive_get_varint(&reader);
+    ok = ok && active_bitmap <= 1;
+    for (uint64_t row = 0; ok && active_bitmap && row < rows; row++)
+        db.active_bits[row / 64] |= (uint64_t)archive_get_bits(&reader, 1) << (row % 64);
+    int active = 0;
+    for (uint64_t row = 0; ok && !active_bitmap && row < rows; active = !active)
+    {
+        uint64_t run = archive_get_varint(&reader);
+        ok = !reader.failed && run <= rows - row && (run > 0 || (row == 0 && !active));
+        for (uint64_t i = 0; ok && active && i < run; i++)
+            db.active_bits[(row + i) / 64] |= 1ULL << ((row + i) % 64);
+        row += ok ? run : 0;
+    }
+
+    // Every code and result in range and nothing left over
+    ok = ok && !reader.failed && reader.pos == reader.size;
+    for (uint64_t row = 0; ok && row < rows; row++)
+        ok = db.system_codes[row] < system_count && db.type_codes[row] < type_count && db.results[row] <= SUCCESS;
+    free(data);
+    if (!ok)
+    {
+        fprintf(diagnostic_stream(), "Error: %s is not a valid archive (malformed column data).\n", filename);
+        database_reset();
+        return 0;
+    }
+
+    db.count = (int)rows;
+    db.next_id = (int)(uint32_t)next_id;
+    strcpy(db.filename, filename);
+    return 1;
+}
+
+#ifdef _WIN32
+int sync_file(FILE *file)
+{
+    TRACE_BEGIN("fsync");
+    int ok = fflush(file) == 0 && _commit(_fileno(file)) == 0;
+    TRACE_END("fsync");
+    return ok;
+}
+
+int sync_directory(const char *path)
+{
+    // NTFS journals the rename; MOVEFILE_WRITE_THROUGH waits for it
+    (void)path;
+    return 1;
+}
+#else
+int sync_file(FILE *file)
+{
+    TRACE_BEGIN("fsync");
+    int ok = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    TRACE_END("fsync");
+    return ok;
+}
+
+int sync_directory(const char *path)
+{
+    char dir[MAX_PATH];
+    const char *slash = strrchr(path, '/');
+    if (slash)
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path) + (slash == path), path);
+    else
+        strcpy(dir, ".");
+
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    TRACE_BEGIN("fsync_directory");
+    int ok = fsync(fd) == 0;
+    TRACE_END("fsync_directory");
+    close(fd);
+    return ok;
+}
+#endif
+
+DurabilityMode parse_durability_mode(const char *name)
+{
+    if (strcmp(name, "none") == 0)
+        return DURABILITY_NONE;
+    if (strcmp(name, "batch") == 0)
+        return DURABILITY_BATCH;
+    return DURABILITY_COMMIT;
+}
+
+// Journal entries, one per line:
+//   B,<csv size>,<csv mtime>                    first line, the CSV it applies to
+//   I|U,<row>,<TestID>,<system>,<type>,<result>,<active>
+//   D|R|P,<row>,<TestID>                        soft delete, recover, purge
+void journal_path(char *path, size_t size, const char *filename)
+{
+    snprintf(path, size, "%s%s", filename, JOURNAL_SUFFIX);
+}
+
+int journal_csv_stamp(const char *filename, long long *size, long long *mtime)
+{
+    struct stat info;
+    if (stat(filename, &info) != 0)
+        return 0;
+
+    *size = (long long)info.st_size;
+    *mtime = (long long)info.st_mtime;
+    return 1;
+}
+
+#ifdef _WIN32
+int truncate_file(const char *path, long size)
+{
+    int fd = _open(path, _O_RDWR | _O_BINARY);
+    if (fd < 0)
+        return 0;
+
+    int ok = _chsize(fd, size) == 0;
+    _close(fd);
+    return ok;
+}
+#else
+int truncate_file(const char *path, long size)
+{
+    return truncate(path, (off_t)size) == 0;
+}
+#endif
+
+void journal_close(void)
+{
+    if (db.journal)
+    {
+        journal_sync();
+        fclose(db.journal);
+        db.journal = NULL;
+        db.journal_unsynced = 0;
+    }
+}
+
+// Writes one entry before the change is applied; record is used by I and U
+int journal_append(char op, int index, const TestRecord *record)
+{
+    char path[MAX_PATH + sizeof(JOURNAL_SUFFIX)];
+    journal_path(path, sizeof(path), db.filename);
+
+    if (!db.journal)
+    {
+        if (db.journal_bytes == 0)
+        {
+            long long csv_size, csv_mtime;
+            if (!journal_csv_stamp(db.filename, &csv_size, &csv_mtime))
+                return 0;
+
+            db.journal = fopen(path, "wb");
+            if (!db.journal)
+                return 0;
+
+            int written = fprintf(db.journal, "B,%lld,%lld\n", csv_size, csv_mtime);
+            if (written < 0 || fflush(db.journal) != 0 ||
+                (durability_mode != DURABILITY_NONE && !sync_directory(path)))
+            {
+                journal_close();
+                remove(path);
+                return 0;
+            }
+            db.journal_bytes = written;
+        }
+        else
+        {
+            db.journal = fopen(path, "ab");
+            if (!db.journal)
+                return 0;
+        }
+    }
+
+    int written;
+    if (record)
+    {
+        written = fprintf(db.journal, "%c,%d,%d,%s,%s,%s,%d\n", op, index, record->test_id,
+                          record_system_name(record), record_test_type(record),
+                          test_result_to_string(record->test_result), record->active);
+    }
+    else
+    {
+        written = fprintf(db.journal, "%c,%d,%d\n", op, index, db.test_ids[index]);
+    }
+
+    db.journal_unsynced++;
+    if (written < 0 || fflush(db.journal) != 0 || (journal_sync_due() && !journal_sync()))
+    {
+        // Drop the partial line so later entries still start on a line boundary
+        journal_close();
+        truncate_file(path, db.journal_bytes);
+        return 0;
+    }
+
+    db.journal_bytes += written;
+    metrics.bytes_written += (uint64_t)written;
+    return 1;
+}
+
+int journal_sync_due(void)
+{
+    if (durability_mode == DURABILITY_NONE || db.batch_depth > 0)
+        return 0;
+    if (durability_mode == DURABILITY_BATCH)
+        return db.journal_unsynced >= JOURNAL_BATCH_ENTRIES;
+    return 1;
+}
+
+int journal_sync(void)
+{
+    if (!db.journal || db.journal_unsynced == 0 || durability_mode == DURABILITY_NONE)
+        return 1;
+    if (!sync_file(db.journal))
+        return 0;
+
+    db.journal_unsynced = 0;
+    return 1;
+}
+
+// Changes inside a batch share one fsync, issued by database_end_batch()
+void database_begin_batch(void)
+{
+    db.batch_depth++;
+}
+
+int database_end_batch(void)
+{
+    if (db.batch_depth > 0 && --db.batch_depth > 0)
+        return 1;
+
+    return journal_sync();
+}
+
+// Returns 1 if applied, 0 if the line does not fit the database and -1 on allocation failure
+int journal_apply_line(char *line)
+{
+    line[strcspn(line, "\n\r")] = '\0';
+
+    char *fields[RECORD_FIELDS + 2];
+    int field_count = split_journal_fields(line, fields, RECORD_FIELDS + 2);
+    if (field_count < 3 || strlen(fields[0]) != 1)
+        return 0;
+
+    char op = fields[0][0];
+    int index = atoi(fields[1]);
+
+    if (op == 'I' || op == 'U')
+    {
+        if (field_count != RECORD_FIELDS + 2)
+            return 0;
+
+        TestRecord record;
+        const char *bad_result = NULL;
+        int filled = fill_record_fields(&record, fields + 2, RECORD_FIELDS, &db.systems, &db.types, &bad_result);
+        if (filled <= 0 || bad_result)
+            return filled < 0 ? -1 : 0;
+
+        if (op == 'I')
+        {
+            if (index != db.count)
+                return 0;
+            if (!database_append_record(&record))
+                return -1;
+            if (record.test_id >= db.next_id)
+                db.next_id = record.test_id + 1;
+            return 1;
+        }
+
+        if (index < 0 || index >= db.count || db.test_ids[index] != record.test_id)
+            return 0;
+        database_set_record(index, &record);
+        return 1;
+    }
+
+    if (field_count != 3 || index < 0 || index >= db.count || db.test_ids[index] != atoi(fields[2]))
+        return 0;
+
+    switch (op)
+    {
+    case 'D':
+        database_mark_active(index, 0);
+        return 1;
+    case 'R':
+        database_mark_active(index, 1);
+        return 1;
+    case 'P':
+        database_remove_record(index);
+        return 1;
+    }
+    return 0;
+}
+
+// Reads one entry of any length into *line, growing it as needed; returns its
+// length, 0 at end of file or -1 if the buffer could not grow
+long journal_read_line(FILE *file, char **line, size_t *capacity)
+{
+    size_t length = 0;
+    for (;;)
+    {
+        if (*capacity - length < 2)
+        {
+            size_t grown = *capacity > 0 ? *capacity * 2 : MAX_LINE;
+            char *larger = realloc(*line, grown);
+            if (!larger)
+                return -1;
+            *line = larger;
+            *capacity = grown;
+        }
+        if (!fgets(*line + length, (int)(*capacity - length), file))
+            break;
+        length += strlen(*line + length);
+        if ((*line)[length - 1] == '\n')
+            break;
+    }
+    return (long)length;
+}
+
+// Applies <filename>.journal on top of the rows just loaded from the CSV
+int journal_replay(void)
+{
+    char path[MAX_PATH + sizeof(JOURNAL_SUFFIX)];
+    journal_path(path, sizeof(path), db.filename);
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return 1;
+
+    char line[MAX_LINE];
+    long long stamp_size, stamp_mtime, csv_size, csv_mtime;
+    if (!fgets(line, sizeof(line), file) || !strchr(line, '\n') ||
+        sscanf(line, "B,%lld,%lld", &stamp_size, &stamp_mtime) != 2 ||
+        !journal_csv_stamp(db.filename, &csv_size, &csv_mtime) ||
+        stamp_size != csv_size || stamp_mtime != csv_mtime)
+    {
+        // Checkpointed (or edited) since the journal was started
+        fclose(file);
+        fprintf(diagnostic_stream(), "Warning: %s does not match %s and was discarded.\n", path, db.filename);
+        remove(path);
+        return 1;
+    }
+
+    // Names have no length limit, so entries are read whole whatever their size
+    long valid_bytes = ftell(file);
+    int applied = 0;
+    int complete = 1;
+    char *entry = NULL;
+    size_t entry_capacity = 0;
+    long entry_length;
+    while ((entry_length = journal_read_line(file, &entry, &entry_capacity)) != 0)
+    {
+        // A line without a newline is a write cut short by a crash
+        int result = entry_length < 0 ? -1 : entry[entry_length - 1] == '\n' ? journal_apply_line(entry) : 0;
+        if (result < 0)
+        {
+            free(entry);
+            fclose(file);
+            return 0;
+        }
+        if (result == 0)
+        {
+            fprintf(diagnostic_stream(), "Warning: Ignoring %s from entry %d on.\n", path, applied + 1);
+            complete = 0;
+            break;
+        }
+        valid_bytes = ftell(file);
+        applied++;
+    }
+    free(entry);
+    fclose(file);
+
+    if (!complete)
+        truncate_file(path, valid_bytes);
+
+    db.journal_bytes = valid_bytes;
+    if (applied > 0)
+        fprintf(diagnostic_stream(), "Replayed %d journal entr%s from %s\n", applied, applied == 1 ? "y" : "ies", path);
+    return 1;
+}
+
+// Folds the journal into the CSV with one full rewrite
+int database_checkpoint(void)
+{
+    if (!db.journal && db.journal_bytes == 0)
+        return 1;
+
+    if (!save_database())
+        return 0;
+
+    char path[MAX_PATH + sizeof(JOURNAL_SUFFIX)];
+    journal_path(path, sizeof(path), db.filename);
+    db.journal_unsynced = 0; // Already durable in the CSV
+    journal_close();
+    remove(path);
+    db.journal_bytes = 0;
+    return 1;
+}
+
+// Checkpoint once the journal is big enough that replaying it would be slow
+void journal_maybe_checkpoint(void)
+{
+    if (db.journal_bytes >= JOURNAL_CHECKPOINT_BYTES && !database_checkpoint())
+        fprintf(diagnostic_stream(), "Warning: Unable to checkpoint %s; changes remain in the journal.\n", db.filename);
+}
+
+// Mutations below are journaled first and only applied if the write succeeds
+int database_insert_record(const TestRecord *record)
+{
+    if (!database_reserve(db.count + 1) || !journal_append('I', db.count, record))
+        return 0;
+
+    database_set_record(db.count++, record);
+    stats_apply(record, 1);
+    journal_maybe_checkpoint();
+    return 1;
+}
+
+int database_update_record(int index, const TestRecord *record)
+{
+    if (!journal_append('U', index, record))
+        return 0;
+
+    TestRecord old = database_get_record(index);
+    stats_apply(&old, -1);
+    database_set_record(index, record);
+    stats_apply(record, 1);
+    journal_maybe_checkpoint();
+    return 1;
+}
+
+int database_set_active(int index, int active)
+{
+    uint64_t start = now_ns();
+    if (!journal_append(active ? 'R' : 'D', index, NULL))
+        return 0;
+
+    TestRecord row = database_get_record(index);
+    if (row.active != (active != 0))
+    {
+        // Counts cover active rows only, so the row enters or leaves them
+        row.active = 1;
+        stats_apply(&row, active ? 1 : -1);
+    }
+    database_mark_active(index, active);
+    journal_maybe_checkpoint();
+    if (!active)
+        metrics_record(METRIC_DELETE, start); // Soft deletes from the menu and batch mode
+    return 1;
+}
+
+int database_purge_record(int index)
+{
+    uint64_t start = now_ns();
+    if (!journal_append('P', index, NULL))
+        return 0;
+
+    TestRecord old = database_get_record(index);
+    stats_apply(&old, -1);
+    database_remove_record(index);
+    journal_maybe_checkpoint();
+    metrics_record(METRIC_DELETE, start);
+    return 1;
+}
+
+void display_welcome_message(void)
+{
+    clear_screen();
+    printf("╔══════════════════════════════════════════════════════════════╗\n");
+    printf("║                    SYSTEM TESTING DATA MANAGER               ║\n");
+    printf("║                     ระบบจัดการข้อมูลการทดสอบระบบ                ║\n");
+    printf("╠══════════════════════════════════════════════════════════════╣\n");
+    printf("║ Current Database: %-42s ║\n", db.filename);
+    printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+}
+
+void format_record_row(char *out, size_t size, const TestRecord *record, int index)
+{
+    snprintf(out, size, "│ %-3d │ %-6d │ %-30s │ %-25s │ %-8s │ %-7s │",
+             index + 1,
+             record->test_id,
+             record_system_name(record),
+             record_test_type(record),
+             test_result_to_string(record->test_result),
+             record->active ? "Active" : "Deleted");
+}
+
+void display_record(const TestRecord *record, int index)
+{
+    if (!record)
+        return;
+
+    char row[SCREEN_LINE_SIZE];
+    format_record_row(row, sizeof(row), record, index);
+    puts(row);
+}
+
+// One page of the paginated listing into the screen being composed
+void compose_records_page(const RowSet *set, int page)
+{
+    screen_begin();
+    screen_add("┌─────┬────────┬────────────────────────────────┬───────────────────────────┬──────────┬─────────┐");
+    screen_add("│ No. │ TestID │ SystemName                     │ TestType                  │ Result   │ Status  │");
+    screen_add("├─────┼────────┼────────────────────────────────┼───────────────────────────┼──────────┼─────────┤");
+    int start = page * PAGINATION_SIZE;
+    int end = (start + PAGINATION_SIZE < set->count) ? start + PAGINATION_SIZE : set->count;
+
+    for (int i = start; i < end; i++)
+    {
+        TestRecord record = database_get_record((int)set->rows[i]);
+        format_record_row(screen_line(), SCREEN_LINE_SIZE, &record, i);
+    }
+
+    screen_add("└─────┴────────┴────────────────────────────────┴───────────────────────────┴──────────┴─────────┘");
+}
+
+void display_records_paginated(const RowSet *set, const char *title)
+{
+    int count = set->count;
+    if (count == 0)
+    {
+        printf("No records found.\n");
+        return;
+    }
+    if (count > PAGINATION_SIZE)
+    {
+        if (!get_yes_no("Large dataset detected. Display all?", 1, 1))
+        {
+            // Paginated display; after the first page only changed lines are redrawn
+            int page = 0;
+            int total_pages = (count + PAGINATION_SIZE - 1) / PAGINATION_SIZE;
+            screen_invalidate();
+
+            while (1)
+            {
+                char prompt[64];
+                compose_records_page(set, page);
+                snprintf(prompt, sizeof(prompt), "Page %d of %d | (p)revious (n)ext (q)uit: ", page + 1, total_pages);
+                screen_present(prompt);
+
+                char nav[10];
+                TRACE_BEGIN("wait_for_input");
+                if (!fgets(nav, sizeof(nav), stdin))
+                    nav[0] = 'q';
+                TRACE_END("wait_for_input");
+
+                if (nav[0] == 'q' || nav[0] == 'Q')
+                    break;
+                if (nav[0] == 'n' || nav[0] == 'N')
+                {
+                    page = (page + 1) % total_pages;
+                }
+                if (nav[0] == 'p' || nav[0] == 'P')
+                {
+                    page = (page - 1 + total_pages) % total_pages;
+                }
+                if (nav[0] == '\n')
+                {
+                    page = (page + 1) % total_pages;
+                }
+            }
+            return;
+        }
+        clear_screen();
+    }
+    clear_screen();
+    printf("\n%s (Total: %d records)\n", title, count);
+    printf("┌─────┬────────┬────────────────────────────────┬───────────────────────────┬──────────┬─────────┐\n");
+    printf("│ No. │ TestID │ SystemName                     │ TestType                  │ Result   │ Status  │\n");
+    printf("├─────┼────────┼────────────────────────────────┼───────────────────────────┼──────────┼─────────┤\n");
+
+    // Display all records
+    for (int i = 0; i < count; i++)
+    {
+        TestRecord record = database_get_record((int)set->rows[i]);
+        display_record(&record, i);
+    }
+    printf("└─────┴────────┴────────────────────────────────┴───────────────────────────┴──────────┴─────────┘\n");
+}
+
+int find_record_by_id(int test_id)
+{
+    // A lookup takes about as long as reading the clock twice, so every call
+    // is counted but only one in METRIC_LOOKUP_SAMPLE is timed
+    int timed = (metrics.ops[METRIC_LOOKUP].calls & (METRIC_LOOKUP_SAMPLE - 1)) == 0;
+    uint64_t start = timed ? now_ns() : 0;
+    int found = -1;
+    if (id_index_sync())
+    {
+        found = id_index_lookup(test_id);
+    }
+    else
+    {
+        // No memory for the index: scan instead
+        for (int i = 0; i < db.count; i++)
+        {
+            if (db.test_ids[i] == test_id)
+            {
+                found = i;
+                break;
+            }
+        }
+    }
+    if (timed)
+        metrics_record(METRIC_LOOKUP, start);
+    else
+        metrics.ops[METRIC_LOOKUP].calls++;
+    return found;
+}
+
+int get_next_test_id(void)
+{
+    return db.next_id++;
+}
+
+void list_all_records(void)
+{
+    clear_screen();
+    printf("LIST ALL ACTIVE RECORDS\n");
+    printf("========================\n");
+
+    // Filter active records
+    RowSet active_records;
+    if (!rowset_select(&active_records, 1))
+    {
+        fprintf(stderr, "Error: Unable to allocate memory for active records.\n");
+        pause_screen();
+        return;
+    }
+
+    display_records_paginated(&active_records, "Active Records");
+    rowset_free(&active_records);
+    pause_screen();
+}
+
+void add_new_record(void)
+{
+    clear_screen();
+    printf("ADD NEW RECORD\n");
+    printf("==============\n");
+
+    if (!database_reserve(db.count + 1))
+    {
+        printf("Error: Unable to allocate memory for a new record.\n");
+        pause_screen();
+        return;
+    }
+
+    TestRecord new_record = {0};
+    new_record.test_id = get_next_test_id();
+    new_record.active = 1;
+
+    char buffer[256];
+
+    // Get System Name
+    if (!get_valid_input(buffer, sizeof(buffer), validate_system_name,
+                         "Enter System Name (min 3 chars, alphanumeric + ()[]- allowed)"))
+    {
+        return;
+    }
+    char *trimmed_system_name = trim_string(buffer);
+    new_record.system_code = dictionary_intern(&db.systems, trimmed_system_name, strlen(trimmed_system_name));
+    if (new_record.system_code == INVALID_CODE)
+    {
+        printf("Error: Unable to allocate memory for System Name.\n");
+        pause_screen();
+        return;
+    }
+
+    // Get Test Type
+    if (!get_valid_input(buffer, sizeof(buffer), validate_test_type,
+                         "\nEnter Test Type (min 3 chars, alphanumeric only)"))
+    {
+        return;
+    }
+    char *trimmed_test_type = trim_string(buffer);
+    new_record.type_code = dictionary_intern(&db.types, trimmed_test_type, strlen(trimmed_test_type));
+    if (new_record.type_code == INVALID_CODE)
+    {
+        printf("Error: Unable to allocate memory for Test Type.\n");
+        pause_screen();
+        return;
+    }
+
+    // Get Test Result
+    printf("\nSelect Test Result:\n");
+    printf("1. Pending\n");
+    printf("2. Failed\n");
+    printf("3. Passed\n");
+    printf("4. Success\n");
+
+    int choice = get_menu_choice(1, 4);
+    if (choice == -1)
+        return;
+
+    switch (choice)
+    {
+    case 1:
+        new_record.test_result = PENDING;
+        break;
+    case 2:
+        new_record.test_result = FAILED;
+        break;
+    case 3:
+        new_record.test_result = PASSED;
+        break;
+    case 4:
+        new_record.test_result = SUCCESS;
+        break;
+    }
+
+    // Add record to database
+    if (database_insert_record(&new_record))
+    {
+        printf("\n✓ Record added successfully! (TestID: %d)\n", new_record.test_id);
+        printf("1 record added to database.\n");
+    }
+    else
+    {
+        printf("✗ Error saving to database.\n");
+    }
+
+    pause_screen();
+}
+
+void search_records(void)
+{
+    clear_screen();
+    printf("SEARCH RECORDS\n");
+    printf("==============\n");
+    printf("1. Text in any field\n");
+    printf("2. Filter expression\n");
+
+    int mode = get_menu_choice(1, 2);
+    if (mode == -1)
+        return;
+
+    char search_term[512];
+    QueryNode *query = NULL;
+    if (mode == 1)
+    {
+        if (!get_valid_input(search_term, sizeof(search_term), NULL, "Enter search term (min 3 characters)"))
+        {
+            return;
+        }
+
+        if (strlen(trim_string(search_term)) < 3)
+        {
+            printf("Search term must be at least 3 characters.\n");
+            pause_screen();
+            return;
+        }
+    }
+    else
+    {
+        printf("\nFields: id, system, type, result, active, deleted; combine with and, or, not, ( )\n");
+        printf("Example: system~\"API\" and result in (Failed,Pending) and id between 100 and 5000 and active\n\n");
+        if (!get_valid_input(search_term, sizeof(search_term), NULL, "Enter filter"))
+        {
+            return;
+        }
+
+        char error[MAX_LINE];
+        query = query_compile(trim_string(search_term), error, sizeof(error));
+        if (!query)
+        {
+            printf("✗ %s\n", error);
+            pause_screen();
+            return;
+        }
+    }
+
+    RowSet results;
+    if (!rowset_init(&results, db.count))
+    {
+        printf("Error: Unable to allocate memory for search results.\n");
+        query_free(query);
+        pause_screen();
+        return;
+    }
+    uint64_t start = now_ns();
+    TRACE_BEGIN("search");
+    int result_count = query ? query_select(query, &results) : search_matching_rows(search_term, &results);
+    TRACE_END("search");
+    metrics_record(METRIC_SEARCH, start);
+    query_free(query);
+    if (result_count < 0)
+    {
+        printf("Error: Unable to allocate memory for search results.\n");
+        rowset_free(&results);
+        pause_screen();
+        return;
+    }
+
+    if (result_count == 0)
+    {
+        printf("No records found matching '%s'.\n", search_term);
+        rowset_free(&results);
+        pause_screen();
+        return;
+    }
+
+    display_records_paginated(&results, "Search Results");
+
+    // Action menu for search results
+    printf("\nSelect an action:\n");
+    printf("1. Update a record\n");
+    printf("2. Delete a record\n");
+    printf("3. Return to main menu\n");
+
+    int action = get_menu_choice(1, 3);
+    if (action == -1 || action == 3)
+    {
+        rowset_free(&results);
+        return;
+    }
+
+    char input_buffer[20];
+    if (!get_valid_input(input_buffer, sizeof(input_buffer), validate_test_id, "Enter TestID from search results"))
+    {
+        rowset_free(&results);
+        return;
+    }
+
+    int test_id = atoi(trim_string(input_buffer));
+
+    // Verify TestID is in search results
+    int found = 0;
+    for (int i = 0; i < result_count; i++)
+    {
+        if (db.test_ids[results.rows[i]] == test_id)
+        {
+            found = 1;
+            break;
+        }
+    }
+
+    if (!found)
+    {
+        printf("TestID %d not found in search results.\n", test_id);
+        rowset_free(&results);
+        pause_screen();
+        return;
+    }
+
+    rowset_free(&results);
+
+    if (action == 1)
+    {
+        // Update record
+        int index = find_record_by_id(test_id);
+        if (index != -1)
+        {
+            clear_screen();
+            printf("--- Record to Update ---\n");
+            TestRecord record = database_get_record(index);
+            printf("TestID: %d\n", record.test_id);
+            printf("SystemName: %s\n", record_system_name(&record));
+            printf("TestType: %s\n", record_test_type(&record));
+            printf("TestResult: %s\n", test_result_to_string(record.test_result));
+
+            update_record_by_id(test_id);
+        }
+    }
+    else if (action == 2)
+    {
+        delete_record(test_id, 1);
+    }
+}
+
+void update_record(void)
+{
+    clear_screen();
+    printf("UPDATE RECORD\n");
+    printf("==============\n");
+    char input_buffer[20];
+    if (!get_valid_input(input_buffer, sizeof(input_buffer), validate_test_id, "Enter TestID to update"))
+    {
+        return;
+    }
+    int test_id = atoi(trim_string(input_buffer));
+
+    update_record_by_id(test_id);
+}
+
+void update_record_by_id(int test_id)
+{
+    int index = find_record_by_id(test_id);
+    if (index == -1 || !database_is_active(index))
+    {
+        printf("Record not found or has been deleted.\n");
+        pause_screen();
+        return;
+    }
+
+    // Edit a copy of the row; it is written back to the columns on save
+    TestRecord edited = database_get_record(index);
+    TestRecord *record = &edited;
+    TestRecord backup = edited; // Backup for rollback
+
+    clear_screen();
+    printf("You are about to modify the following record:\n");
+    printf("┌────────┬────────────────────────────────┬───────────────────────────┬──────────┐\n");
+    printf("│ TestID │ SystemName                     │ TestType                  │ Result   │\n");
+    printf("├────────┼────────────────────────────────┼───────────────────────────┼──────────┤\n");
+    printf("│ %-6d │ %-30s │ %-25s │ %-8s │\n", record->test_id, record_system_name(record), record_test_type(record),
+           test_result_to_string(record->test_result));
+    printf("└────────┴────────────────────────────────┴───────────────────────────┴──────────┘\n");
+
+    printf("\nSelect action:\n");
+    printf("1. Update record\n");
+    printf("2. Delete record\n");
+    printf("3. Return to menu\n");
+
+    printf("\n");
+
+    int action = get_menu_choice(1, 3);
+    if (action == -1 || action == 3)
+        return;
+
+    if (action == 2)
+    {
+        delete_record(test_id, 1);
+        return;
+    }
+
+    // Update mode
+    int changes_made = 0;
+
+    while (1)
+    {
+        clear_screen();
+        printf("--- Current Record (Unsaved) ---\n");
+        printf("┌────────┬────────────────────────────────┬───────────────────────────┬──────────┐\n");
+        printf("│ TestID │ SystemName                     │ TestType                  │ Result   │\n");
+        printf("├────────┼────────────────────────────────┼───────────────────────────┼──────────┤\n");
+        printf("│ %-6d │ %-30s │ %-25s │ %-8s │\n", record->test_id, record_system_name(record), record_test_type(record),
+               test_result_to_string(record->test_result));
+        printf("└────────┴────────────────────────────────┴───────────────────────────┴──────────┘\n");
+
+        printf("\nSelect field to update:\n");
+        printf("1. SystemName\n");
+        printf("2. TestType\n");
+        printf("3. TestResult\n");
+        printf("\nOther Options:\n");
+        printf("4. Save changes\n");
+        printf("5. Cancel (discard changes)\n");
+
+        printf("\n");
+
+        int field_choice = get_menu_choice(1, 5);
+        if (field_choice == -1)
+            continue;
+
+        if (field_choice == 5)
+        {
+            if (get_yes_no("Discard all changes?", 0, 1))
+            {
+                *record = backup; // Restore backup
+                printf("Changes discarded.\n");
+                pause_screen();
+                return;
+            }
+            continue;
+        }
+
+        if (field_choice == 4)
+        {
+            if (database_update_record(index, record))
+            {
+                printf("✓ Record updated successfully!\n");
+                if (changes_made)
+                {
+                    printf("1 record updated in database.\n");
+                }
+                else
+                {
+                    printf("No changes were made.\n");
+                }
+            }
+            else
+            {
+                printf("✗ Error saving to database.\n");
+            }
+            pause_screen();
+            return;
+        }
+
+        char buffer[256];
+        switch (field_choice)
+        {
+        case 1: // SystemName
+            if (get_valid_input(buffer, sizeof(buffer), validate_system_name,
+                                "Enter new System Name"))
+            {
+                char *trimmed = trim_string(buffer);
+                uint32_t code = dictionary_intern(&db.systems, trimmed, strlen(trimmed));
+                if (code == INVALID_CODE)
+                {
+                    printf("✗ Unable to allocate memory for SystemName.\n");
+                    break;
+                }
+                record->system_code = code;
+                changes_made = 1;
+                printf("✓ SystemName updated.\n");
+            }
+            break;
+
+        case 2: // TestType
+            if (get_valid_input(buffer, sizeof(buffer), validate_test_type,
+                                "Enter new Test Type"))
+            {
+                char *trimmed = trim_string(buffer);
+                uint32_t code = dictionary_intern(&db.types, trimmed, strlen(trimmed));
+                if (code == INVALID_CODE)
+                {
+                    printf("✗ Unable to allocate memory for TestType.\n");
+                    break;
+                }
+                record->type_code = code;
+                changes_made = 1;
+                printf("✓ TestType updated.\n");
+            }
+            break;
+
+        case 3: // TestResult
+            printf("Select new Test Result:\n");
+            printf("1. Pending\n2. Failed\n3. Passed\n4. Success\n");
+            int result_choice = get_menu_choice(1, 4);
+            if (result_choice != -1)
+            {
+                TestResult old_result = record->test_result;
+                switch (result_choice)
+                {
+                case 1:
+                    record->test_result = PENDING;
+                    break;
+                case 2:
+                    record->test_result = FAILED;
+                    break;
+                case 3:
+                    record->test_result = PASSED;
+                    break;
+                case 4:
+                    record->test_result = SUCCESS;
+                    break;
+                }
+                if (record->test_result != old_result)
+                {
+                    changes_made = 1;
+                    printf("✓ TestResult updated.\n");
+                }
+            }
+            break;
+        }
+    }
+}
+
+void delete_record(int test_id, int soft_delete)
+{
+    int index = find_record_by_id(test_id);
+    if (index == -1)
+    {
+        printf("Record with TestID %d not found.\n", test_id);
+        pause_screen();
+        return;
+    }
+
+    TestRecord row = database_get_record(index);
+    const TestRecord *record = &row;
+
+    if (soft_delete && !record->active)
+    {
+        printf("Record is already deleted.\n");
+        pause_screen();
+        return;
+    }
+
+    if (!soft_delete && record->active)
+    {
+        printf("Record must be soft-deleted first.\n");
+        pause_screen();
+        return;
+    }
+
+    clear_screen();
+    printf("You are about to %s the following record:\n", soft_delete ? "delete" : "permanently delete");
+    printf("┌────────┬────────────────────────────────┬───────────────────────────┬──────────┐\n");
+    printf("│ TestID │ SystemName                     │ TestType                  │ Result   │\n");
+    printf("├────────┼────────────────────────────────┼───────────────────────────┼──────────┤\n");
+    printf("│ %-6d │ %-30s │ %-25s │ %-8s │\n", record->test_id, record_system_name(record), record_test_type(record),
+           test_result_to_string(record->test_result));
+    printf("└────────┴────────────────────────────────┴───────────────────────────┴──────────┘\n");
+
+    printf("\n");
+
+    if (!get_yes_no(soft_delete ? "Are you sure you want to delete this record?" : "Are you sure you want to permanently delete this record?", 0, 3))
+    {
+        printf("Operation cancelled.\n");
+        pause_screen();
+        return;
+    }
+
+    if (soft_delete)
+    {
+        if (database_set_active(index, 0))
+        {
+            printf("✓ Record soft-deleted successfully!\n");
+            printf("1 record deleted from active records.\n");
+        }
+        else
+        {
+            printf("✗ Error saving to database.\n");
+        }
+    }
+    else
+    {
+        // Permanent delete - remove from array
+        if (database_purge_record(index))
+        {
+            printf("✓ Record permanently deleted!\n");
+            printf("1 record permanently removed from database.\n");
+        }
+        else
+        {
+            printf("✗ Error saving to database.\n");
+        }
+    }
+    pause_screen();
+}
+
+void recovery_data(void)
+{
+    clear_screen();
+    printf("RECOVERY DATA\n");
+    printf("=============\n");
+
+    // Filter deleted records
+    RowSet deleted_records;
+    if (!rowset_select(&deleted_records, 0))
+    {
+        printf("Memory allocation failed. Unable to recover deleted records.\n");
+        pause_screen();
+        return;
+    }
+
+    if (deleted_records.count == 0)
+    {
+        printf("No deleted records found.\n");
+        rowset_free(&deleted_records);
+        pause_screen();
+        return;
+    }
+
+    display_records_paginated(&deleted_records, "Deleted Records");
+
+    printf("\nSelect action:\n");
+    printf("1. Recover a record\n");
+    printf("2. Permanently delete a record\n");
+    printf("3. Return to main menu\n");
+
+    printf("\n");
+
+    int action = get_menu_choice(1, 3);
+    if (action == -1 || action == 3)
+    {
+        rowset_free(&deleted_records);
+        return;
+    }
+
+    int attempts = 0;
+    while (attempts < MAX_ATTEMPTS)
+    {
+        char input_buffer[20];
+        if (!get_valid_input(input_buffer, sizeof(input_buffer), validate_test_id, "Enter TestID"))
+        {
+            rowset_free(&deleted_records);
+            return;
+        }
+        int test_id = atoi(trim_string(input_buffer));
+
+        int index = find_record_by_id(test_id);
+        if (index == -1 || database_is_active(index))
+        {
+            attempts++;
+            printf("TestID %d not found in deleted records.\n", test_id);
+            continue;
+        }
+
+        // Show the record
+        TestRecord row = database_get_record(index);
+        const TestRecord *record = &row;
+        clear_screen();
+        printf("You are about to %s the following record:\n", action == 1 ? "recover" : "permanently delete");
+        printf("┌────────┬────────────────────────────────┬───────────────────────────┬──────────┐\n");
+        printf("│ TestID │ SystemName                     │ TestType                  │ Result   │\n");
+        printf("├────────┼────────────────────────────────┼───────────────────────────┼──────────┤\n");
+        printf("│ %-6d │ %-30s │ %-25s │ %-8s │\n", record->test_id, record_system_name(record), record_test_type(record),
+               test_result_to_string(record->test_result));
+        printf("└────────┴────────────────────────────────┴───────────────────────────┴──────────┘\n");
+
+        if (action == 1)
+        {
+            if (get_yes_no("Confirm recovery of this record?", 0, 3))
+            {
+                if (database_set_active(index, 1))
+                {
+                    printf("✓ Record recovered successfully!\n");
+                    printf("1 record recovered.\n");
+                }
+                else
+                {
+                    printf("✗ Error saving to database.\n");
+                }
+            }
+            else
+            {
+                printf("Recovery cancelled.\n");
+            }
+        }
+        else if (action == 2)
+        {
+            printf("\n⚠️  WARNING: This will permanently delete the record.\n");
+
+            char confirm_input[20];
+            char expected_id[20];
+            snprintf(expected_id, sizeof(expected_id), "%d", test_id);
+
+            if (!get_valid_input(confirm_input, sizeof(confirm_input), NULL,
+                                 "Type the TestID again to confirm permanent deletion"))
+            {
+                rowset_free(&deleted_records);
+                return;
+            }
+
+            if (strcmp(trim_string(confirm_input), expected_id) == 0)
+            {
+                delete_record(test_id, 0);
+                rowset_free(&deleted_records);
+                return;
+            }
+            else
+            {
+                printf("TestID mismatch. Operation cancelled.\n");
+            }
+        }
+
+        rowset_free(&deleted_records);
+        pause_screen();
+        return;
+    }
+
+    printf("Maximum attempts reached. Returning to main menu.\n");
+    rowset_free(&deleted_records);
+    pause_screen();
+}
+
+int create_new_database_prompt(void)
+{
+    char filename[MAX_PATH];
+    if (get_valid_input(filename, sizeof(filename), NULL, "Enter database name"))
+    {
+        if (create_new_csv(filename))
+        {
+            printf("✓ Database created successfully: %s\n", db.filename);
+            pause_screen();
+            return 1;
+        }
+        else
+        {
+            printf("✗ Error creating database.\n");
+            pause_screen();
+            return 0;
+        }
+    }
+    return 0;
+}
+
+int enter_manual_path_prompt(void)
+{
+    char path[MAX_PATH];
+    if (get_valid_input(path, sizeof(path), NULL, "Enter CSV file path"))
+    {
+        if ((is_binary_database_file(path) || validate_csv_header(path)) && load_database(path))
+        {
+            printf("✓ Database loaded successfully: %s\n", db.filename);
+            pause_screen();
+            return 1;
+        }
+        else
+        {
+            printf("✗ Invalid CSV file or header format.\n");
+            pause_screen();
+            return 0;
+        }
+    }
+    return 0;
+}
+
+int select_database(void)
+{
+    clear_screen();
+    printf("SELECT DATABASE\n");
+    printf("===============\n");
+
+    char files[MAX_FILES][MAX_PATH];
+    int file_count = scan_csv_files(files);
+
+    if (file_count == 0)
+    {
+        printf("No CSV files found in current directory.\n\n");
+        printf("Options:\n");
+        printf("1. Create new database\n");
+        printf("2. Enter manual path\n");
+        printf("3. Do nothing\n");
+        printf("\n");
+
+        int choice = get_menu_choice(1, 3);
+        if (choice == -1 || choice == 3)
+            return 0;
+
+        if (choice == 1)
+        {
+            return create_new_database_prompt();
+        }
+
+        if (choice == 2)
+        {
+
+            return enter_manual_path_prompt();
+        }
+    }
+
+    printf("Found %d CSV file(s):\n", file_count);
+    for (int i = 0; i < file_count; i++)
+    {
+        printf("%d. %s\n", i + 1, files[i]);
+    }
+
+    printf("\nOther Options:\n");
+
+    printf("%d. Create new database\n", file_count + 1);
+    printf("%d. Enter manual path\n", file_count + 2);
+    printf("%d. Do nothing\n", file_count + 3);
+
+    printf("\n");
+
+    int choice = get_menu_choice(1, file_count + 3);
+    if (choice == -1 || choice == file_count + 3)
+        return 0;
+
+    if (choice == file_count + 1)
+    {
+        return create_new_database_prompt();
+    }
+
+    if (choice == file_count + 2)
+    {
+        return enter_manual_path_prompt();
+    }
+
+    // Load selected file
+    char *selected_file = files[choice - 1];
+
+    if (!is_binary_database_file(selected_file) && !validate_csv_header(selected_file))
+    {
+        printf("✗ Invalid header format in %s\n", selected_file);
+        printf("Required header: %s\n", REQUIRED_HEADER);
+
+        if (get_yes_no("Try another file?", 0, 1))
+        {
+            return select_database();
+        }
+        return 0;
+    }
+
+    if (load_database(selected_file))
+    {
+        printf("✓ Database loaded successfully: %s\n", db.filename);
+        printf("Records loaded: %d\n", db.count);
+        pause_screen();
+        return 1;
+    }
+    else
+    {
+        printf("✗ Error loading database.\n");
+        pause_screen();
+        return 0;
+    }
+}
+
+int change_database(void)
+{
+    if (!get_yes_no("Current database will be closed. Continue?", 0, 1))
+    {
+        return 0;
+    }
+
+    if (!database_checkpoint())
+    {
+        printf("Warning: Unable to write %s; changes remain in its journal.\n", db.filename);
+    }
+
+    if (select_database())
+    {
+        printf("Database changed successfully.\n");
+        return 1;
+    }
+    else
+    {
+        printf("No database selected. Exiting to main menu.\n");
+        return 0;
+    }
+}
+
+// Rows for the search, save and archive tests: names sharing substrings in
+// different cases, and types to match
+const char *test_systems[5] = {"WebApp Frontend", "API Gateway", "Billing-API", "Data Lake", "ab"};
+const char *test_types[4] = {"UnitTest", "IntegrationTest", "LoadTest", "apiTest"};
+
+// Scratch files the save, snapshot and archive tests compare byte for byte
+const char *test_serialized_file = "serializer_test.csv";
+const char *test_stdio_file = "serializer_stdio.csv";
+
+// Swaps in an empty database for one test function; returns the session's
+// database for test_database_end, or NULL if it could not be backed up
+Database *test_database_begin(const char *filename)
+{
+    Database *original_db = malloc(sizeof(Database));
+    if (!original_db)
+    {
+        printf("Error: Unable to allocate memory for database backup.\n");
+        return NULL;
+    }
+    memcpy(original_db, &db, sizeof(Database));
+
+    // Initialize test database (original buffer stays owned by the backup)
+    memset(&db, 0, sizeof(db));
+    strcpy(db.filename, filename);
+    db.next_id = 1;
+    return original_db;
+}
+
+void test_database_end(Database *original_db)
+{
+    database_reset();
+    db = *original_db;
+    free(original_db);
+}
+
+void test_input_validation(void)
+{
+    printf("Running Input Validation Tests...\n");
+
+    // Test validate_system_name function
+    printf("Testing validate_system_name...\n");
+
+    // Valid system names
+    assert(validate_system_name("System123") == 1);
+    assert(validate_system_name("Test-System_v1.0") == 1);
+    assert(validate_system_name("System (Main)") == 1);
+    assert(validate_system_name("System[Backend]") == 1);
+    assert(validate_system_name("API Gateway Server") == 1);
+    assert(validate_system_name("DB-Server_v2.1") == 1);
+
+    // Invalid system names - too short
+    assert(validate_system_name("AB") == 0);
+    assert(validate_system_name("X") == 0);
+    assert(validate_system_name("") == 0);
+
+    // Invalid system names - invalid characters
+    assert(validate_system_name("System@Test") == 0);
+    assert(validate_system_name("System#Test") == 0);
+    assert(validate_system_name("System$Test") == 0);
+    assert(validate_system_name("System%Test") == 0);
+    assert(validate_system_name("System&Test") == 0);
+    assert(validate_system_name("System*Test") == 0);
+    assert(validate_system_name("System+Test") == 0);
+    assert(validate_system_name("System=Test") == 0);
+    assert(validate_system_name("System/Test") == 0);
+    assert(validate_system_name("System\\Test") == 0);
+    assert(validate_system_name("System|Test") == 0);
+    assert(validate_system_name("System<Test") == 0);
+    assert(validate_system_name("System>Test") == 0);
+    assert(validate_system_name("System?Test") == 0);
+    assert(validate_system_name("System!Test") == 0);
+    assert(validate_system_name("System\"Test") == 0);
+    assert(validate_system_name("System'Test") == 0);
+    assert(validate_system_name("System:Test") == 0);
+    assert(validate_system_name("System;Test") == 0);
+    assert(validate_system_name("System,Test") == 0);
+
+    // Edge cases
+    assert(validate_system_name(NULL) == 0);
+    assert(validate_system_name("   ") == 0);     // Only whitespace
+    assert(validate_system_name("  ABC  ") == 1); // Should trim and pass
+
+    printf("✓ validate_system_name tests passed\n");
+
+    // Test validate_test_type function
+    printf("Testing validate_test_type...\n");
+
+    // Valid test types
+    assert(validate_test_type("API") == 1);
+    assert(validate_test_type("UnitTest") == 1);
+    assert(validate_test_type("IntegrationTest") == 1);
+    assert(validate_test_type("SystemTest") == 1);
+    assert(validate_test_type("PerformanceTest") == 1);
+    assert(validate_test_type("SecurityTest") == 1);
+    assert(validate_test_type("ABC123") == 1);
+    assert(validate_test_type("Test123") == 1);
+
+    // Invalid test types - too short
+    assert(validate_test_type("AB") == 0);
+    assert(validate_test_type("X") == 0);
+    assert(validate_test_type("") == 0);
+
+    // Invalid test types - invalid characters
+    assert(validate_test_type("Test-Case") == 0);  // Hyphen not allowed
+    assert(validate_test_type("Test_Case") == 0);  // Underscore not allowed
+    assert(validate_test_type("Test Case") == 0);  // Space not allowed
+    assert(validate_test_type("Test.Case") == 0);  // Dot not allowed
+    assert(validate_test_type("Test(Case)") == 0); // Parentheses not allowed
+    assert(validate_test_type("Test[Case]") == 0); // Brackets not allowed
+    assert(validate_test_type("Test@Case") == 0);
+    assert(validate_test_type("Test#Case") == 0);
+    assert(validate_test_type("Test$Case") == 0);
+    assert(validate_test_type("Test%Case") == 0);
+    assert(validate_test_type("Test&Case") == 0);
+    assert(validate_test_type("Test*Case") == 0);
+
+    // Edge cases
+    assert(validate_test_type(NULL) == 0);
+    assert(validate_test_type("   ") == 0);     // Only whitespace
+    assert(validate_test_type("  ABC  ") == 1); // Should trim and pass
+
+    printf("✓ validate_test_type tests passed\n");
+
+    // Test validate_test_id function
+    printf("Testing validate_test_id...\n");
+
+    // Valid test IDs
+    assert(validate_test_id("1") == 1);
+    assert(validate_test_id("123") == 1);
+    assert(validate_test_id("999999") == 1);
+    assert(validate_test_id("  123  ") == 1); // Should trim and pass
+
+    // Invalid test IDs - zero or negative
+    assert(validate_test_id("0") == 0);
+    assert(validate_test_id("-1") == 0);
+    assert(validate_test_id("-123") == 0);
+
+    // Invalid test IDs - non-numeric
+    assert(validate_test_id("ABC") == 0);
+    assert(validate_test_id("12A") == 0);
+    assert(validate_test_id("A123") == 0);
+    assert(validate_test_id("12.34") == 0);
+    assert(validate_test_id("12-34") == 0);
+    assert(validate_test_id("12 34") == 0);
+    assert(validate_test_id("") == 0);
+
+    // Edge cases
+    assert(validate_test_id(NULL) == 0);
+    assert(validate_test_id("   ") == 0); // Only whitespace
+
+    printf("✓ validate_test_id tests passed\n");
+
+    // Test trim_string function
+    printf("Testing trim_string...\n");
+
+    char test_str1[] = "  hello  ";
+    char *result1 = trim_string(test_str1);
+    assert(strcmp(result1, "hello") == 0);
+
+    char test_str2[] = "hello";
+    char *result2 = trim_string(test_str2);
+    assert(strcmp(result2, "hello") == 0);
+
+    char test_str3[] = "  hello";
+    char *result3 = trim_string(test_str3);
+    assert(strcmp(result3, "hello") == 0);
+
+    char test_str4[] = "hello  ";
+    char *result4 = trim_string(test_str4);
+    assert(strcmp(result4, "hello") == 0);
+
+    char test_str5[] = "   ";
+    char *result5 = trim_string(test_str5);
+    assert(strcmp(result5, "") == 0);
+
+    char test_str6[] = "";
+    char *result6 = trim_string(test_str6);
+    assert(strcmp(result6, "") == 0);
+
+    // Test NULL input
+    assert(trim_string(NULL) == NULL);
+
+    printf("✓ trim_string tests passed\n");
+
+    // Test string_to_test_result function
+    printf("Testing string_to_test_result...\n");
+
+    assert(string_to_test_result("Failed") == FAILED);
+    assert(string_to_test_result("failed") == FAILED);
+    assert(string_to_test_result("FAILED") == FAILED);
+    assert(string_to_test_result("Passed") == PASSED);
+    assert(string_to_test_result("passed") == PASSED);
+    assert(string_to_test_result("PASSED") == PASSED);
     assert(string_to_test_result("Pending") == PENDING);
     assert(string_to_test_result("pending") == PENDING);
     assert(string_to_test_result("PENDING") == PENDING);
@@ -1665,41 +6787,2583 @@ void test_input_validation(void)
     assert(string_to_test_result("success") == SUCCESS);
     assert(string_to_test_result("SUCCESS") == SUCCESS);
 
-    // Invalid results
-    assert(string_to_test_result("Invalid") == INVALID_RESULT);
-    assert(string_to_test_result("Unknown") == INVALID_RESULT);
-    assert(string_to_test_result("") == INVALID_RESULT);
-    assert(string_to_test_result(NULL) == INVALID_RESULT);
+    // Invalid results
+    assert(string_to_test_result("Invalid") == INVALID_RESULT);
+    assert(string_to_test_result("Unknown") == INVALID_RESULT);
+    assert(string_to_test_result("") == INVALID_RESULT);
+    assert(string_to_test_result(NULL) == INVALID_RESULT);
+
+    printf("✓ string_to_test_result tests passed\n");
+
+    // Test test_result_to_string function
+    printf("Testing test_result_to_string...\n");
+
+    assert(strcmp(test_result_to_string(FAILED), "Failed") == 0);
+    assert(strcmp(test_result_to_string(PASSED), "Passed") == 0);
+    assert(strcmp(test_result_to_string(PENDING), "Pending") == 0);
+    assert(strcmp(test_result_to_string(SUCCESS), "Success") == 0);
+    assert(strcmp(test_result_to_string(INVALID_RESULT), "Unknown") == 0);
+    assert(strcmp(test_result_to_string(-999), "Unknown") == 0); // Invalid enum value
+
+    printf("✓ test_result_to_string tests passed\n");
+
+    printf("\nAll Input Validation Tests PASSED!\n");
+    printf("Total test categories: 6\n");
+    printf("- validate_system_name: ✓\n");
+    printf("- validate_test_type: ✓\n");
+    printf("- validate_test_id: ✓\n");
+    printf("- trim_string: ✓\n");
+    printf("- string_to_test_result: ✓\n");
+    printf("- test_result_to_string: ✓\n");
+}
+
+void test_crud_operations(void)
+{
+    printf("Running CRUD Operations Tests...\n");
+
+    Database *original_db = test_database_begin("crud_test.csv");
+    if (!original_db)
+        return;
+
+    printf("Testing find_record_by_id...\n");
+
+    // Test empty database
+    assert(find_record_by_id(1) == -1);
+    assert(find_record_by_id(999) == -1);
+
+    // Add test records
+    TestRecord test_record1 = make_record(1, "TestSystem1", "UnitTest", PASSED, 1);
+    TestRecord test_record2 = make_record(2, "TestSystem2", "IntegrationTest", FAILED, 1);
+    TestRecord test_record3 = make_record(3, "TestSystem3", "SystemTest", PENDING, 0); // Deleted record
+
+    int stored = database_append_record(&test_record1);
+    assert(stored == 1);
+    stored = database_append_record(&test_record2);
+    assert(stored == 1);
+    stored = database_append_record(&test_record3);
+    assert(stored == 1);
+    assert(db.count == 3);
+
+    // Test finding existing records
+    assert(find_record_by_id(1) == 0);
+    assert(find_record_by_id(2) == 1);
+    assert(find_record_by_id(3) == 2);
+
+    // Test finding non-existing records
+    assert(find_record_by_id(4) == -1);
+    assert(find_record_by_id(999) == -1);
+    assert(find_record_by_id(0) == -1);
+    assert(find_record_by_id(-1) == -1);
+
+    printf("✓ find_record_by_id tests passed\n");
+
+    printf("Testing get_next_test_id...\n");
+
+    // Test initial state
+    db.next_id = 5;
+    assert(get_next_test_id() == 5);
+    assert(db.next_id == 6); // Should increment
+    assert(get_next_test_id() == 6);
+    assert(db.next_id == 7); // Should increment again
+
+    printf("✓ get_next_test_id tests passed\n");
+
+    printf("Testing database record validation...\n");
+
+    // Test valid records
+    TestRecord valid_record = make_record(10, "ValidSystem", "ValidTest", PASSED, 1);
+    assert(valid_record.test_id > 0);
+    assert(strlen(record_system_name(&valid_record)) >= MIN_NAME_LENGTH);
+    assert(strlen(record_test_type(&valid_record)) >= MIN_NAME_LENGTH);
+    assert(valid_record.test_result >= FAILED && valid_record.test_result <= SUCCESS);
+    assert(valid_record.active == 0 || valid_record.active == 1);
+
+    // Test edge cases for record fields
+    TestRecord edge_record1 = make_record(1, "ABC", "DEF", FAILED, 0); // Minimum length names
+    assert(strlen(record_system_name(&edge_record1)) == MIN_NAME_LENGTH);
+    assert(strlen(record_test_type(&edge_record1)) == MIN_NAME_LENGTH);
+
+    TestRecord edge_record2 = make_record(999999, "Very Long System Name", "VeryLongTestType", SUCCESS, 1);
+    assert(edge_record2.test_id > 0);
+    assert(strlen(record_system_name(&edge_record2)) > MIN_NAME_LENGTH);
+    assert(strlen(record_test_type(&edge_record2)) > MIN_NAME_LENGTH);
+
+    // Test that removing a row shifts every column together
+    TestRecord removable = make_record(4, "TestSystem4", "RemoveTest", SUCCESS, 0);
+    stored = database_append_record(&removable);
+    assert(stored == 1);
+    database_remove_record(1);
+    assert(db.count == 3);
+    assert(db.test_ids[1] == 3 && db.results[1] == PENDING && database_is_active(1) == 0);
+    TestRecord shifted = database_get_record(2);
+    assert(shifted.test_id == 4 && shifted.test_result == SUCCESS);
+    assert(strcmp(record_test_type(&shifted), "RemoveTest") == 0);
+    database_set_record(1, &test_record2);
+    database_set_record(2, &test_record3);
+
+    printf("✓ database record validation tests passed\n");
+
+    printf("Testing validate_csv_header (mock)...\n");
+
+    // Test required header format
+    const char *required = REQUIRED_HEADER;
+    assert(strcmp(required, "TestID,SystemName,TestType,TestResult,Active") == 0);
+
+    printf("✓ CSV header validation tests passed\n");
+
+    printf("Testing database bounds checking...\n");
+
+    // Test record store growth past the old fixed limit of 10000
+    int test_count = 25000;
+    int reserved = database_reserve(test_count);
+    assert(reserved == 1);
+    assert(db.capacity >= test_count);
+    assert(find_record_by_id(2) == 1); // Existing records survive growth
+    for (int i = db.count; i < test_count; i++)
+    {
+        TestRecord grown_record = make_record(i + 1, "GrowthSystem", "GrowthTest", PASSED, 1);
+        database_set_record(db.count++, &grown_record);
+    }
+    assert(db.count == test_count);
+    assert(db.test_ids[test_count - 1] == test_count);
+    TestRecord first_record = database_get_record(0);
+    assert(strcmp(record_system_name(&first_record), "TestSystem1") == 0);
+    assert(db.system_codes[1] != db.system_codes[0]);
+    assert(db.system_codes[test_count - 1] == db.system_codes[3]); // Interned once
+    reserved = database_reserve(1);
+    assert(reserved == 1); // Never shrinks
+    assert(db.capacity >= test_count);
+    printf("✓ Record store grows beyond %d records\n", test_count);
+
+    // Test minimum valid test ID
+    assert(1 > 0); // Minimum valid test ID is 1
+
+    // Test enum bounds
+    assert(FAILED == 0);
+    assert(PASSED == 1);
+    assert(PENDING == 2);
+    assert(SUCCESS == 3);
+    assert(INVALID_RESULT == -1);
+
+    printf("✓ database bounds checking tests passed\n");
+
+    printf("Testing memory safety (basic checks)...\n");
+
+    // Test that stored strings are independent, NUL-terminated copies
+    char test_system[100] = "TestSystemName";
+    char test_type[100] = "TestTypeWithSuffix";
+    const char *stored_system = database_store_string(test_system, strlen(test_system));
+    const char *stored_type = database_store_string(test_type, 8);
+    assert(stored_system != NULL && stored_system != test_system);
+    assert(stored_type != NULL);
+
+    test_system[0] = 'X';
+    assert(strcmp(stored_system, "TestSystemName") == 0);
+    assert(strcmp(stored_type, "TestType") == 0);
+
+    // Test that the dictionaries own their strings and hand out stable codes
+    char interned[32] = "InternedSystem";
+    uint32_t interned_code = dictionary_intern(&db.systems, interned, strlen(interned));
+    assert(interned_code != INVALID_CODE);
+    interned[0] = 'X';
+    assert(strcmp(db.systems.strings[interned_code], "InternedSystem") == 0);
+    assert(dictionary_find(&db.systems, "InternedSystem", 14) == interned_code);
+    uint32_t reinterned = dictionary_intern(&db.systems, "InternedSystem", 14);
+    assert(reinterned == interned_code);
+    assert(dictionary_find(&db.systems, "XnternedSystem", 14) == INVALID_CODE);
+    assert(dictionary_find(&db.systems, "Interned", 8) == INVALID_CODE);
+    assert(sizeof(TestRecord) <= 16);
+
+    // Test strtok-compatible field splitting
+    char split_line[] = "7,,Name,,Type,Passed,1,extra";
+    char *fields[RECORD_FIELDS];
+    int split_count = split_csv_fields(split_line, fields, RECORD_FIELDS);
+    assert(split_count == RECORD_FIELDS);
+    assert(strcmp(fields[0], "7") == 0);
+    assert(strcmp(fields[1], "Name") == 0);
+    assert(strcmp(fields[2], "Type") == 0);
+    assert(strcmp(fields[4], "1") == 0);
+
+    // Test the structural scanner against split_csv_fields for every kernel
+    const char *scan_lines[] = {
+        "7,,Name,,Type,Passed,1,extra",
+        "8,Cut Here\r,Ignored,Passed",
+        ",,,",
+        "",
+        "9,A very long system name that spans more than one sixty-four byte block,LongType,Failed,0"};
+    StructuralMaskFn scan_kernels[] = {
+        structural_mask_scalar,
+#ifdef HAVE_X86_SIMD
+        __builtin_cpu_supports("sse2") ? structural_mask_sse2 : structural_mask_scalar,
+        __builtin_cpu_supports("avx2") ? structural_mask_avx2 : structural_mask_scalar,
+#endif
+    };
+    init_structural_scanner();
+    StructuralMaskFn saved_kernel = structural_mask;
+    for (size_t k = 0; k < sizeof(scan_kernels) / sizeof(scan_kernels[0]); k++)
+    {
+        char scan_buffer[512] = "";
+        for (size_t i = 0; i < sizeof(scan_lines) / sizeof(scan_lines[0]); i++)
+        {
+            strcat(scan_buffer, scan_lines[i]);
+            strcat(scan_buffer, "\n");
+        }
+
+        structural_mask = scan_kernels[k];
+        StructuralScanner scanner;
+        scanner_init(&scanner, scan_buffer, scan_buffer + strlen(scan_buffer));
+        char *scan_line = scan_buffer;
+        for (size_t i = 0; i < sizeof(scan_lines) / sizeof(scan_lines[0]); i++)
+        {
+            char expected_line[256];
+            char *expected[RECORD_FIELDS];
+            char *scanned[RECORD_FIELDS];
+            int scanned_count;
+            strcpy(expected_line, scan_lines[i]);
+            expected_line[strcspn(expected_line, "\r")] = '\0';
+            int expected_count = split_csv_fields(expected_line, expected, RECORD_FIELDS);
+
+            scan_line = scan_record_fields(&scanner, scan_line, scanned, &scanned_count);
+            assert(scanned_count == expected_count);
+            for (int f = 0; f < scanned_count; f++)
+            {
+                assert(strcmp(scanned[f], expected[f]) == 0);
+            }
+        }
+        assert(scan_line == scan_buffer + strlen(scan_lines[0]) + 1 + strlen(scan_lines[1]) + 1 +
+                                strlen(scan_lines[2]) + 1 + 1 + strlen(scan_lines[4]) + 1);
+    }
+    structural_mask = saved_kernel;
+
+    printf("✓ memory safety tests passed\n");
+
+    // Restore original database state
+    test_database_end(original_db);
+
+    printf("\nAll CRUD Operations Tests PASSED!\n");
+    printf("Total test categories: 6\n");
+    printf("- find_record_by_id: ✓\n");
+    printf("- get_next_test_id: ✓\n");
+    printf("- database record validation: ✓\n");
+    printf("- CSV header validation: ✓\n");
+    printf("- database bounds checking: ✓\n");
+    printf("- memory safety: ✓\n");
+}
+
+void test_record_storage(void)
+{
+    printf("Running Record Storage Tests...\n");
+
+    Database *original_db = test_database_begin("storage_test.csv");
+    if (!original_db)
+        return;
+
+    printf("Testing TestID index...\n");
+
+    // Dense, sparse and duplicate IDs must all agree with a linear scan
+    uint32_t index_seed = 7;
+    for (int layout = 0; layout < 3; layout++)
+    {
+        database_reset();
+        for (int i = 0; i < 3000; i++)
+        {
+            index_seed = index_seed * 1103515245u + 12345u;
+            int id = layout == 0 ? i + 1 : layout == 1 ? (int)(index_seed >> 1) % 1000000 + 1 : i % 700 + 1;
+            TestRecord indexed = make_record(id, "IndexSystem", "IndexTest", PASSED, 1);
+            int stored = database_append_record(&indexed);
+            assert(stored == 1);
+            if (i == 1500)
+                assert(find_record_by_id(id) >= 0); // Later rows are picked up on the next lookup
+        }
+        assert(db.ids.sparse == (layout == 1));
+
+        for (int step = 0; step < 400; step++)
+        {
+            index_seed = index_seed * 1103515245u + 12345u;
+            int row = (int)(index_seed >> 8) % db.count;
+            if (step % 3 == 0)
+            {
+                database_remove_record(row);
+            }
+            else if (step % 3 == 1)
+            {
+                TestRecord moved = database_get_record(row);
+                moved.test_id = (int)(index_seed >> 12) % 5000 + 1;
+                database_set_record(row, &moved);
+            }
+            else
+            {
+                TestRecord appended = make_record(layout == 1 ? 2000000 + step : 3000 + step,
+                                                  "IndexSystem", "IndexTest", PASSED, 1);
+                int stored = database_append_record(&appended);
+                assert(stored == 1);
+            }
+
+            for (int probe = 0; probe < 50; probe++)
+            {
+                index_seed = index_seed * 1103515245u + 12345u;
+                int id = probe % 2 ? db.test_ids[(index_seed >> 8) % db.count] : (int)(index_seed >> 8) % 2100000;
+                int expected = -1;
+                for (int i = 0; i < db.count && expected < 0; i++)
+                {
+                    if (db.test_ids[i] == id)
+                        expected = i;
+                }
+                assert(find_record_by_id(id) == expected);
+            }
+        }
+    }
+    // Ascending IDs past the dense range switch the index to the hash table
+    database_reset();
+    for (int i = 1; i <= 100; i++)
+    {
+        TestRecord ascending = make_record(i, "IndexSystem", "IndexTest", PASSED, 1);
+        int stored = database_append_record(&ascending);
+        assert(stored == 1);
+    }
+    assert(find_record_by_id(50) == 49 && db.ids.sparse == 0);
+    TestRecord far_id = make_record(INT_MAX, "IndexSystem", "IndexTest", PASSED, 1);
+    int stored = database_append_record(&far_id);
+    assert(stored == 1);
+    assert(find_record_by_id(INT_MAX) == 100 && db.ids.sparse == 1);
+    assert(find_record_by_id(50) == 49 && find_record_by_id(101) == -1);
+
+    // Many appends between two lookups can cross the threshold partway through one sync
+    database_reset();
+    for (int i = 1; i <= 100; i++)
+    {
+        TestRecord before = make_record(i, "IndexSystem", "IndexTest", PASSED, 1);
+        stored = database_append_record(&before);
+        assert(stored == 1);
+    }
+    assert(find_record_by_id(50) == 49);
+    for (int i = 101; i <= 1100; i++)
+    {
+        TestRecord after = make_record(i == 600 ? INT_MAX : i, "IndexSystem", "IndexTest", PASSED, 1);
+        stored = database_append_record(&after);
+        assert(stored == 1);
+    }
+    for (int i = 1; i <= 1100; i++)
+        assert(find_record_by_id(i == 600 ? INT_MAX : i) == i - 1);
+    assert(db.ids.sparse == 1);
+    database_reset();
+
+    printf("✓ TestID index tests passed\n");
+
+    printf("Testing active bitmap...\n");
+
+    // Mirror the bitmap in a byte array through appends, toggles and removals
+    uint8_t expected_active[700];
+    int expected_rows = 0;
+    uint32_t bitmap_seed = 31;
+    database_reset();
+    for (int step = 0; step < 3000; step++)
+    {
+        bitmap_seed = bitmap_seed * 1103515245u + 12345u;
+        int op = (int)(bitmap_seed >> 16) % 4;
+        if ((op == 0 || expected_rows == 0) && expected_rows < (int)sizeof(expected_active))
+        {
+            int active = (bitmap_seed >> 8) & 1;
+            TestRecord bit_row = make_record(step + 1, "BitmapSystem", "BitmapTest", PASSED, active);
+            stored = database_append_record(&bit_row);
+            assert(stored == 1);
+            expected_active[expected_rows++] = (uint8_t)active;
+        }
+        else if (expected_rows > 0)
+        {
+            int row = (int)(bitmap_seed >> 4) % expected_rows;
+            if (op == 1)
+            {
+                database_remove_record(row);
+                memmove(expected_active + row, expected_active + row + 1, (size_t)(expected_rows - row - 1));
+                expected_rows--;
+            }
+            else
+            {
+                database_mark_active(row, op == 2);
+                expected_active[row] = op == 2;
+            }
+        }
+
+        int expected_count = 0;
+        for (int i = 0; i < expected_rows; i++)
+        {
+            assert(database_is_active(i) == expected_active[i]);
+            expected_count += expected_active[i];
+        }
+        assert(db.count == expected_rows);
+        assert(database_count_active() == expected_count);
+        assert(database_count_deleted() == expected_rows - expected_count);
+
+        if (step % 100 == 0)
+        {
+            for (int state = 0; state <= 1; state++)
+            {
+                RowSet selected;
+                int filled = rowset_select(&selected, state);
+                assert(filled == 1);
+                int next = 0;
+                for (int i = 0; i < expected_rows; i++)
+                {
+                    if (expected_active[i] == state)
+                    {
+                        assert(next < selected.count && selected.rows[next] == (uint32_t)i);
+                        next++;
+                    }
+                }
+                assert(next == selected.count);
+                rowset_free(&selected);
+            }
+        }
+    }
+    assert(bitmap_popcount_portable(db.active_bits, ((size_t)db.count + 63) / 64) == (size_t)database_count_active());
+    database_reset();
+
+    printf("✓ active bitmap tests passed\n");
+
+    // Restore original database state
+    test_database_end(original_db);
+
+    printf("\nAll Record Storage Tests PASSED!\n");
+    printf("Total test categories: 2\n");
+    printf("- TestID index: ✓\n");
+    printf("- active bitmap: ✓\n");
+}
+
+void test_search(void)
+{
+    printf("Running Search Tests...\n");
+
+    Database *original_db = test_database_begin("search_test.csv");
+    if (!original_db)
+        return;
+
+    printf("Testing trigram search index...\n");
+
+    // Indexed search must return exactly what a scan of every row finds
+    const char *search_terms[] = {"api", "API", "test", "gate", "Pass", "pending", "123", "1234", "012",
+                                  "999999", "zzz", "ab", "12", "nit", "data lake", "-API"};
+    int search_term_count = sizeof(search_terms) / sizeof(search_terms[0]);
+    database_reset();
+    for (int i = 0; i < 3000; i++)
+    {
+        TestRecord searchable = make_record(i % 5 ? i + 1 : (i + 1) * 37 + 1000, test_systems[i % 5],
+                                            test_types[i % 4], (TestResult)(i % 4), i % 7 != 0);
+        int stored = database_append_record(&searchable);
+        assert(stored == 1);
+    }
+    RowSet found_rows;
+    int allocated = rowset_init(&found_rows, db.count + 1);
+    assert(allocated == 1);
+    for (int round = 0; round < 3; round++)
+    {
+        if (round == 1)
+        {
+            // Purges, ID changes and appends after the index was built
+            database_remove_record(5);
+            database_remove_record(1200);
+            TestRecord renamed = database_get_record(10);
+            renamed.test_id = 91234;
+            database_set_record(10, &renamed);
+            TestRecord later = make_record(51234, "Late Entry", "SmokeTest", PASSED, 1);
+            int stored = database_append_record(&later);
+            assert(stored == 1);
+        }
+        if (round == 2)
+        {
+            TestRecord fresh = make_record(77777, "Fresh Search Target", "NewKindTest", FAILED, 1);
+            int stored = database_append_record(&fresh);
+            assert(stored == 1);
+        }
+
+        for (int t = 0; t < search_term_count; t++)
+        {
+            const char *term = search_terms[t];
+            int found_count = search_matching_rows(term, &found_rows);
+            int expected_count = 0;
+            for (int i = 0; i < db.count; i++)
+            {
+                TestRecord row = database_get_record(i);
+                char id_str[20];
+                snprintf(id_str, sizeof(id_str), "%d", row.test_id);
+                if (!row.active)
+                    continue;
+                if (strcasestr(record_system_name(&row), term) || strcasestr(record_test_type(&row), term) ||
+                    strcasestr(test_result_to_string(row.test_result), term) || strstr(id_str, term))
+                {
+                    assert(expected_count < found_count);
+                    assert(found_rows.rows[expected_count] == (uint32_t)i);
+                    expected_count++;
+                }
+            }
+            assert(found_count == expected_count);
+        }
+    }
+    int match_count = search_matching_rows("Fresh", &found_rows);
+    assert(match_count == 1 && db.test_ids[found_rows.rows[0]] == 77777);
+    rowset_free(&found_rows);
+    char formatted[16];
+    assert(format_test_id(1024, formatted) == 4 && strcmp(formatted, "1024") == 0);
+    assert(format_test_id(INT_MAX, formatted) == 10 && strcmp(formatted, "2147483647") == 0);
+    assert(format_test_id(INT_MIN, formatted) == 11 && strcmp(formatted, "-2147483648") == 0);
+    database_reset();
+
+    printf("✓ trigram search index tests passed\n");
+
+    printf("Testing substring search kernels...\n");
+
+    SubstringSearchFn search_kernels[] = {
+        substring_search_scalar,
+#ifdef HAVE_X86_SIMD
+        __builtin_cpu_supports("sse2") ? substring_search_sse2 : substring_search_scalar,
+        __builtin_cpu_supports("avx2") ? substring_search_avx2 : substring_search_scalar,
+#endif
+    };
+    // Letters of both cases next to the bytes OR 0x20 would confuse with them
+    const char alphabet[] = "aAbBzZ@`[{09 -_";
+    uint32_t kernel_seed = 99;
+    char haystack[160];
+    char needle[8];
+    for (int round = 0; round < 4000; round++)
+    {
+        kernel_seed = kernel_seed * 1103515245u + 12345u;
+        size_t haystack_len = (kernel_seed >> 8) % (sizeof(haystack) - 1);
+        size_t needle_len = 1 + (kernel_seed >> 20) % (sizeof(needle) - 1);
+        for (size_t i = 0; i < haystack_len; i++)
+        {
+            kernel_seed = kernel_seed * 1103515245u + 12345u;
+            haystack[i] = alphabet[(kernel_seed >> 12) % (sizeof(alphabet) - 1)];
+        }
+        haystack[haystack_len] = '\0';
+        for (size_t i = 0; i < needle_len; i++)
+        {
+            kernel_seed = kernel_seed * 1103515245u + 12345u;
+            needle[i] = alphabet[(kernel_seed >> 12) % 6]; // Letters only, so strcasestr agrees
+        }
+        needle[needle_len] = '\0';
+        if (round % 3 == 0 && haystack_len >= needle_len)
+            memcpy(haystack + (kernel_seed >> 4) % (haystack_len - needle_len + 1), needle, needle_len);
+
+        const char *expected = strcasestr(haystack, needle);
+        for (size_t k = 0; k < sizeof(search_kernels) / sizeof(search_kernels[0]); k++)
+        {
+            assert(search_kernels[k](haystack, haystack_len, needle, needle_len) == expected);
+        }
+    }
+    assert(contains_ci("Authentication Service", "SERVICE") == 1);
+    assert(contains_ci("Authentication Service", "servic3") == 0);
+    assert(contains_ci("[Backend]", "{backend}") == 0); // Brackets are not letters
+    assert(find_substring_ci("abc", 3, "", 0) != NULL);
+
+    printf("✓ substring search kernel tests passed\n");
+
+    printf("Testing filter queries...\n");
+
+    // Compiled filters must select exactly the rows a direct check of each record does
+    database_reset();
+    for (int i = 0; i < 2000; i++)
+    {
+        TestRecord filtered = make_record(i + 1, test_systems[i % 5], test_types[i % 4], (TestResult)(i % 4),
+                                          i % 7 != 0);
+        int stored = database_append_record(&filtered);
+        assert(stored == 1);
+    }
+    const char *filters[] = {
+        "system~\"API\" and result in (Failed,Pending) and id between 100 and 1500 and active",
+        "type = unittest or type=\"LoadTest\"",
+        "not (result = Passed) and deleted",
+        "system != \"ab\" and (id < 10 or id >= 1990)",
+        "SYSTEM in (\"Data Lake\", ab) AND NOT active",
+        "result != success and id > 1995",
+        "id = 42 or id != 42 and id <= 3",
+        "system ~ in (gateway, \"data\") and type ~ in (unit, LOAD)",
+    };
+    RowSet filtered_rows;
+    allocated = rowset_init(&filtered_rows, db.count);
+    assert(allocated == 1);
+    for (int f = 0; f < (int)(sizeof(filters) / sizeof(filters[0])); f++)
+    {
+        char error[MAX_LINE];
+        QueryNode *query = query_compile(filters[f], error, sizeof(error));
+        assert(query != NULL);
+        int matched = query_select(query, &filtered_rows);
+        query_free(query);
+
+        int expected_count = 0;
+        for (int i = 0; i < db.count; i++)
+        {
+            TestRecord row = database_get_record(i);
+            const char *system_name = record_system_name(&row);
+            const char *test_type = record_test_type(&row);
+            int id = row.test_id;
+            int r = row.test_result;
+            int expected = 0;
+            switch (f)
+            {
+            case 0:
+                expected = strcasestr(system_name, "API") && (r == FAILED || r == PENDING) && id >= 100 &&
+                           id <= 1500 && row.active;
+                break;
+            case 1:
+                expected = strcasecmp(test_type, "UnitTest") == 0 || strcmp(test_type, "LoadTest") == 0;
+                break;
+            case 2:
+                expected = r != PASSED && !row.active;
+                break;
+            case 3:
+                expected = strcmp(system_name, "ab") != 0 && (id < 10 || id >= 1990);
+                break;
+            case 4:
+                expected = (strcmp(system_name, "Data Lake") == 0 || strcmp(system_name, "ab") == 0) && !row.active;
+                break;
+            case 5:
+                expected = r != SUCCESS && id > 1995;
+                break;
+            case 6:
+                expected = id == 42 || (id != 42 && id <= 3); // and binds tighter than or
+                break;
+            case 7:
+                expected = (strcasestr(system_name, "gateway") || strcasestr(system_name, "data")) &&
+                           (strcasestr(test_type, "unit") || strcasestr(test_type, "load"));
+                break;
+            }
+            if (expected)
+            {
+                assert(expected_count < matched && (int)filtered_rows.rows[expected_count] == i);
+                expected_count++;
+            }
+        }
+        assert(matched == expected_count && matched > 0);
+    }
+    rowset_free(&filtered_rows);
+
+    const char *bad_filters[] = {"", "foo = 1", "system", "system ~", "result = Nope", "id between 1 and",
+                                 "id = x", "(active", "active )", "system = \"open", "type in (a, b", "id # 3",
+                                 "id > 99999999999"};
+    for (int f = 0; f < (int)(sizeof(bad_filters) / sizeof(bad_filters[0])); f++)
+    {
+        char error[MAX_LINE];
+        assert(query_compile(bad_filters[f], error, sizeof(error)) == NULL);
+        assert(error[0] != '\0');
+    }
+    database_reset();
+
+    printf("✓ filter query tests passed\n");
+
+    // Restore original database state
+    test_database_end(original_db);
+
+    printf("\nAll Search Tests PASSED!\n");
+    printf("Total test categories: 3\n");
+    printf("- trigram search index: ✓\n");
+    printf("- substring search kernels: ✓\n");
+    printf("- filter queries: ✓\n");
+}
+
+void test_persistence(void)
+{
+    printf("Running Persistence Tests...\n");
+
+    Database *original_db = test_database_begin("persistence_test.csv");
+    if (!original_db)
+        return;
+
+    printf("Testing load_database (mapped and buffered)...\n");
+
+    const char *loader_file = "loader_test.csv";
+    FILE *fixture = fopen(loader_file, "w");
+    assert(fixture != NULL);
+    fprintf(fixture, "%s\n", REQUIRED_HEADER);
+    fprintf(fixture, "1,Alpha System,UnitTest,Passed,1\r\n");
+    fprintf(fixture, "abc,Bad,Row,Passed,1\n");
+    fprintf(fixture, "3,Beta,LoadTest,success,0\n");
+    fprintf(fixture, "\n");
+    fprintf(fixture, "9,Gamma,ApiTest,Failed,1"); // No trailing newline
+    fclose(fixture);
+
+    int saved_loader = use_mapped_loader;
+    for (int mapped = 0; mapped <= 1; mapped++)
+    {
+        use_mapped_loader = mapped;
+        int loaded = load_database(loader_file);
+        assert(loaded == 1);
+        assert(db.count == 3);
+        assert(db.next_id == 10);
+        TestRecord alpha = database_get_record(0);
+        TestRecord gamma = database_get_record(2);
+        assert(alpha.test_id == 1);
+        assert(strcmp(record_system_name(&alpha), "Alpha System") == 0);
+        assert(strcmp(record_test_type(&alpha), "UnitTest") == 0);
+        assert(alpha.active == 1);
+        assert(db.results[1] == SUCCESS);
+        assert(database_is_active(1) == 0);
+        assert(strcmp(record_system_name(&gamma), "Gamma") == 0);
+        assert(gamma.test_result == FAILED);
+    }
+    use_mapped_loader = saved_loader;
+
+    // Large enough to be split across loader threads
+    int parallel_rows = 40000;
+    fixture = fopen(loader_file, "w");
+    assert(fixture != NULL);
+    fprintf(fixture, "%s\n", REQUIRED_HEADER);
+    for (int i = 1; i <= parallel_rows; i++)
+    {
+        fprintf(fixture, "%d,ParallelSystem%d,ParallelType%d,%s,%d%s", i * 2, i % 13, i % 7,
+                test_result_to_string((TestResult)(i % 4)), i % 3 != 0, i < parallel_rows ? "\n" : "");
+    }
+    fclose(fixture);
+
+    int saved_threads = load_threads;
+    load_threads = 4;
+    int loaded = load_database(loader_file);
+    assert(loaded == 1);
+    assert(db.count == parallel_rows);
+    assert(db.next_id == parallel_rows * 2 + 1);
+    assert(db.systems.count == 13); // Chunk dictionaries merged without duplicates
+    assert(db.types.count == 7);
+    for (int i = 0; i < db.count; i++)
+    {
+        char expected_name[32];
+        snprintf(expected_name, sizeof(expected_name), "ParallelSystem%d", (i + 1) % 13);
+        TestRecord loaded_row = database_get_record(i);
+        assert(loaded_row.test_id == (i + 1) * 2);
+        assert(strcmp(record_system_name(&loaded_row), expected_name) == 0);
+        assert(loaded_row.test_result == (TestResult)((i + 1) % 4));
+        assert(loaded_row.active == ((i + 1) % 3 != 0));
+    }
+    load_threads = saved_threads;
+    remove(loader_file);
+
+    printf("✓ load_database tests passed\n");
+
+    printf("Testing write-ahead journal...\n");
+
+    const char *journal_file = "journal_test.csv";
+    char journal_name[MAX_PATH + sizeof(JOURNAL_SUFFIX)];
+    journal_path(journal_name, sizeof(journal_name), journal_file);
+    remove(journal_name);
+    fixture = fopen(journal_file, "w");
+    assert(fixture != NULL);
+    fprintf(fixture, "%s\n", REQUIRED_HEADER);
+    fprintf(fixture, "1,Journal System,UnitTest,Passed,1\n");
+    fprintf(fixture, "2,Journal System,LoadTest,Failed,1\n");
+    fprintf(fixture, "3,Other System,UnitTest,Pending,0\n");
+    fclose(fixture);
+    long long base_size, base_mtime;
+    int stamped = journal_csv_stamp(journal_file, &base_size, &base_mtime);
+    assert(stamped == 1);
+
+    loaded = load_database(journal_file);
+    assert(loaded == 1);
+    TestRecord journaled = make_record(get_next_test_id(), "Journal System", "ApiTest", SUCCESS, 1);
+    int inserted = database_insert_record(&journaled);
+    assert(inserted == 1);
+    TestRecord changed = database_get_record(0);
+    changed.type_code = dictionary_intern(&db.types, "RenamedTest", strlen("RenamedTest"));
+    changed.test_result = FAILED;
+    int updated = database_update_record(0, &changed);
+    assert(updated == 1);
+    int marked = database_set_active(1, 0);
+    assert(marked == 1);
+    marked = database_set_active(2, 1);
+    assert(marked == 1);
+    marked = database_set_active(1, 1);
+    assert(marked == 1);
+    marked = database_set_active(1, 0);
+    assert(marked == 1);
+    int purged = database_purge_record(1);
+    assert(purged == 1);
+    assert(db.count == 3 && db.journal_bytes > 0);
+
+    // Changes in a batch share one fsync at the end of the batch
+    DurabilityMode saved_durability = durability_mode;
+    assert(parse_durability_mode("none") == DURABILITY_NONE);
+    assert(parse_durability_mode("batch") == DURABILITY_BATCH);
+    assert(parse_durability_mode("commit") == DURABILITY_COMMIT);
+    durability_mode = DURABILITY_COMMIT;
+    database_begin_batch();
+    marked = database_set_active(1, 0);
+    assert(marked == 1);
+    marked = database_set_active(1, 1);
+    assert(marked == 1);
+    assert(db.journal_unsynced == 2);
+    int synced = database_end_batch();
+    assert(synced == 1);
+    assert(db.journal_unsynced == 0 && db.batch_depth == 0);
+    durability_mode = DURABILITY_BATCH;
+    marked = database_set_active(1, 0);
+    assert(marked == 1);
+    marked = database_set_active(1, 1);
+    assert(marked == 1);
+    assert(db.journal_unsynced == 2); // Below JOURNAL_BATCH_ENTRIES
+    durability_mode = saved_durability;
+
+    // The CSV is untouched until a checkpoint; the journal carries the changes
+    long long csv_size, csv_mtime;
+    stamped = journal_csv_stamp(journal_file, &csv_size, &csv_mtime);
+    assert(stamped == 1);
+    assert(csv_size == base_size);
+
+    for (int pass = 0; pass < 3; pass++)
+    {
+        if (pass == 1)
+        {
+            // A torn final entry is dropped, everything before it still applies
+            FILE *journal = fopen(journal_name, "ab");
+            assert(journal != NULL);
+            fprintf(journal, "I,3,9,Torn");
+            fclose(journal);
+        }
+        if (pass == 2)
+        {
+            int checkpointed = database_checkpoint();
+            assert(checkpointed == 1);
+            assert(fopen(journal_name, "r") == NULL);
+            char temp_name[MAX_PATH + sizeof(TEMP_SUFFIX)];
+            snprintf(temp_name, sizeof(temp_name), "%s%s", journal_file, TEMP_SUFFIX);
+            assert(fopen(temp_name, "r") == NULL); // Renamed over the CSV
+        }
+
+        database_reset();
+        loaded = load_database(journal_file);
+        assert(loaded == 1);
+        assert(db.count == 3);
+        assert(db.next_id == 5);
+        TestRecord first = database_get_record(0);
+        assert(first.test_id == 1 && first.test_result == FAILED);
+        assert(strcmp(record_test_type(&first), "RenamedTest") == 0);
+        assert(db.test_ids[1] == 3 && database_is_active(1) == 1);
+        TestRecord added = database_get_record(2);
+        assert(added.test_id == 4 && added.test_result == SUCCESS && added.active == 1);
+        assert(strcmp(record_test_type(&added), "ApiTest") == 0);
+    }
+
+    // A journal written against a different CSV is discarded, not replayed
+    marked = database_set_active(0, 0);
+    assert(marked == 1);
+    database_reset();
+    fixture = fopen(journal_file, "a");
+    assert(fixture != NULL);
+    fprintf(fixture, "5,Edited Elsewhere,UnitTest,Passed,1\n");
+    fclose(fixture);
+    loaded = load_database(journal_file);
+    assert(loaded == 1);
+    assert(db.count == 4 && database_is_active(0) == 1);
+    assert(fopen(journal_name, "r") == NULL);
+    database_reset();
+
+    // Rows with empty names replay, and so does every entry after them
+    fixture = fopen(journal_file, "w");
+    assert(fixture != NULL);
+    fprintf(fixture, "%s\n", REQUIRED_HEADER);
+    fprintf(fixture, "1,ValidSystem,ValidType,Passed\n");
+    fprintf(fixture, "3,ValidSystem\n");
+    fprintf(fixture, "4,\n");
+    fclose(fixture);
+    int journal_loaded = load_database(journal_file);
+    assert(journal_loaded == 1 && db.count == 3);
+    int empty_row = find_record_by_id(3);
+    int journal_changed = database_set_active(empty_row, 1);
+    assert(journal_changed == 1);
+    TestRecord emptied = database_get_record(empty_row);
+    emptied.test_result = FAILED;
+    journal_changed = database_update_record(empty_row, &emptied);
+    assert(journal_changed == 1);
+    TestRecord after_empty = make_record(get_next_test_id(), "", "", PASSED, 1);
+    journal_changed = database_insert_record(&after_empty);
+    assert(journal_changed == 1);
+    database_reset();
+    journal_loaded = load_database(journal_file);
+    assert(journal_loaded == 1 && db.count == 4);
+    emptied = database_get_record(find_record_by_id(3));
+    assert(emptied.active == 1 && emptied.test_result == FAILED);
+    assert(strcmp(record_system_name(&emptied), "ValidSystem") == 0 && record_test_type(&emptied)[0] == '\0');
+    after_empty = database_get_record(3);
+    assert(after_empty.test_id == 5 && after_empty.active == 1 && record_system_name(&after_empty)[0] == '\0');
+    char *empty_fields[RECORD_FIELDS + 2];
+    char empty_line[] = "U,0,3,,,Failed,1";
+    assert(split_journal_fields(empty_line, empty_fields, RECORD_FIELDS + 2) == RECORD_FIELDS + 2);
+    assert(empty_fields[3][0] == '\0' && empty_fields[4][0] == '\0' && strcmp(empty_fields[5], "Failed") == 0);
+    char extra_line[] = "U,0,3,a,b,Failed,1,x";
+    assert(split_journal_fields(extra_line, empty_fields, RECORD_FIELDS + 2) == RECORD_FIELDS + 3);
+    database_reset();
+
+    // Entries longer than MAX_LINE replay whole, and so does every entry after them
+    char long_journal_name[3 * MAX_LINE];
+    memset(long_journal_name, 'J', sizeof(long_journal_name) - 1);
+    long_journal_name[sizeof(long_journal_name) - 1] = '\0';
+    fixture = fopen(journal_file, "w");
+    assert(fixture != NULL);
+    fprintf(fixture, "%s\n1,%s,UnitTest,Passed,1\n2,Short System,UnitTest,Passed,1\n", REQUIRED_HEADER,
+            long_journal_name);
+    fclose(fixture);
+    journal_loaded = load_database(journal_file);
+    assert(journal_loaded == 1 && db.count == 2);
+    TestRecord long_row = database_get_record(0);
+    long_row.test_result = FAILED;
+    journal_changed = database_update_record(0, &long_row);
+    assert(journal_changed == 1);
+    TestRecord after_long = make_record(get_next_test_id(), "After Long", "UnitTest", PENDING, 1);
+    journal_changed = database_insert_record(&after_long);
+    assert(journal_changed == 1);
+    journal_changed = database_set_active(1, 0);
+    assert(journal_changed == 1);
+    database_reset();
+    journal_loaded = load_database(journal_file);
+    assert(journal_loaded == 1 && db.count == 3 && database_is_active(1) == 0);
+    long_row = database_get_record(0);
+    assert(long_row.test_result == FAILED && strcmp(record_system_name(&long_row), long_journal_name) == 0);
+    after_long = database_get_record(2);
+    assert(after_long.test_id == 3 && strcmp(record_system_name(&after_long), "After Long") == 0);
+    database_reset();
+    remove(journal_name);
+    remove(journal_file);
+
+    printf("✓ write-ahead journal tests passed\n");
+
+    printf("Testing buffered serializer...\n");
+
+    const int format_cases[] = {0, 1, 9, 10, 99, 100, 12345, 999999999, 1000000000, INT_MAX, -1, -100, INT_MIN};
+    for (int i = 0; i < (int)(sizeof(format_cases) / sizeof(format_cases[0])); i++)
+    {
+        char formatted[12];
+        char expected_text[16];
+        int expected_len = snprintf(expected_text, sizeof(expected_text), "%d", format_cases[i]);
+        assert(format_test_id(format_cases[i], formatted) == expected_len);
+        assert(strcmp(formatted, expected_text) == 0);
+    }
+
+    // Enough rows to flush the output buffer several times, byte for byte the old fprintf output.
+    // Two rows are longer than the whole buffer, one of them right after a flush
+    database_reset();
+    char *oversized_name = malloc(SAVE_BUFFER_SIZE + 100);
+    assert(oversized_name != NULL);
+    memset(oversized_name, 'S', SAVE_BUFFER_SIZE + 99);
+    oversized_name[SAVE_BUFFER_SIZE + 99] = '\0';
+    for (int i = 0; i < 60000; i++)
+    {
+        char system_name[64];
+        snprintf(system_name, sizeof(system_name), "Serializer System %d%s", i % 97,
+                 i % 13 == 0 ? " (long name for the buffer edge)" : "");
+        TestRecord serialized = make_record(i % 1000 == 0 ? INT_MAX - i : i + 1,
+                                            i == 0 || i == 30000 ? oversized_name : system_name,
+                                            test_types[i % 4], (TestResult)(i % 4), i % 3 != 0);
+        int appended = database_append_record(&serialized);
+        assert(appended == 1);
+    }
+    saved_durability = durability_mode;
+    durability_mode = DURABILITY_NONE;
+    int written = write_database_csv(test_serialized_file);
+    assert(written == 1);
+    durability_mode = saved_durability;
+    written = write_database_csv_stdio(test_stdio_file);
+    assert(written == 1);
+    size_t serialized_size = 0;
+    size_t stdio_size = 0;
+    char *serialized_bytes = read_file_contents(test_serialized_file, &serialized_size);
+    char *stdio_bytes = read_file_contents(test_stdio_file, &stdio_size);
+    assert(serialized_bytes != NULL && stdio_bytes != NULL);
+    assert(serialized_size > 4 * SAVE_BUFFER_SIZE);
+    assert(serialized_size == stdio_size && memcmp(serialized_bytes, stdio_bytes, stdio_size) == 0);
+    free(serialized_bytes);
+    free(stdio_bytes);
+    remove(test_serialized_file);
+    remove(test_stdio_file);
+    database_reset();
+
+    printf("✓ buffered serializer tests passed\n");
+
+    printf("Testing parallel save...\n");
+
+    // Ranges rendered on several threads must join into exactly the sequential file
+    database_reset();
+    for (int i = 0; i < PARALLEL_SAVE_MIN_ROWS * 2; i++)
+    {
+        // One oversized row in the middle of a range
+        TestRecord saved_row = make_record(i % 777 == 0 ? INT_MAX - i : i + 1,
+                                           i == PARALLEL_SAVE_MIN_ROWS / 3 ? oversized_name : test_systems[i % 5],
+                                           i % 11 ? test_types[i % 4] : "AVeryLongTestTypeNameForOffsets",
+                                           (TestResult)(i % 4), i % 5 != 0);
+        int stored = database_append_record(&saved_row);
+        assert(stored == 1);
+    }
+    int saved_save_threads = save_threads;
+    saved_durability = durability_mode;
+    durability_mode = DURABILITY_NONE;
+    save_threads = 1;
+    assert(get_save_thread_count(db.count) == 1);
+    written = write_database_csv(test_stdio_file);
+    assert(written == 1);
+    stdio_bytes = read_file_contents(test_stdio_file, &stdio_size);
+    assert(stdio_bytes != NULL);
+    assert(get_save_thread_count(PARALLEL_SAVE_MIN_ROWS - 1) == 1);
+    for (int threads = 2; threads <= 4; threads++)
+    {
+        save_threads = threads;
+        assert(get_save_thread_count(db.count) == threads);
+        written = write_database_csv(test_serialized_file);
+        assert(written == 1);
+        serialized_bytes = read_file_contents(test_serialized_file, &serialized_size);
+        assert(serialized_bytes != NULL);
+        assert(serialized_size == stdio_size && memcmp(serialized_bytes, stdio_bytes, stdio_size) == 0);
+        free(serialized_bytes);
+    }
+    save_threads = saved_save_threads;
+    durability_mode = saved_durability;
+    free(stdio_bytes);
+    remove(test_serialized_file);
+    remove(test_stdio_file);
+    database_reset();
+    free(oversized_name);
+
+    printf("✓ parallel save tests passed\n");
+
+    // Restore original database state
+    test_database_end(original_db);
+
+    printf("\nAll Persistence Tests PASSED!\n");
+    printf("Total test categories: 4\n");
+    printf("- load_database: ✓\n");
+    printf("- write-ahead journal: ✓\n");
+    printf("- buffered serializer: ✓\n");
+    printf("- parallel save: ✓\n");
+}
+
+void test_binary_formats(void)
+{
+    printf("Running Binary Format Tests...\n");
+
+    Database *original_db = test_database_begin("binary_test.csv");
+    if (!original_db)
+        return;
+
+    printf("Testing binary snapshot...\n");
+
+    // A snapshot opens to the same rows, strings and next TestID as the database it was written from
+    const char *snapshot_file = "snapshot_test" SNAPSHOT_SUFFIX;
+    char snapshot_journal[MAX_PATH + sizeof(JOURNAL_SUFFIX)];
+    journal_path(snapshot_journal, sizeof(snapshot_journal), snapshot_file);
+    remove(snapshot_journal);
+    size_t serialized_size = 0;
+    size_t stdio_size = 0;
+    database_reset();
+    for (int i = 0; i < 1000; i++)
+    {
+        TestRecord snapshot_row = make_record(i * 3 + 1, test_systems[i % 5], test_types[i % 4],
+                                              (TestResult)(i % 4), i % 7 != 0);
+        int stored = database_append_record(&snapshot_row);
+        assert(stored == 1);
+    }
+    db.next_id = 5000;
+    DurabilityMode saved_durability = durability_mode;
+    durability_mode = DURABILITY_NONE;
+    assert(is_snapshot_file(snapshot_file) == 1 && is_snapshot_file("snapshot.csv") == 0);
+    int written = write_database_snapshot(snapshot_file);
+    assert(written == 1);
+    written = write_database_csv(test_stdio_file);
+    assert(written == 1);
+    char *stdio_bytes = read_file_contents(test_stdio_file, &stdio_size);
+    assert(stdio_bytes != NULL);
+    database_reset();
+    int loaded = load_database(snapshot_file);
+    assert(loaded == 1);
+    assert(db.columns_mapped == 1 && db.count == 1000 && db.next_id == 5000);
+    assert(db.systems.count == 5 && db.types.count == 4);
+    assert(find_record_by_id(31) == 10 && database_is_active(7) == 0 && database_is_active(8) == 1);
+    assert(strcmp(db.systems.strings[db.system_codes[3]], test_systems[3]) == 0);
+    assert(database_count_active() == 1000 - 143);
+    written = write_database_csv(test_serialized_file);
+    assert(written == 1);
+    char *serialized_bytes = read_file_contents(test_serialized_file, &serialized_size);
+    assert(serialized_bytes != NULL);
+    assert(serialized_size == stdio_size && memcmp(serialized_bytes, stdio_bytes, stdio_size) == 0);
+    free(serialized_bytes);
+
+    // Edits go through the journal; an insert copies the columns out of the file first
+    int marked = database_set_active(0, 0);
+    assert(marked == 1);
+    TestRecord snapshot_added = make_record(get_next_test_id(), "Snapshot System", "UnitTest", FAILED, 1);
+    int inserted = database_insert_record(&snapshot_added);
+    assert(inserted == 1);
+    assert(db.columns_mapped == 0 && db.capacity > db.count && db.count == 1001);
+    database_reset();
+    loaded = load_database(snapshot_file);
+    assert(loaded == 1);
+    assert(db.count == 1001 && database_is_active(0) == 0 && db.test_ids[1000] == 5000);
+    assert(db.next_id == 5001 && db.systems.count == 6);
+    int checkpointed = database_checkpoint();
+    assert(checkpointed == 1);
+    assert(fopen(snapshot_journal, "r") == NULL);
+    database_reset();
+    loaded = load_database(snapshot_file);
+    assert(loaded == 1);
+    assert(db.columns_mapped == 1 && db.count == 1001 && db.next_id == 5001);
+    int snapshot_failed = 0;
+    for (int row = database_next_row(0, 1); row >= 0; row = database_next_row(row + 1, 1))
+        snapshot_failed += db.results[row] == FAILED;
+    assert(db.stats.valid == 0); // Counted on first use, not while opening
+    int stats_ready = stats_ensure();
+    assert(stats_ready && db.stats.by_result[FAILED] == snapshot_failed && snapshot_failed > 0);
+
+    // Damage anywhere in the file is caught before any of it is used
+    size_t snapshot_size = 0;
+    char *snapshot_bytes = read_file_contents(snapshot_file, &snapshot_size);
+    assert(snapshot_bytes != NULL && snapshot_size % SNAPSHOT_ALIGN == 0);
+    const SnapshotHeader *snapshot_header = (const SnapshotHeader *)snapshot_bytes;
+    const size_t damage_offsets[] = {0, 9, sizeof(SnapshotHeader) - 1, sizeof(SnapshotHeader) + 100, snapshot_size / 2,
+                                     snapshot_header->offsets[SNAPSHOT_STRINGS] + snapshot_header->sizes[SNAPSHOT_STRINGS] - 1};
+    database_reset();
+    for (int d = 0; d <= (int)(sizeof(damage_offsets) / sizeof(damage_offsets[0])); d++)
+    {
+        FILE *damaged = fopen(snapshot_file, "wb");
+        assert(damaged != NULL);
+        int truncated = d == (int)(sizeof(damage_offsets) / sizeof(damage_offsets[0]));
+        size_t damaged_size = truncated ? snapshot_size - SNAPSHOT_ALIGN : snapshot_size;
+        if (!truncated)
+            snapshot_bytes[damage_offsets[d]] ^= 0x20;
+        fwrite(snapshot_bytes, 1, damaged_size, damaged);
+        fclose(damaged);
+        if (!truncated)
+            snapshot_bytes[damage_offsets[d]] ^= 0x20;
+        loaded = load_database(snapshot_file);
+        assert(loaded == 0);
+        assert(db.count == 0 && db.snapshot == NULL);
+    }
+    free(snapshot_bytes);
+    durability_mode = saved_durability;
+    free(stdio_bytes);
+    remove(snapshot_file);
+    remove(test_serialized_file);
+    remove(test_stdio_file);
+    database_reset();
+
+    printf("✓ binary snapshot tests passed\n");
+
+    printf("Testing compressed archive...\n");
+
+    assert(archive_code_bits(0) == 0 && archive_code_bits(1) == 0 && archive_code_bits(2) == 1);
+    assert(archive_code_bits(5) == 3 && archive_code_bits(256) == 8 && archive_code_bits(257) == 9);
+
+    // Decoding gives back the same rows: empty, sequential IDs with one type and long
+    // active runs, then ID gaps and reversals with scattered deletes (stored as a bitmap)
+    // and a name longer than any line the CSV tools read
+    char long_archive_name[3 * MAX_LINE];
+    memset(long_archive_name, 'L', sizeof(long_archive_name) - 1);
+    long_archive_name[sizeof(long_archive_name) - 1] = '\0';
+    const char *archive_file = "archive_test" ARCHIVE_SUFFIX;
+    char archive_journal[MAX_PATH + sizeof(JOURNAL_SUFFIX)];
+    journal_path(archive_journal, sizeof(archive_journal), archive_file);
+    remove(archive_journal);
+    saved_durability = durability_mode;
+    durability_mode = DURABILITY_NONE;
+    for (int layout = 0; layout < 3; layout++)
+    {
+        database_reset();
+        int archive_rows = layout == 0 ? 0 : 20000;
+        for (int i = 0; i < archive_rows; i++)
+        {
+            int test_id = layout == 1 ? i + 1 : (i < 500 ? 100000 - i : (i == 9000 ? INT_MAX : i * 2 + (i % 97 == 0)));
+            const char *archived_system = layout == 1 ? test_systems[i / 4000]
+                                          : i == 9000 ? long_archive_name : test_systems[i % 5];
+            TestRecord archived = make_record(test_id, archived_system,
+                                              layout == 1 ? "UnitTest" : test_types[i % 4],
+                                              (TestResult)(i * 7 % 4),
+                                              layout == 1 ? i % 1000 >= 3 : (int)(i * 2654435761u >> 20) & 1);
+            int stored = database_append_record(&archived);
+            assert(stored == 1);
+        }
+        db.next_id = archive_rows + 12345;
+        written = write_database_csv(test_stdio_file);
+        assert(written == 1);
+        written = write_database_archive(archive_file);
+        assert(written == 1);
+        database_reset();
+        assert(is_archive_file(archive_file) == 1 && is_binary_database_file(archive_file) == 1);
+        loaded = load_database(archive_file);
+        assert(loaded == 1);
+        assert(db.count == archive_rows && db.next_id == archive_rows + 12345);
+        written = write_database_csv(test_serialized_file);
+        assert(written == 1);
+        stdio_bytes = read_file_contents(test_stdio_file, &stdio_size);
+        serialized_bytes = read_file_contents(test_serialized_file, &serialized_size);
+        assert(stdio_bytes != NULL && serialized_bytes != NULL);
+        assert(serialized_size == stdio_size && memcmp(serialized_bytes, stdio_bytes, stdio_size) == 0);
+        free(serialized_bytes);
+        free(stdio_bytes);
+
+        // Sequential IDs, runs of systems and one type: about a byte per row
+        size_t archive_size = 0;
+        char *archive_bytes = read_file_contents(archive_file, &archive_size);
+        assert(archive_bytes != NULL);
+        if (layout == 1)
+            assert(archive_size * 20 < stdio_size);
+        free(archive_bytes);
+    }
+
+    // The journal and checkpoints work on an archive like on a CSV
+    TestRecord archive_added = make_record(get_next_test_id(), "Archive System", "LoadTest", PENDING, 1);
+    inserted = database_insert_record(&archive_added);
+    assert(inserted == 1);
+    marked = database_set_active(0, 0);
+    assert(marked == 1);
+    database_reset();
+    loaded = load_database(archive_file);
+    assert(loaded == 1);
+    assert(db.count == 20001 && database_is_active(0) == 0 && db.test_ids[20000] == 32345);
+    checkpointed = database_checkpoint();
+    assert(checkpointed == 1);
+    assert(fopen(archive_journal, "r") == NULL);
+    database_reset();
+    loaded = load_database(archive_file);
+    assert(loaded == 1);
+    assert(db.count == 20001 && db.next_id == 32346 && database_is_active(0) == 0);
+
+    // Corrupt or cut short archives are rejected
+    size_t archive_size = 0;
+    char *archive_bytes = read_file_contents(archive_file, &archive_size);
+    assert(archive_bytes != NULL);
+    database_reset();
+    for (int d = 0; d < 4; d++)
+    {
+        FILE *damaged = fopen(archive_file, "wb");
+        assert(damaged != NULL);
+        size_t damage_at = d == 0 ? 0 : (d == 1 ? archive_size / 2 : archive_size - 1);
+        archive_bytes[damage_at] ^= d < 3 ? 0x01 : 0;
+        fwrite(archive_bytes, 1, d == 3 ? archive_size - 3 : archive_size, damaged);
+        fclose(damaged);
+        archive_bytes[damage_at] ^= d < 3 ? 0x01 : 0;
+        loaded = load_database(archive_file);
+        assert(loaded == 0);
+        assert(db.count == 0);
+    }
+    free(archive_bytes);
+    durability_mode = saved_durability;
+    remove(archive_file);
+    remove(test_serialized_file);
+    remove(test_stdio_file);
+    database_reset();
+
+    printf("✓ compressed archive tests passed\n");
+
+    // Restore original database state
+    test_database_end(original_db);
+
+    printf("\nAll Binary Format Tests PASSED!\n");
+    printf("Total test categories: 2\n");
+    printf("- binary snapshot: ✓\n");
+    printf("- compressed archive: ✓\n");
+}
+
+void test_statistics(void)
+{
+    printf("Running Statistics Tests...\n");
+
+    Database *original_db = test_database_begin("stats_test.csv");
+    if (!original_db)
+        return;
+
+    printf("Testing statistics...\n");
+
+    const char *stats_file = "stats_test.csv";
+    char stats_journal[MAX_PATH + sizeof(JOURNAL_SUFFIX)];
+    journal_path(stats_journal, sizeof(stats_journal), stats_file);
+    remove(stats_journal);
+    FILE *fixture = fopen(stats_file, "w");
+    assert(fixture != NULL);
+    fprintf(fixture, "%s\n", REQUIRED_HEADER);
+    fprintf(fixture, "1,Stats A,UnitTest,Passed,1\n");
+    fprintf(fixture, "2,Stats A,LoadTest,Failed,1\n");
+    fprintf(fixture, "3,Stats B,UnitTest,Failed,0\n");
+    fprintf(fixture, "4,Stats B,UnitTest,Pending,1\n");
+    fclose(fixture);
+
+    DurabilityMode saved_durability = durability_mode;
+    durability_mode = DURABILITY_NONE;
+    int loaded = load_database(stats_file);
+    assert(loaded == 1);
+    assert(db.stats.valid == 1);
+    assert(db.stats.by_result[PASSED] == 1 && db.stats.by_result[FAILED] == 1);
+    assert(db.stats.by_result[PENDING] == 1 && db.stats.by_result[SUCCESS] == 0);
+    uint32_t stats_a = dictionary_intern(&db.systems, "Stats A", strlen("Stats A"));
+    assert(db.stats.system_results[stats_a * (SUCCESS + 1) + FAILED] == 1);
+    assert(stats_system_total(stats_a) == 2);
+
+    // Deltas from every mutation path must match a full recount
+    srand(14);
+    const char *stats_systems[] = {"Stats A", "Stats B", "Stats C", "Stats D"};
+    const char *stats_types[] = {"UnitTest", "LoadTest", "ApiTest"};
+    for (int step = 0; step < 400; step++)
+    {
+        int row = db.count > 0 ? rand() % db.count : 0;
+        int action = db.count > 0 ? rand() % 4 : 0;
+        TestRecord mutated = make_record(get_next_test_id(), stats_systems[rand() % 4], stats_types[rand() % 3],
+                                         (TestResult)(rand() % 4), rand() % 2);
+        int applied;
+        if (action == 0)
+            applied = database_insert_record(&mutated);
+        else if (action == 1)
+        {
+            mutated.test_id = db.test_ids[row];
+            applied = database_update_record(row, &mutated);
+        }
+        else if (action == 2)
+            applied = database_set_active(row, !database_is_active(row));
+        else
+            applied = database_purge_record(row);
+        assert(applied == 1);
+    }
+    assert(db.stats.valid == 1);
+    Statistics incremental = db.stats;
+    int incremental_results[SUCCESS + 1];
+    memcpy(incremental_results, incremental.by_result, sizeof(incremental_results));
+    int *incremental_systems = malloc((size_t)db.systems.count * (SUCCESS + 1) * sizeof(int));
+    int *incremental_types = malloc((size_t)db.types.count * sizeof(int));
+    assert(incremental_systems != NULL && incremental_types != NULL);
+    memcpy(incremental_systems, incremental.system_results, (size_t)db.systems.count * (SUCCESS + 1) * sizeof(int));
+    memcpy(incremental_types, incremental.type_counts, (size_t)db.types.count * sizeof(int));
+    int stats_ready = stats_rebuild();
+    assert(stats_ready == 1);
+    assert(memcmp(incremental_results, db.stats.by_result, sizeof(incremental_results)) == 0);
+    assert(memcmp(incremental_systems, db.stats.system_results,
+                  (size_t)db.systems.count * (SUCCESS + 1) * sizeof(int)) == 0);
+    assert(memcmp(incremental_types, db.stats.type_counts, (size_t)db.types.count * sizeof(int)) == 0);
+    assert(db.stats.by_result[FAILED] + db.stats.by_result[PASSED] + db.stats.by_result[PENDING] +
+               db.stats.by_result[SUCCESS] ==
+           database_count_active());
+    free(incremental_systems);
+    free(incremental_types);
+
+    // An invalidated engine recounts when read
+    db.stats.valid = 0;
+    int marked = database_set_active(0, !database_is_active(0));
+    assert(marked == 1);
+    assert(db.stats.valid == 0);
+    stats_ready = stats_ensure();
+    assert(stats_ready == 1 && db.stats.valid == 1);
+    assert(db.stats.by_result[FAILED] + db.stats.by_result[PASSED] + db.stats.by_result[PENDING] +
+               db.stats.by_result[SUCCESS] ==
+           database_count_active());
+    durability_mode = saved_durability;
+    database_reset();
+    remove(stats_journal);
+    remove(stats_file);
+
+    printf("✓ statistics tests passed\n");
+
+    // Restore original database state
+    test_database_end(original_db);
+
+    printf("\nAll Statistics Tests PASSED!\n");
+    printf("Total test categories: 1\n");
+    printf("- statistics: ✓\n");
+}
+
+void test_batch_mode(void)
+{
+    printf("Running Batch Mode Tests...\n");
+
+    Database *original_db = test_database_begin("batch_test.csv");
+    if (!original_db)
+        return;
+
+    printf("Testing batch commands...\n");
+
+    char batch_line[] = " add , Batch System ,UnitTest,Passed";
+    char *split_fields[BATCH_MAX_FIELDS];
+    int split_count = split_batch_line(batch_line, split_fields, BATCH_MAX_FIELDS);
+    assert(split_count == 4);
+    assert(strcmp(split_fields[0], "add") == 0 && strcmp(split_fields[1], "Batch System") == 0);
+    assert(strcmp(split_fields[3], "Passed") == 0);
+
+    // Loader and journal warnings stay off stdout in batch mode
+    assert(diagnostic_stream() == stdout);
+    batch_mode = 1;
+    assert(diagnostic_stream() == stderr);
+    batch_mode = 0;
+
+    const char *batch_file = "batch_test.csv";
+    char batch_journal[MAX_PATH + sizeof(JOURNAL_SUFFIX)];
+    journal_path(batch_journal, sizeof(batch_journal), batch_file);
+    remove(batch_journal);
+    FILE *fixture = fopen(batch_file, "w");
+    assert(fixture != NULL);
+    fprintf(fixture, "%s\n", REQUIRED_HEADER);
+    fprintf(fixture, "1,Batch System,UnitTest,Pending,1\n");
+    fclose(fixture);
+    int loaded = load_database(batch_file);
+    assert(loaded == 1);
+
+    FILE *script = tmpfile();
+    FILE *batch_output = tmpfile();
+    assert(script != NULL && batch_output != NULL);
+    fprintf(script, "# setup\n");
+    fprintf(script, "add,Batch System,LoadTest,failed\n");
+    fprintf(script, "update,1,Batch System,UnitTest,Success\n");
+    fprintf(script, "\n");
+    fprintf(script, "delete,2\n");
+    fprintf(script, "delete,2\n");
+    fprintf(script, "add,Bad!,UnitTest,Passed\n");
+    fprintf(script, "update,9,Batch System,UnitTest,Passed\n");
+    fprintf(script, "frobnicate\n");
+    fprintf(script, "search,batch\n");
+    fprintf(script, "stats\n");
+    rewind(script);
+    database_begin_batch();
+    int failed_commands = batch_run_script(batch_output, script);
+    assert(failed_commands == 4);
+    int synced = database_end_batch();
+    assert(synced == 1);
+    fclose(script);
+
+    const char *expected_output[] = {
+        "ok,add,2",
+        "ok,update,1",
+        "ok,delete,2",
+        "error,6,TestID 2 is already deleted",
+        "error,7,invalid SystemName 'Bad!'",
+        "error,8,TestID 9 not found",
+        "error,9,unknown command 'frobnicate'",
+        "record,1,Batch System,UnitTest,Success,1",
+        "ok,search,1",
+        "result,Failed,0",
+        "result,Passed,0",
+        "result,Pending,0",
+        "result,Success,1",
+        "system,Batch System,1,0",
+        "type,UnitTest,1",
+        "ok,stats,1,1",
+    };
+    rewind(batch_output);
+    char output_line[MAX_LINE];
+    int output_lines = 0;
+    while (fgets(output_line, sizeof(output_line), batch_output))
+    {
+        output_line[strcspn(output_line, "\n")] = '\0';
+        assert(output_lines < (int)(sizeof(expected_output) / sizeof(expected_output[0])));
+        assert(strcmp(output_line, expected_output[output_lines]) == 0);
+        output_lines++;
+    }
+    assert(output_lines == (int)(sizeof(expected_output) / sizeof(expected_output[0])));
+    fclose(batch_output);
+
+    // All of it lands in the CSV with the one checkpoint
+    int checkpointed = database_checkpoint();
+    assert(checkpointed == 1);
+    database_reset();
+    loaded = load_database(batch_file);
+    assert(loaded == 1);
+    assert(db.count == 2 && db.next_id == 3);
+    TestRecord batch_added = database_get_record(1);
+    assert(batch_added.test_result == FAILED && batch_added.active == 0);
+    assert(strcmp(record_test_type(&batch_added), "LoadTest") == 0);
+    database_reset();
+    remove(batch_file);
+
+    // bench --sizes accepts plain counts and k/M suffixes, nothing else
+    int bench_sizes[BENCH_MAX_SIZES];
+    assert(bench_parse_sizes("10k,250,2M", bench_sizes) == 3);
+    assert(bench_sizes[0] == 10000 && bench_sizes[1] == 250 && bench_sizes[2] == 2000000);
+    assert(bench_parse_sizes(BENCH_DEFAULT_SIZES, bench_sizes) == 4 && bench_sizes[3] == 10000000);
+    assert(bench_parse_sizes("10x", bench_sizes) == 0 && bench_parse_sizes("0", bench_sizes) == 0);
+    assert(bench_parse_sizes("1,2,3,4,5,6,7,8,9", bench_sizes) == 0);
+
+    printf("✓ batch command tests passed\n");
+
+    printf("Testing dataset generator...\n");
+
+    // Same seed, same bytes; the output loads as a valid database of the requested shape
+    const char *generated_file = "generator_test.csv";
+    char *generator_args[] = {"tdm", "generate", (char *)generated_file, "--rows", "20k", "--seed", "42",
+                              "--systems", "50", "--types", "7", "--results", "0,3,0,1", "--deleted", "0.25"};
+    int generator_argc = (int)(sizeof(generator_args) / sizeof(generator_args[0]));
+    GeneratorOptions generator;
+    int parsed = generator_parse_options(generator_argc, generator_args, 3, &generator);
+    assert(parsed == 1);
+    assert(generator.rows == 20000 && generator.systems == 50 && generator.result_weights[PASSED] == 3);
+    assert(generator.duplicates == 0.0 && generator.gaps == 0.01); // Defaults kept
+    int generated = generate_dataset(generated_file, &generator);
+    assert(generated == 1);
+    size_t first_size = 0;
+    size_t second_size = 0;
+    char *first_bytes = read_file_contents(generated_file, &first_size);
+    assert(first_bytes != NULL);
+    generated = generate_dataset(generated_file, &generator);
+    assert(generated == 1);
+    char *second_bytes = read_file_contents(generated_file, &second_size);
+    assert(second_bytes != NULL);
+    assert(first_size == second_size && memcmp(first_bytes, second_bytes, first_size) == 0);
+    free(second_bytes);
+    generator.seed = 43;
+    generated = generate_dataset(generated_file, &generator);
+    assert(generated == 1);
+    second_bytes = read_file_contents(generated_file, &second_size);
+    assert(second_bytes != NULL && (first_size != second_size || memcmp(first_bytes, second_bytes, first_size)));
+    free(second_bytes);
+    free(first_bytes);
+
+    assert(validate_csv_header(generated_file) == 1);
+    loaded = load_database(generated_file);
+    assert(loaded == 1);
+    assert(db.count == 20000 && db.systems.count == 50 && db.types.count == 7);
+    int generated_deleted = database_count_deleted();
+    assert(generated_deleted > 4500 && generated_deleted < 5500);
+    int generated_passed = 0;
+    for (int row = 0; row < db.count; row++)
+    {
+        assert(db.results[row] == PASSED || db.results[row] == SUCCESS);
+        assert(validate_system_name(db.systems.strings[db.system_codes[row]]));
+        assert(validate_test_type(db.types.strings[db.type_codes[row]]));
+        assert(row == 0 || db.test_ids[row] > db.test_ids[row - 1]); // No duplicates unless asked
+        generated_passed += db.results[row] == PASSED;
+    }
+    assert(generated_passed > 14000 && generated_passed < 16000);
+    assert(db.test_ids[db.count - 1] > db.count); // Some IDs skipped ahead
+
+    // Duplicate injection repeats IDs already written
+    generator.duplicates = 0.05;
+    generated = generate_dataset(generated_file, &generator);
+    assert(generated == 1);
+    loaded = load_database(generated_file);
+    assert(loaded == 1);
+    int repeated_ids = 0;
+    for (int row = 1; row < db.count; row++)
+        repeated_ids += db.test_ids[row] <= db.test_ids[row - 1];
+    assert(repeated_ids > 500 && repeated_ids < 1500);
+    database_reset();
+    remove(generated_file);
+
+    // Unknown options and out-of-range values are refused
+    char *bad_generator_args[][5] = {{"tdm", "generate", "x.csv", "--deleted", "1.5"},
+                                     {"tdm", "generate", "x.csv", "--results", "1,2,3"},
+                                     {"tdm", "generate", "x.csv", "--systems", "0"},
+                                     {"tdm", "generate", "x.csv", "--colour", "red"},
+                                     {"tdm", "generate", "x.csv", "--rows", "10q"}};
+    for (int b = 0; b < 5; b++)
+        assert(generator_parse_options(5, bad_generator_args[b], 3, &generator) == 0);
+
+    // Running out of TestIDs is its own failure and leaves no partial file
+    char *crowded_args[] = {"tdm", "generate", (char *)generated_file, "--rows", "1000", "--gaps", "1",
+                            "--max-gap", "100000000"};
+    parsed = generator_parse_options(9, crowded_args, 3, &generator);
+    assert(parsed == 1);
+    generated = generate_dataset(generated_file, &generator);
+    assert(generated == -1);
+    assert(fopen(generated_file, "r") == NULL);
+
+    // Binary extensions are refused rather than given CSV text
+    char *binary_args[] = {"tdm", "generate", "generator_test" SNAPSHOT_SUFFIX, "--rows", "10"};
+    int generate_status = generate_main(5, binary_args);
+    assert(generate_status == 2);
+    assert(fopen(binary_args[2], "r") == NULL);
+
+    printf("✓ dataset generator tests passed\n");
+
+    // Restore original database state
+    test_database_end(original_db);
+
+    printf("\nAll Batch Mode Tests PASSED!\n");
+    printf("Total test categories: 2\n");
+    printf("- batch commands: ✓\n");
+    printf("- dataset generator: ✓\n");
+}
+
+void test_instrumentation(void)
+{
+    printf("Running Instrumentation Tests...\n");
+
+    Database *original_db = test_database_begin("instrumentation_test.csv");
+    if (!original_db)
+        return;
+
+    printf("Testing metrics...\n");
+
+    // Every value lands in a bucket whose limit is at most 1/16 above it, in order
+    int previous_bucket = 0;
+    for (uint64_t value = 0; value < (1ULL << 62); value = value < 64 ? value + 1 : value + value / 7)
+    {
+        int bucket = metric_bucket(value);
+        assert(bucket >= previous_bucket && bucket < METRIC_BUCKETS);
+        assert(metric_bucket_limit(bucket) >= value && metric_bucket(metric_bucket_limit(bucket)) == bucket);
+        assert(metric_bucket_limit(bucket) - value <= value / METRIC_SUB_BUCKETS);
+        previous_bucket = bucket;
+    }
+    assert(metric_bucket(UINT64_MAX) == METRIC_BUCKETS - 1);
+
+    // The session's own numbers are put back afterwards
+    Metrics *session_metrics = malloc(sizeof(Metrics));
+    assert(session_metrics != NULL);
+    *session_metrics = metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    LatencyHistogram *lookups = &metrics.ops[METRIC_LOOKUP];
+    for (uint64_t value = 1; value <= 1000; value++)
+    {
+        lookups->buckets[metric_bucket(value * 1000)]++;
+        lookups->count++;
+    }
+    lookups->max_ns = 1000000;
+    assert(metrics_percentile(lookups, 50) >= 500000 && metrics_percentile(lookups, 50) <= 500000 * 17 / 16);
+    assert(metrics_percentile(lookups, 99) >= 990000 && metrics_percentile(lookups, 99) <= 1000000);
+    assert(metrics_percentile(lookups, 100) == 1000000 && metrics_percentile(&metrics.ops[METRIC_SAVE], 50) == 0);
+
+    // The instrumented paths count their calls and bytes
+    memset(&metrics, 0, sizeof(metrics));
+    const char *metrics_source = "metrics_test.csv";
+    FILE *fixture = fopen(metrics_source, "w");
+    assert(fixture != NULL);
+    fprintf(fixture, "%s\n1,Metrics System,UnitTest,Passed,1\n2,Metrics System,LoadTest,Failed,1\n", REQUIRED_HEADER);
+    fclose(fixture);
+    int loaded = load_database(metrics_source);
+    assert(loaded == 1);
+    assert(metrics.ops[METRIC_LOAD].count == 1 && metrics.bytes_read == (uint64_t)file_size_or_zero(metrics_source));
+    int found_row = find_record_by_id(2);
+    int missing_row = find_record_by_id(99);
+    assert(found_row == 1 && missing_row == -1);
+    assert(metrics.ops[METRIC_LOOKUP].calls == 2 && metrics.ops[METRIC_LOOKUP].count == 1); // Sampled
+    int marked = database_set_active(0, 0);
+    assert(marked == 1);
+    marked = database_set_active(0, 1);
+    assert(marked == 1);
+    marked = database_set_active(0, 0);
+    assert(marked == 1);
+    int purged = database_purge_record(0);
+    assert(purged == 1);
+    assert(metrics.ops[METRIC_DELETE].count == 3 && metrics.bytes_written > 0); // Recover is not a delete
+    int checkpointed = database_checkpoint();
+    assert(checkpointed == 1);
+    assert(metrics.ops[METRIC_SAVE].count == 1);
+    assert(metrics.ops[METRIC_SAVE].total_ns >= metrics.ops[METRIC_SAVE].max_ns);
+
+    const char *metrics_file = "metrics_test.json";
+    int written = write_metrics_json(metrics_file);
+    assert(written == 1);
+    size_t metrics_size = 0;
+    char *metrics_text = read_file_contents(metrics_file, &metrics_size);
+    assert(metrics_text != NULL);
+    assert(strstr(metrics_text, "\"find_record_by_id\": {\"count\": 2, \"timed\": 1,") != NULL);
+    assert(strstr(metrics_text, "\"bytes_read\": ") != NULL && strstr(metrics_text, "\"p99\": ") != NULL);
+    free(metrics_text);
+    remove(metrics_file);
+    database_reset();
+    remove(metrics_source);
+    metrics = *session_metrics;
+    free(session_metrics);
+
+    printf("✓ metrics tests passed\n");
+
+    printf("Testing tracing...\n");
+
+    // Off, a span marker records nothing; a session's own trace is put back afterwards
+    int session_tracing = tracing;
+    TraceEvent *session_events = trace_events;
+    uint64_t session_head = trace_head;
+    uint64_t session_start = trace_start_ns;
+    tracing = 0;
+    trace_events = NULL;
+    trace_head = 0;
+    TRACE_BEGIN("untraced");
+    TRACE_END("untraced");
+    assert(trace_head == 0);
+
+    // Spans nest in order and each thread gets its own tid
+    int enabled = trace_enable();
+    assert(enabled == 1);
+    assert(trace_head == 1 && trace_events[0].phase == 'B' && strcmp(trace_events[0].name, "session") == 0);
+    uint32_t main_thread = trace_events[0].thread;
+    TRACE_BEGIN("outer");
+    TRACE_BEGIN("inner");
+    TRACE_END("inner");
+    TRACE_END("outer");
+    assert(trace_head == 5 && strcmp(trace_events[2].name, "inner") == 0 && trace_events[4].phase == 'E');
+    assert(trace_events[4].timestamp_ns >= trace_events[1].timestamp_ns);
+#ifndef _WIN32
+    database_reset();
+    for (int i = 0; i < 1000; i++)
+    {
+        TestRecord traced = make_record(i + 1, "Traced System", "UnitTest", PASSED, 1);
+        int stored = database_append_record(&traced);
+        assert(stored == 1);
+    }
+    SaveChunk traced_chunks[2];
+    memset(traced_chunks, 0, sizeof(traced_chunks));
+    size_t traced_lengths[SUCCESS + 1] = {7, 7, 8, 8};
+    for (int i = 0; i < 2; i++)
+    {
+        traced_chunks[i].first = i * 500;
+        traced_chunks[i].end = (i + 1) * 500;
+        traced_chunks[i].result_lengths = traced_lengths;
+    }
+    run_chunk_workers(traced_chunks, sizeof(SaveChunk), 2, size_save_chunk_worker);
+    assert(trace_head == 9);
+    int worker_events = 0;
+    for (int i = 5; i < 9; i++)
+    {
+        assert(strcmp(trace_events[i].name, "size_chunk") == 0);
+        worker_events += trace_events[i].thread != main_thread;
+    }
+    assert(worker_events == 2);
+    database_reset();
+#endif
+
+    // Past capacity the oldest events are overwritten and counted as dropped
+    while (trace_head < TRACE_CAPACITY + 10)
+        TRACE_BEGIN("filler");
+    const char *trace_file = "trace_test.json";
+    written = write_trace_json(trace_file);
+    assert(written == 1);
+    size_t trace_size = 0;
+    char *trace_text = read_file_contents(trace_file, &trace_size);
+    assert(trace_text != NULL);
+    assert(strstr(trace_text, "\"dropped_events\": 10}") != NULL);
+    assert(strstr(trace_text, "\"args\": {\"name\": \"main\"}") != NULL);
+    int trace_lines = 0;
+    for (char *line = strstr(trace_text, "\"ts\": "); line; line = strstr(line + 1, "\"ts\": "))
+        trace_lines++;
+    assert(trace_lines == TRACE_CAPACITY);
+    assert(strcmp(trace_text + trace_size - 5, "}\n]}\n") == 0);
+    free(trace_text);
+    remove(trace_file);
+    trace_disable();
+    tracing = session_tracing;
+    trace_events = session_events;
+    trace_head = session_head;
+    trace_start_ns = session_start;
+
+    printf("✓ tracing tests passed\n");
+
+    // Restore original database state
+    test_database_end(original_db);
+
+    printf("\nAll Instrumentation Tests PASSED!\n");
+    printf("Total test categories: 2\n");
+    printf("- metrics: ✓\n");
+    printf("- tracing: ✓\n");
+}
+
+void test_screen_renderer(void)
+{
+    printf("Running Screen Renderer Tests...\n");
+
+    Database *original_db = test_database_begin("screen_test.csv");
+    if (!original_db)
+        return;
+
+    printf("Testing screen renderer...\n");
+
+    // Compose against a pretend terminal; the real one is put back afterwards
+    int terminal_ansi = screen.ansi;
+    screen.ansi = 1;
+    screen_invalidate();
+    screen_begin();
+    screen_add("first");
+    screen_add("second");
+    screen_add("third");
+    int redrawn = screen_compose("Prompt: ", 0, 0);
+    assert(redrawn == 3);
+    const char *full_frame = SCREEN_CLEAR "first\nsecond\nthird\nPrompt: ";
+    assert(screen.output_length == strlen(full_frame) && memcmp(screen.output, full_frame, strlen(full_frame)) == 0);
+
+    // Only the changed line moves the cursor and is rewritten
+    screen_begin();
+    screen_add("first");
+    screen_add("SECOND");
+    screen_add("third");
+    redrawn = screen_compose("Prompt: ", 0, 0);
+    assert(redrawn == 1);
+    const char *diff_frame = "\x1b[2;1HSECOND\x1b[K\x1b[4;1HPrompt: \x1b[J";
+    assert(screen.output_length == strlen(diff_frame) && memcmp(screen.output, diff_frame, strlen(diff_frame)) == 0);
+
+    // A new line count, a short terminal or a clear in between redraw everything
+    screen_begin();
+    screen_add("first");
+    screen_add("SECOND");
+    redrawn = screen_compose("Prompt: ", 0, 0);
+    assert(redrawn == 2);
+    screen_begin();
+    screen_add("first");
+    screen_add("second");
+    redrawn = screen_compose("Prompt: ", 3, 0);
+    assert(redrawn == 2);
+    screen_begin();
+    screen_add("first");
+    screen_add("second");
+    redrawn = screen_compose("Prompt: ", 3, 0);
+    assert(redrawn == 2 && strncmp(screen.output, SCREEN_CLEAR, strlen(SCREEN_CLEAR)) == 0);
+    screen_begin();
+    screen_add("first");
+    screen_add("second");
+    redrawn = screen_compose("Prompt: ", 4, 0);
+    assert(redrawn == 2);
+    screen_begin();
+    screen_add("first");
+    screen_add("second");
+    redrawn = screen_compose("Prompt: ", 4, 0);
+    assert(redrawn == 0);
+    screen_invalidate();
+    screen_begin();
+    screen_add("first");
+    screen_add("second");
+    redrawn = screen_compose("Prompt: ", 4, 0);
+    assert(redrawn == 2);
+
+    // Lines wider than the terminal wrap onto extra rows, so such frames and the
+    // one after them are redrawn whole; box drawing counts one column a character
+    assert(screen_text_width("│ ab │") == 6 && screen_text_width("") == 0);
+    for (int pass = 0; pass < 3; pass++)
+    {
+        screen_begin();
+        screen_add("│ first │");
+        screen_add(pass < 2 ? "│ second │" : "│ SECOND │");
+        redrawn = screen_compose("> ", 0, pass < 2 ? 9 : 80);
+        assert(redrawn == 2);
+    }
+    screen_begin();
+    screen_add("│ first │");
+    screen_add("│ second │");
+    redrawn = screen_compose("> ", 0, 80);
+    assert(redrawn == 1);
+    screen_begin();
+    screen_add("│ first │");
+    screen_add("│ second │");
+    redrawn = screen_compose("> ", 0, 80);
+    assert(redrawn == 0);
+    screen_begin();
+    screen_add("│ first │");
+    screen_add("│ second │");
+    redrawn = screen_compose("a long prompt", 0, 10);
+    assert(redrawn == 2);
+
+    // Overlong lines are cut rather than overflowing
+    screen_begin();
+    memset(screen_line(), 'x', SCREEN_LINE_SIZE - 1);
+    redrawn = screen_compose("", 0, 0);
+    assert(redrawn == 1 && screen.output_length == strlen(SCREEN_CLEAR) + SCREEN_LINE_SIZE);
+
+    // Without escape sequences every frame is plain text
+    screen.ansi = 0;
+    screen_begin();
+    screen_add("plain");
+    redrawn = screen_compose("> ", 0, 0);
+    assert(redrawn == 1);
+    assert(screen.output_length == 8 && memcmp(screen.output, "plain\n> ", 8) == 0);
+    screen_begin();
+    screen_add("plain");
+    redrawn = screen_compose("> ", 0, 0);
+    assert(redrawn == 1);
+
+    // Flipping between two record pages rewrites only the rows
+    screen.ansi = 1;
+    database_reset();
+    RowSet page_rows;
+    int allocated = rowset_init(&page_rows, PAGINATION_SIZE * 2);
+    assert(allocated);
+    for (int i = 0; i < PAGINATION_SIZE * 2; i++)
+    {
+        TestRecord paged = make_record(i + 1, "Paged System", "UnitTest", (TestResult)(i % 4), 1);
+        int stored = database_append_record(&paged);
+        assert(stored == 1);
+        page_rows.rows[page_rows.count++] = (uint32_t)i;
+    }
+    screen_invalidate();
+    compose_records_page(&page_rows, 0);
+    redrawn = screen_compose("Page 1 of 2: ", 0, 0);
+    assert(redrawn == PAGINATION_SIZE + 4);
+    compose_records_page(&page_rows, 1);
+    redrawn = screen_compose("Page 2 of 2: ", 0, 0);
+    assert(redrawn == PAGINATION_SIZE);
+    compose_records_page(&page_rows, 0);
+    redrawn = screen_compose("Page 1 of 2: ", 40, 80);
+    assert(redrawn == PAGINATION_SIZE + 4); // Rows are 98 columns wide
+    compose_records_page(&page_rows, 1);
+    redrawn = screen_compose("Page 2 of 2: ", 40, 80);
+    assert(redrawn == PAGINATION_SIZE + 4);
+    assert(strstr(screen.output, "│ 21  │ 21     │ Paged System") != NULL);
+    rowset_free(&page_rows);
+    database_reset();
+    screen.ansi = terminal_ansi;
+    screen_invalidate();
+
+    printf("✓ screen renderer tests passed\n");
+
+    // Restore original database state
+    test_database_end(original_db);
+
+    printf("\nAll Screen Renderer Tests PASSED!\n");
+    printf("Total test categories: 1\n");
+    printf("- screen renderer: ✓\n");
+}
+
+void run_all_tests(void)
+{
+    printf("╔══════════════════════════════════════════════════════════════╗\n");
+    printf("║                    UNIT TEST SUITE                           ║\n");
+    printf("║                 System Testing Data Manager                  ║\n");
+    printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+    printf("Starting comprehensive unit test suite...\n\n");
+
+    // Test input validation functions
+    printf("Test Category 1: Input Validation\n");
+    printf("────────────────────────────────────────\n");
+    test_input_validation();
+
+    printf("\n\nTest Category 2: CRUD Operations\n");
+    printf("────────────────────────────────────────\n");
+    test_crud_operations();
+
+    printf("\n\nTest Category 3: Record Storage\n");
+    printf("────────────────────────────────────────\n");
+    test_record_storage();
+
+    printf("\n\nTest Category 4: Search\n");
+    printf("────────────────────────────────────────\n");
+    test_search();
+
+    printf("\n\nTest Category 5: Persistence\n");
+    printf("────────────────────────────────────────\n");
+    test_persistence();
+
+    printf("\n\nTest Category 6: Binary Format\n");
+    printf("────────────────────────────────────────\n");
+    test_binary_formats();
+
+    printf("\n\nTest Category 7: Statistics\n");
+    printf("────────────────────────────────────────\n");
+    test_statistics();
+
+    printf("\n\nTest Category 8: Batch Mode\n");
+    printf("────────────────────────────────────────\n");
+    test_batch_mode();
+
+    printf("\n\nTest Category 9: Instrumentation\n");
+    printf("────────────────────────────────────────\n");
+    test_instrumentation();
+
+    printf("\n\nTest Category 10: Screen Renderer\n");
+    printf("────────────────────────────────────────\n");
+    test_screen_renderer();
+
+    printf("\n\n╔══════════════════════════════════════════════════════════════╗\n");
+    printf("║                     TEST SUMMARY                             ║\n");
+    printf("╠══════════════════════════════════════════════════════════════╣\n");
+    printf("║ Input Validation Tests:     PASSED                           ║\n");
+    printf("║ CRUD Operations Tests:      PASSED                           ║\n");
+    printf("║ Record Storage Tests:       PASSED                           ║\n");
+    printf("║ Search Tests:               PASSED                           ║\n");
+    printf("║ Persistence Tests:          PASSED                           ║\n");
+    printf("║ Binary Format Tests:        PASSED                           ║\n");
+    printf("║ Statistics Tests:           PASSED                           ║\n");
+    printf("║ Batch Mode Tests:           PASSED                           ║\n");
+    printf("║ Instrumentation Tests:      PASSED                           ║\n");
+    printf("║ Screen Renderer Tests:      PASSED                           ║\n");
+    printf("╠══════════════════════════════════════════════════════════════╣\n");
+    printf("║ ALL UNIT TESTS PASSED SUCCESSFULLY!                          ║\n");
+    printf("╚══════════════════════════════════════════════════════════════╝\n");
+}
+
+void run_e2e_tests(void)
+{
+    printf("╔══════════════════════════════════════════════════════════════╗\n");
+    printf("║                   END-TO-END TEST SUITE                      ║\n");
+    printf("║                System Testing Data Manager                   ║\n");
+    printf("╚══════════════════════════════════════════════════════════════╝\n\n");
+
+    printf("Starting End-to-End testing...\n\n");
+
+    // Save original database state
+    Database *original_db = malloc(sizeof(Database));
+    if (!original_db)
+    {
+        printf("Error: Unable to allocate memory for database backup.\n");
+        return;
+    }
+    memcpy(original_db, &db, sizeof(Database));
+
+    printf("E2E Test 1: Complete Database Workflow\n");
+    printf("─────────────────────────────────────────────\n");
+
+    // Initialize test database
+    memset(&db, 0, sizeof(db));
+    strcpy(db.filename, "e2e_test.csv");
+    db.next_id = 1;
+
+    // Test 1: Create test records
+    printf("Testing complete record creation workflow...\n");
+
+    TestRecord test_records[] = {
+        make_record(1, "WebApp Frontend", "UnitTest", PASSED, 1),
+        make_record(2, "API Gateway", "IntegrationTest", FAILED, 1),
+        make_record(3, "Database Layer", "SystemTest", PENDING, 1),
+        make_record(4, "Authentication Service", "SecurityTest", SUCCESS, 1),
+        make_record(5, "Payment System", "LoadTest", FAILED, 0) // Deleted record
+    };
+
+    // Add records to database
+    for (int i = 0; i < 5; i++)
+    {
+        int stored = database_append_record(&test_records[i]);
+        assert(stored == 1);
+        db.next_id = test_records[i].test_id + 1;
+    }
+
+    assert(db.count == 5);
+    printf("✓ Record creation workflow completed\n");
+
+    // Test 2: Search functionality
+    printf("Testing search functionality...\n");
+
+    int search_results = 0;
+    for (int i = 0; i < db.count; i++)
+    {
+        if (database_is_active(i) && contains_ci(db.systems.strings[db.system_codes[i]], "API"))
+        {
+            search_results++;
+        }
+    }
+    assert(search_results == 1); // Should find "API Gateway"
+    printf("✓ Search functionality working correctly\n");
+
+    // Test 3: Update operations
+    printf("Testing update operations...\n");
+
+    int index = find_record_by_id(2);
+    assert(index != -1);
+    TestRecord record = database_get_record(index);
+    TestResult old_result = record.test_result;
+    record.test_result = PASSED; // Change from FAILED to PASSED
+    database_set_record(index, &record);
+    assert(db.results[index] == PASSED);
+    assert(db.results[index] != old_result);
+    printf("✓ Update operations working correctly\n");
+
+    // Test 4: Delete and recovery operations
+    printf("Testing delete and recovery operations...\n");
+
+    // Test soft delete
+    index = find_record_by_id(3);
+    assert(index != -1);
+    assert(database_is_active(index) == 1);
+    database_mark_active(index, 0); // Soft delete
+    assert(database_is_active(index) == 0);
+
+    // Test recovery
+    database_mark_active(index, 1); // Recover
+    assert(database_is_active(index) == 1);
+    printf("✓ Delete and recovery operations working correctly\n");
+
+    // Test 5: Data integrity checks
+    printf("Testing data integrity...\n");
+
+    int active_count = 0;
+    int deleted_count = 0;
+
+    for (int i = 0; i < db.count; i++)
+    {
+        if (database_is_active(i))
+        {
+            active_count++;
+        }
+        else
+        {
+            deleted_count++;
+        }
+
+        // Validate each record's data integrity
+        TestRecord checked = database_get_record(i);
+        assert(checked.test_id > 0);
+        assert(strlen(record_system_name(&checked)) >= MIN_NAME_LENGTH);
+        assert(strlen(record_test_type(&checked)) >= MIN_NAME_LENGTH);
+        assert(checked.test_result >= FAILED && checked.test_result <= SUCCESS);
+        assert(checked.active == 0 || checked.active == 1);
+    }
+
+    assert(active_count == 4);  // 4 active records
+    assert(deleted_count == 1); // 1 deleted record
+    assert(database_count_active() == active_count);
+    assert(database_count_deleted() == deleted_count);
+    printf("✓ Data integrity checks passed\n");
+
+    printf("\nE2E Test 2: ID Generation and Uniqueness\n");
+    printf("──────────────────────────────────────────────\n");
+
+    // Test ID generation
+    int original_next_id = db.next_id;
+    int new_id1 = get_next_test_id();
+    int new_id2 = get_next_test_id();
+
+    assert(new_id1 == original_next_id);
+    assert(new_id2 == original_next_id + 1);
+    assert(new_id1 != new_id2);
+    printf("✓ ID generation and uniqueness working correctly\n");
+
+    printf("\nE2E Test 3: Input Validation Integration\n");
+    printf("─────────────────────────────────────────────────\n");
+
+    // Test system name validation in context
+    char valid_names[][50] = {
+        "Production API Server",
+        "Test-Environment_v2.0",
+        "System[Backend]",
+        "Database (Primary)"};
+
+    for (int i = 0; i < 4; i++)
+    {
+        assert(validate_system_name(valid_names[i]) == 1);
+    }
+
+    // Test test type validation in context
+    char valid_types[][30] = {
+        "UnitTest",
+        "IntegrationTest",
+        "SystemTest",
+        "PerformanceTest"};
+
+    for (int i = 0; i < 4; i++)
+    {
+        assert(validate_test_type(valid_types[i]) == 1);
+    }
+
+    printf("✓ Input validation integration working correctly\n");
+
+    printf("\nE2E Test 4: Enum Conversion Workflow\n");
+    printf("─────────────────────────────────────────────\n");
+
+    // Test complete enum conversion workflow
+    const char *result_strings[] = {"Failed", "Passed", "Pending", "Success"};
+    TestResult expected_results[] = {FAILED, PASSED, PENDING, SUCCESS};
+
+    for (int i = 0; i < 4; i++)
+    {
+        TestResult converted = string_to_test_result(result_strings[i]);
+        assert(converted == expected_results[i]);
+
+        const char *back_converted = test_result_to_string(converted);
+        assert(strcmp(back_converted, result_strings[i]) == 0);
+    }
+
+    printf("✓ Enum conversion workflow working correctly\n");
+
+    printf("\nE2E Test 5: Memory Management\n");
+    printf("───────────────────────────────────────\n");
+
+    // Test memory allocation and deallocation patterns
+    TestRecord *temp_records = malloc(db.count * sizeof(TestRecord));
+    assert(temp_records != NULL);
+
+    // Copy and verify data
+    for (int i = 0; i < db.count; i++)
+    {
+        temp_records[i] = database_get_record(i);
+        assert(temp_records[i].test_id == db.test_ids[i]);
+        assert(temp_records[i].system_code == db.system_codes[i]);
+        assert(strcmp(record_system_name(&temp_records[i]), db.systems.strings[db.system_codes[i]]) == 0);
+    }
+
+    free(temp_records);
+    printf("✓ Memory management working correctly\n");
+
+    // Restore original database state
+    database_reset();
+    db = *original_db;
+    free(original_db);
+
+    printf("\n╔══════════════════════════════════════════════════════════════╗\n");
+    printf("║                    E2E TEST SUMMARY                          ║\n");
+    printf("╠══════════════════════════════════════════════════════════════╣\n");
+    printf("║ Complete Database Workflow:    PASSED                        ║\n");
+    printf("║ ID Generation & Uniqueness:    PASSED                        ║\n");
+    printf("║ Input Validation Integration:  PASSED                        ║\n");
+    printf("║ Enum Conversion Workflow:      PASSED                        ║\n");
+    printf("║ Memory Management:             PASSED                        ║\n");
+    printf("╠══════════════════════════════════════════════════════════════╣\n");
+    printf("║ ALL E2E TESTS PASSED SUCCESSFULLY!                           ║\n");
+    printf("╚══════════════════════════════════════════════════════════════╝\n");
+}
+
+double now_ms(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000.0 / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+#endif
+}
+
+uint64_t now_ns(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+char *read_file_contents(const char *filename, size_t *size)
+{
+    FILE *file = fopen(filename, "rb");
+    if (!file)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (length < 0)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    char *buffer = malloc((size_t)length + 1);
+    if (buffer && fread(buffer, 1, (size_t)length, file) != (size_t)length)
+    {
+        free(buffer);
+        buffer = NULL;
+    }
+    fclose(file);
+
+    if (buffer)
+    {
+        buffer[length] = '\0';
+        *size = (size_t)length;
+    }
+    return buffer;
+}
+
+long bench_tokenize_strtok(char *buffer, size_t size)
+{
+    // Tokenizer used by load_database before the structural scanner
+    long field_total = 0;
+    char *end = buffer + size;
+    char *line = buffer;
+
+    while (line < end)
+    {
+        char *newline = memchr(line, '\n', (size_t)(end - line));
+        if (newline)
+            *newline = '\0';
+        line[strcspn(line, "\n\r")] = '\0';
+
+        char *token = strtok(line, ",");
+        for (int i = 0; token && i < RECORD_FIELDS; i++)
+        {
+            field_total++;
+            token = i + 1 < RECORD_FIELDS ? strtok(NULL, ",") : NULL;
+        }
+
+        line = newline ? newline + 1 : end;
+    }
+    return field_total;
+}
+
+long bench_tokenize_scanner(char *buffer, size_t size)
+{
+    long field_total = 0;
+    char *end = buffer + size;
+    char *line = buffer;
+    StructuralScanner scanner;
+    scanner_init(&scanner, buffer, end);
 
-    printf("✓ string_to_test_result tests passed\n");
+    while (line < end)
+    {
+        char *fields[RECORD_FIELDS];
+        int field_count;
+        line = scan_record_fields(&scanner, line, fields, &field_count);
+        field_total += field_count;
+    }
+    return field_total;
+}
 
-    // Test test_result_to_string function
-    printf("Testing test_result_to_string...\n");
+void run_tokenizer_benchmark(void)
+{
+    const char *fixtures[] = {"test_files/memory_test_10k.csv", "test_files/memory_test_100k.csv"};
+
+    StructuralMaskFn kernels[3] = {structural_mask_scalar, NULL, NULL};
+    const char *kernel_names[3] = {"scalar", "sse2", "avx2"};
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        kernels[1] = structural_mask_sse2;
+    if (__builtin_cpu_supports("avx2"))
+        kernels[2] = structural_mask_avx2;
+#endif
 
-    assert(strcmp(test_result_to_string(FAILED), "Failed") == 0);
-    assert(strcmp(test_result_to_string(PASSED), "Passed") == 0);
-    assert(strcmp(test_result_to_string(PENDING), "Pending") == 0);
-    assert(strcmp(test_result_to_string(SUCCESS), "Success") == 0);
-    assert(strcmp(test_result_to_string(INVALID_RESULT), "Unknown") == 0);
-    assert(strcmp(test_result_to_string(-999), "Unknown") == 0); // Invalid enum value
+    init_structural_scanner();
+    StructuralMaskFn active_kernel = structural_mask;
 
-    printf("✓ test_result_to_string tests passed\n");
+    printf("Tokenizer microbenchmark (best of %d, ms)\n", BENCH_TRIALS);
+    printf("%-34s %10s %10s %10s %10s %10s\n", "Fixture", "MB", "strtok", kernel_names[0], kernel_names[1], kernel_names[2]);
 
-    printf("\nAll Input Validation Tests PASSED!\n");
-    printf("Total test categories: 6\n");
-    printf("- validate_system_name: ✓\n");
-    printf("- validate_test_type: ✓\n");
-    printf("- validate_test_id: ✓\n");
-    printf("- trim_string: ✓\n");
-    printf("- string_to_test_result: ✓\n");
-    printf("- test_result_to_string: ✓\n");
+    for (size_t f = 0; f < sizeof(fixtures) / sizeof(fixtures[0]); f++)
+    {
+        size_t size;
+        char *original = read_file_contents(fixtures[f], &size);
+        char *work = original ? malloc(size + 1) : NULL;
+        if (!work)
+        {
+            printf("%-34s (not found, run from the repository root)\n", fixtures[f]);
+            free(original);
+            continue;
+        }
+
+        double best[4];
+        long fields[4] = {0};
+        for (int k = 0; k < 4; k++)
+        {
+            best[k] = -1;
+            if (k > 0 && !kernels[k - 1])
+                continue;
+
+            for (int trial = 0; trial < BENCH_TRIALS; trial++)
+            {
+                memcpy(work, original, size + 1);
+                double start = now_ms();
+                if (k == 0)
+                {
+                    fields[k] = bench_tokenize_strtok(work, size);
+                }
+                else
+                {
+                    structural_mask = kernels[k - 1];
+                    fields[k] = bench_tokenize_scanner(work, size);
+                }
+                double elapsed = now_ms() - start;
+                if (best[k] < 0 || elapsed < best[k])
+                    best[k] = elapsed;
+            }
+        }
+        structural_mask = active_kernel;
+
+        printf("%-34s %10.2f", fixtures[f], (double)size / (1024.0 * 1024.0));
+        for (int k = 0; k < 4; k++)
+        {
+            if (best[k] < 0)
+                printf(" %10s", "n/a");
+            else
+                printf(" %10.3f", best[k]);
+        }
+        printf("\n");
+
+        for (int k = 1; k < 4; k++)
+        {
+            if (best[k] >= 0 && fields[k] != fields[0])
+                printf("  ✗ %s found %ld fields, strtok found %ld\n", kernel_names[k - 1], fields[k], fields[0]);
+        }
+
+        free(work);
+        free(original);
+    }
+    printf("Active kernel: %s\n", structural_kernel_name);
 }
 
-void test_crud_operations(void)
+void run_layout_benchmark(void)
 {
-    printf("Running CRUD Operations Tests...\n");
+    // Same rows in both layouts; the scan counts active rows and sums their IDs
+    TestRecord *rows = malloc((size_t)BENCH_LAYOUT_ROWS * sizeof(TestRecord));
+    Database *original_db = malloc(sizeof(Database));
+    if (!rows || !original_db)
+    {
+        printf("Error: Unable to allocate memory for the layout benchmark.\n");
+        free(rows);
+        free(original_db);
+        return;
+    }
+    memcpy(original_db, &db, sizeof(Database));
+    memset(&db, 0, sizeof(db));
 
-    // Save original database state
+    uint32_t seed = 12345;
+    TestRecord template_record = make_record(1, "BenchSystem", "BenchTest", PASSED, 1);
+    for (int i = 0; i < BENCH_LAYOUT_ROWS; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        rows[i] = template_record;
+        rows[i].test_id = i + 1;
+        rows[i].test_result = (int8_t)((seed >> 8) % 4);
+        rows[i].active = ((seed >> 16) % 10) < 7; // ~70% active
+    }
+
+    int loaded = database_reserve(BENCH_LAYOUT_ROWS);
+    for (int i = 0; loaded && i < BENCH_LAYOUT_ROWS; i++)
+    {
+        database_set_record(db.count++, &rows[i]);
+    }
+
+    double best_rows = -1;
+    double best_columns = -1;
+    long long checksum_rows = 0;
+    long long checksum_columns = 0;
+    for (int trial = 0; loaded && trial < BENCH_TRIALS; trial++)
+    {
+        double start = now_ms();
+        long long sum = 0;
+        for (int i = 0; i < BENCH_LAYOUT_ROWS; i++)
+        {
+            if (rows[i].active)
+                sum += rows[i].test_id;
+        }
+        double elapsed = now_ms() - start;
+        checksum_rows = sum;
+        if (best_rows < 0 || elapsed < best_rows)
+            best_rows = elapsed;
+
+        start = now_ms();
+        sum = 0;
+        for (int i = database_next_row(0, 1); i >= 0; i = database_next_row(i + 1, 1))
+        {
+            sum += db.test_ids[i];
+        }
+        elapsed = now_ms() - start;
+        checksum_columns = sum;
+        if (best_columns < 0 || elapsed < best_columns)
+            best_columns = elapsed;
+    }
+
+    // Random TestID lookups: linear scan against the index
+    const int lookups = 200;
+    double scan_ms = 0;
+    double index_ms = 0;
+    long long found = 0;
+    if (loaded)
+    {
+        double start = now_ms();
+        for (int n = 0; n < lookups; n++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            int id = (int)(seed >> 8) % BENCH_LAYOUT_ROWS + 1;
+            for (int i = 0; i < db.count; i++)
+            {
+                if (db.test_ids[i] == id)
+                {
+                    found += i;
+                    break;
+                }
+            }
+        }
+        scan_ms = (now_ms() - start) / lookups;
+
+        id_index_sync();
+        start = now_ms();
+        for (int n = 0; n < lookups * 1000; n++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            found += find_record_by_id((int)(seed >> 8) % BENCH_LAYOUT_ROWS + 1);
+        }
+        index_ms = (now_ms() - start) / (lookups * 1000);
+    }
+
+    // Collecting the active rows for a listing: record copies against row numbers
+    double copy_ms = -1;
+    double rowset_ms = -1;
+    int listed = 0;
+    for (int trial = 0; loaded && trial < BENCH_TRIALS; trial++)
+    {
+        double start = now_ms();
+        TestRecord *copies = malloc((size_t)db.count * sizeof(TestRecord));
+        int copied = 0;
+        for (int i = 0; copies && i < db.count; i++)
+        {
+            if (database_is_active(i))
+                copies[copied++] = database_get_record(i);
+        }
+        free(copies);
+        double elapsed = now_ms() - start;
+        if (copy_ms < 0 || elapsed < copy_ms)
+            copy_ms = elapsed;
+
+        start = now_ms();
+        RowSet set;
+        if (rowset_select(&set, 1))
+            listed = set.count;
+        rowset_free(&set);
+        elapsed = now_ms() - start;
+        if (rowset_ms < 0 || elapsed < rowset_ms)
+            rowset_ms = elapsed;
+    }
+
+    // What the recovery screen needs before it can show "Total: N records"
+    double count_us = -1;
+    int counted = 0;
+    for (int trial = 0; loaded && trial < BENCH_TRIALS; trial++)
+    {
+        double start = now_ms();
+        counted = database_count_active() + database_count_deleted();
+        double elapsed = (now_ms() - start) * 1000.0;
+        if (count_us < 0 || elapsed < count_us)
+            count_us = elapsed;
+    }
+
+    // Statistics: the full recount against the delta one mutation applies
+    double rebuild_ms = -1;
+    double delta_us = 0;
+    for (int trial = 0; loaded && trial < BENCH_TRIALS; trial++)
+    {
+        double start = now_ms();
+        stats_rebuild();
+        double elapsed = now_ms() - start;
+        if (rebuild_ms < 0 || elapsed < rebuild_ms)
+            rebuild_ms = elapsed;
+    }
+    if (loaded)
+    {
+        const int deltas = 100000;
+        double start = now_ms();
+        for (int n = 0; n < deltas; n++)
+        {
+            stats_apply(&rows[n], -1);
+            stats_apply(&rows[n], 1);
+        }
+        delta_us = (now_ms() - start) * 1000.0 / deltas;
+    }
+
+    if (loaded)
+    {
+        printf("\nActive and deleted counts over %d rows: %.1f us (popcount)\n", counted, count_us);
+
+        printf("\nStatistics, %d rows\n", BENCH_LAYOUT_ROWS);
+        printf("%-34s %10.3f ms\n", "Full recount", rebuild_ms);
+        printf("%-34s %10.4f us\n", "Per-mutation delta", delta_us);
+
+        printf("\nList %d active rows (best of %d, ms)\n", listed, BENCH_TRIALS);
+        printf("%-34s %10.3f  (%zu MB allocated)\n", "TestRecord copies", copy_ms,
+               ((size_t)db.count * sizeof(TestRecord)) >> 20);
+        printf("%-34s %10.3f  (%zu MB allocated)\n", "RowSet", rowset_ms, ((size_t)db.count * sizeof(uint32_t)) >> 20);
+
+        printf("\nTestID lookup, %d rows (ms per lookup, checksum %lld)\n", BENCH_LAYOUT_ROWS, found);
+        printf("%-34s %10.4f\n", "Linear scan", scan_ms);
+        printf("%-34s %10.6f  (%s)\n", "ID index", index_ms, db.ids.sparse ? "hash table" : "direct array");
+
+        printf("\nActive-only scan, %d rows (best of %d, ms)\n", BENCH_LAYOUT_ROWS, BENCH_TRIALS);
+        printf("%-34s %10.3f  (%zu bytes/row)\n", "Row layout (TestRecord[])", best_rows, sizeof(TestRecord));
+        printf("%-34s %10.3f  (%.3f bytes/row touched)\n", "Columnar (active bits, ids[])", best_columns,
+               sizeof(db.test_ids[0]) + 1.0 / 8);
+        if (checksum_rows != checksum_columns)
+            printf("  ✗ checksum mismatch: %lld vs %lld\n", checksum_rows, checksum_columns);
+    }
+    else
+    {
+        printf("Error: Unable to allocate memory for the layout benchmark.\n");
+    }
+
+    database_reset();
+    db = *original_db;
+    free(original_db);
+    free(rows);
+}
+
+void run_journal_benchmark(void)
+{
+    // Cost of one change: the old full rewrite against a journal append
+    const char *bench_file = "bench_journal.csv";
+    const int changes = 1000;
     Database *original_db = malloc(sizeof(Database));
     if (!original_db)
     {
@@ -1707,378 +9371,1016 @@ void test_crud_operations(void)
         return;
     }
     memcpy(original_db, &db, sizeof(Database));
-
-    // Initialize test database
     memset(&db, 0, sizeof(db));
-    strcpy(db.filename, "crud_test.csv");
-    db.next_id = 1;
 
-    printf("Testing find_record_by_id...\n");
+    FILE *file = fopen(bench_file, "w");
+    if (!file)
+    {
+        printf("Error: Unable to create %s.\n", bench_file);
+        db = *original_db;
+        free(original_db);
+        return;
+    }
+    fprintf(file, "%s\n", REQUIRED_HEADER);
+    fclose(file);
+    strcpy(db.filename, bench_file);
 
-    // Test empty database
-    assert(find_record_by_id(1) == -1);
-    assert(find_record_by_id(999) == -1);
+    TestRecord template_record = make_record(1, "BenchSystem", "BenchTest", PASSED, 1);
+    printf("\nCost of one change (ms)\n");
+    printf("%-10s %16s %16s\n", "Rows", "Full rewrite", "Journal append");
+    for (int rows = 1000; rows <= BENCH_LAYOUT_ROWS; rows *= 10)
+    {
+        if (!database_reserve(rows))
+        {
+            printf("Error: Unable to allocate memory for %d rows.\n", rows);
+            break;
+        }
+        while (db.count < rows)
+        {
+            template_record.test_id = db.count + 1;
+            database_set_record(db.count++, &template_record);
+        }
 
-    // Add test records
-    TestRecord test_record1 = {1, "TestSystem1", "UnitTest", PASSED, 1};
-    TestRecord test_record2 = {2, "TestSystem2", "IntegrationTest", FAILED, 1};
-    TestRecord test_record3 = {3, "TestSystem3", "SystemTest", PENDING, 0}; // Deleted record
+        double start = now_ms();
+        int saved = save_database();
+        double rewrite_ms = now_ms() - start;
 
-    db.records[0] = test_record1;
-    db.records[1] = test_record2;
-    db.records[2] = test_record3;
-    db.count = 3;
+        start = now_ms();
+        int logged = 1;
+        for (int i = 0; i < changes && logged; i++)
+        {
+            logged = database_set_active(i % rows, i % 2);
+        }
+        double journal_ms = (now_ms() - start) / changes;
 
-    // Test finding existing records
-    assert(find_record_by_id(1) == 0);
-    assert(find_record_by_id(2) == 1);
-    assert(find_record_by_id(3) == 2);
+        if (!saved || !logged)
+        {
+            printf("Error: Unable to write %s.\n", bench_file);
+            break;
+        }
+        printf("%-10d %16.3f %16.4f\n", rows, rewrite_ms, journal_ms);
+
+        // Start each size from an empty journal
+        char journal[MAX_PATH + sizeof(JOURNAL_SUFFIX)];
+        journal_path(journal, sizeof(journal), bench_file);
+        journal_close();
+        remove(journal);
+        db.journal_bytes = 0;
+    }
 
-    // Test finding non-existing records
-    assert(find_record_by_id(4) == -1);
-    assert(find_record_by_id(999) == -1);
-    assert(find_record_by_id(0) == -1);
-    assert(find_record_by_id(-1) == -1);
+    // Same changes under each durability mode; batch also wraps them in one batch
+    const char *mode_names[] = {"none", "commit", "batch"};
+    DurabilityMode saved_mode = durability_mode;
+    printf("\n%-10s %16s\n", "Durability", "ms per change");
+    for (int mode = DURABILITY_NONE; mode <= DURABILITY_BATCH && db.count > 0; mode++)
+    {
+        durability_mode = (DurabilityMode)mode;
+        int durability_changes = changes / 5;
+        double start = now_ms();
+        int logged = 1;
+        if (mode == DURABILITY_BATCH)
+            database_begin_batch();
+        for (int i = 0; i < durability_changes && logged; i++)
+        {
+            logged = database_set_active(i % db.count, i % 2);
+        }
+        if (mode == DURABILITY_BATCH)
+            logged = database_end_batch() && logged;
+        double per_change = (now_ms() - start) / durability_changes;
+        if (!logged)
+        {
+            printf("Error: Unable to write %s.\n", bench_file);
+            break;
+        }
+        printf("%-10s %16.4f\n", mode_names[mode], per_change);
+    }
+    durability_mode = saved_mode;
 
-    printf("✓ find_record_by_id tests passed\n");
+    char bench_journal[MAX_PATH + sizeof(JOURNAL_SUFFIX)];
+    journal_path(bench_journal, sizeof(bench_journal), bench_file);
+    database_reset();
+    remove(bench_journal);
+    remove(bench_file);
+    db = *original_db;
+    free(original_db);
+}
 
-    printf("Testing get_next_test_id...\n");
+void run_substring_benchmark(void)
+{
+    // Needle absent from a buffer of letters and spaces, so every byte is scanned
+    const size_t size = 64u << 20;
+    const char needle[] = "zq7x";
+    char *text = malloc(size + 1);
+    if (!text)
+    {
+        printf("Error: Unable to allocate memory for the substring benchmark.\n");
+        return;
+    }
+    uint32_t seed = 4242;
+    for (size_t i = 0; i < size; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t pick = (seed >> 16) % 53;
+        text[i] = pick == 52 ? ' ' : pick < 26 ? (char)('a' + pick) : (char)('A' + pick - 26);
+    }
+    text[size] = '\0';
+
+    SubstringSearchFn kernels[3] = {substring_search_scalar, NULL, NULL};
+    const char *kernel_names[3] = {"scalar", "sse2", "avx2"};
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        kernels[1] = substring_search_sse2;
+    if (__builtin_cpu_supports("avx2"))
+        kernels[2] = substring_search_avx2;
+#endif
+    init_substring_search();
 
-    // Test initial state
-    db.next_id = 5;
-    assert(get_next_test_id() == 5);
-    assert(db.next_id == 6); // Should increment
-    assert(get_next_test_id() == 6);
-    assert(db.next_id == 7); // Should increment again
+    printf("\nCase-insensitive substring scan, %zu MB (best of %d, GB/s)\n", size >> 20, BENCH_TRIALS);
+    for (int k = -1; k < 3; k++)
+    {
+        if (k >= 0 && !kernels[k])
+        {
+            printf("%-12s %10s\n", kernel_names[k], "n/a");
+            continue;
+        }
 
-    printf("✓ get_next_test_id tests passed\n");
+        double best = -1;
+        const char *found = NULL;
+        for (int trial = 0; trial < BENCH_TRIALS; trial++)
+        {
+            double start = now_ms();
+            found = k < 0 ? strcasestr(text, needle) : kernels[k](text, size, needle, strlen(needle));
+            double elapsed = now_ms() - start;
+            if (best < 0 || elapsed < best)
+                best = elapsed;
+        }
+        printf("%-12s %10.2f%s\n", k < 0 ? "strcasestr" : kernel_names[k],
+               best > 0 ? (double)size / (best * 1e6) : 0.0, found ? "  ✗ unexpected match" : "");
+    }
+    printf("Active kernel: %s\n", substring_kernel_name);
+    free(text);
+}
 
-    printf("Testing database record validation...\n");
+// The save loop before the buffered serializer, kept as the baseline
+int write_database_csv_stdio(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return 0;
 
-    // Test valid records
-    TestRecord valid_record = {10, "ValidSystem", "ValidTest", PASSED, 1};
-    assert(valid_record.test_id > 0);
-    assert(strlen(valid_record.system_name) >= MIN_NAME_LENGTH);
-    assert(strlen(valid_record.test_type) >= MIN_NAME_LENGTH);
-    assert(valid_record.test_result >= FAILED && valid_record.test_result <= SUCCESS);
-    assert(valid_record.active == 0 || valid_record.active == 1);
+    int ok = fprintf(file, "%s\n", REQUIRED_HEADER) >= 0;
+    for (int i = 0; ok && i < db.count; i++)
+    {
+        ok = fprintf(file, "%d,%s,%s,%s,%d\n", db.test_ids[i], db.systems.strings[db.system_codes[i]],
+                     db.types.strings[db.type_codes[i]], test_result_to_string(db.results[i]),
+                     database_is_active(i)) >= 0;
+    }
+    if (fclose(file) != 0)
+        ok = 0;
+    return ok;
+}
 
-    // Test edge cases for record fields
-    TestRecord edge_record1 = {1, "ABC", "DEF", FAILED, 0}; // Minimum length names
-    assert(strlen(edge_record1.system_name) == MIN_NAME_LENGTH);
-    assert(strlen(edge_record1.test_type) == MIN_NAME_LENGTH);
+void run_save_benchmark(void)
+{
+    const char *stdio_file = "bench_save_stdio.csv";
+    const char *buffered_file = "bench_save.csv";
+    Database *original_db = malloc(sizeof(Database));
+    if (!original_db)
+    {
+        printf("Error: Unable to allocate memory for database backup.\n");
+        return;
+    }
+    memcpy(original_db, &db, sizeof(Database));
+    memset(&db, 0, sizeof(db));
 
-    TestRecord edge_record2 = {999999, "Very Long System Name", "VeryLongTestType", SUCCESS, 1};
-    assert(edge_record2.test_id > 0);
-    assert(strlen(edge_record2.system_name) > MIN_NAME_LENGTH);
-    assert(strlen(edge_record2.test_type) > MIN_NAME_LENGTH);
+    if (!bench_fill_database(BENCH_LAYOUT_ROWS))
+    {
+        printf("Error: Unable to allocate memory for the save benchmark.\n");
+        database_reset();
+        db = *original_db;
+        free(original_db);
+        return;
+    }
 
-    printf("✓ database record validation tests passed\n");
+    // Without fsync, so only rendering and write calls are measured
+    DurabilityMode saved_durability = durability_mode;
+    durability_mode = DURABILITY_NONE;
+    int saved_threads = save_threads;
+    double best[3] = {-1, -1, -1};
+    int ok = 1;
+    for (int trial = 0; ok && trial < BENCH_TRIALS; trial++)
+    {
+        double start = now_ms();
+        ok = write_database_csv_stdio(stdio_file);
+        double elapsed = now_ms() - start;
+        if (best[0] < 0 || elapsed < best[0])
+            best[0] = elapsed;
+
+        save_threads = 1;
+        start = now_ms();
+        ok = ok && write_database_csv(buffered_file);
+        elapsed = now_ms() - start;
+        if (best[1] < 0 || elapsed < best[1])
+            best[1] = elapsed;
+        save_threads = saved_threads;
+
+        start = now_ms();
+        ok = ok && write_database_csv(buffered_file);
+        elapsed = now_ms() - start;
+        if (best[2] < 0 || elapsed < best[2])
+            best[2] = elapsed;
+    }
+    durability_mode = saved_durability;
 
-    printf("Testing validate_csv_header (mock)...\n");
+    size_t stdio_size = 0;
+    size_t buffered_size = 0;
+    char *stdio_bytes = ok ? read_file_contents(stdio_file, &stdio_size) : NULL;
+    char *buffered_bytes = ok ? read_file_contents(buffered_file, &buffered_size) : NULL;
+    if (stdio_bytes && buffered_bytes)
+    {
+        int identical = stdio_size == buffered_size && memcmp(stdio_bytes, buffered_bytes, stdio_size) == 0;
+        double megabytes = (double)buffered_size / (1 << 20);
+        printf("\nSave %d rows, %.1f MB (best of %d, ms, no fsync)\n", BENCH_LAYOUT_ROWS, megabytes, BENCH_TRIALS);
+        printf("%-34s %10.1f  (%.0f MB/s)\n", "fprintf per row", best[0], megabytes / (best[0] / 1000.0));
+        printf("%-34s %10.1f  (%.0f MB/s, %.1fx)\n", "Buffered serializer", best[1], megabytes / (best[1] / 1000.0),
+               best[0] / best[1]);
+        int thread_count = get_save_thread_count(db.count);
+        if (thread_count > 1)
+        {
+            char parallel_label[48];
+            snprintf(parallel_label, sizeof(parallel_label), "Parallel serializer (%d threads)", thread_count);
+            printf("%-34s %10.1f  (%.0f MB/s, %.1fx)\n", parallel_label, best[2], megabytes / (best[2] / 1000.0),
+                   best[0] / best[2]);
+        }
+        else
+        {
+            printf("%-34s %10s  (one CPU; TDM_SAVE_THREADS sets the count)\n", "Parallel serializer", "-");
+        }
+        printf("%s\n", identical ? "Output is byte-identical" : "✗ Output differs");
+    }
+    else
+    {
+        printf("Error: Unable to run the save benchmark.\n");
+    }
+    free(stdio_bytes);
+    free(buffered_bytes);
+    remove(stdio_file);
+    remove(buffered_file);
 
-    // Test required header format
-    const char *required = REQUIRED_HEADER;
-    assert(strcmp(required, "TestID,SystemName,TestType,TestResult,Active") == 0);
+    database_reset();
+    db = *original_db;
+    free(original_db);
+}
 
-    printf("✓ CSV header validation tests passed\n");
+void run_snapshot_benchmark(void)
+{
+    const char *files[3] = {"bench_snapshot.csv", "bench_snapshot" SNAPSHOT_SUFFIX, "bench_snapshot" ARCHIVE_SUFFIX};
+    const char *labels[3] = {"CSV load_database", "Snapshot " SNAPSHOT_SUFFIX, "Archive " ARCHIVE_SUFFIX};
+    Database *original_db = malloc(sizeof(Database));
+    if (!original_db)
+    {
+        printf("Error: Unable to allocate memory for database backup.\n");
+        return;
+    }
+    memcpy(original_db, &db, sizeof(Database));
+    memset(&db, 0, sizeof(db));
+
+    int ok = bench_fill_database(BENCH_LAYOUT_ROWS);
+    DurabilityMode saved_durability = durability_mode;
+    durability_mode = DURABILITY_NONE;
+    ok = ok && write_database_csv(files[0]) && write_database_snapshot(files[1]) && write_database_archive(files[2]);
+    durability_mode = saved_durability;
+
+    // Open plus one full pass over a column, so pages the open skipped are paid for
+    double best[3] = {-1, -1, -1};
+    long long checks[3] = {0, 0, 0};
+    for (int trial = 0; ok && trial < BENCH_TRIALS; trial++)
+    {
+        for (int k = 0; ok && k < 3; k++)
+        {
+            double start = now_ms();
+            ok = load_database(files[k]);
+            long long failed = 0;
+            for (int row = 0; ok && row < db.count; row++)
+                failed += db.results[row] == FAILED;
+            double elapsed = now_ms() - start;
+            checks[k] = failed + db.count;
+            if (best[k] < 0 || elapsed < best[k])
+                best[k] = elapsed;
+        }
+    }
+
+    if (ok)
+    {
+        printf("\nOpen %d rows and scan one column (best of %d, ms, warm cache)\n", BENCH_LAYOUT_ROWS, BENCH_TRIALS);
+        double csv_size = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            struct stat info;
+            double size = stat(files[k], &info) == 0 ? (double)info.st_size : 0;
+            csv_size = k == 0 ? size : csv_size;
+            printf("%-34s %10.1f  (%.2f MB, %.1fx smaller, %.1fx faster)\n", labels[k], best[k], size / (1 << 20),
+                   csv_size / size, best[0] / best[k]);
+        }
+        printf("%s\n", checks[0] == checks[1] && checks[0] == checks[2] ? "All contain the same rows"
+                                                                       : "✗ Row contents differ");
+    }
+    else
+    {
+        printf("Error: Unable to run the snapshot benchmark.\n");
+    }
 
-    printf("Testing database bounds checking...\n");
+    database_reset();
+    for (int k = 0; k < 3; k++)
+        remove(files[k]);
+    db = *original_db;
+    free(original_db);
+}
 
-    // Test maximum records limit
-    int test_count = MAX_RECORDS;
-    assert(test_count == MAX_RECORDS);
+void run_search_benchmark(void)
+{
+    // Full scan with a substring search per field against the trigram index
+    const char *terms[] = {"System42", "type7", "4242", "nothing"};
+    Database *original_db = malloc(sizeof(Database));
+    RowSet results;
+    if (!original_db || !rowset_init(&results, BENCH_LAYOUT_ROWS))
+    {
+        printf("Error: Unable to allocate memory for the search benchmark.\n");
+        free(original_db);
+        return;
+    }
+    memcpy(original_db, &db, sizeof(Database));
+    memset(&db, 0, sizeof(db));
 
-    // Test that we don't exceed maximum
-    if (test_count >= MAX_RECORDS)
+    int loaded = database_reserve(BENCH_LAYOUT_ROWS);
+    for (int i = 0; loaded && i < BENCH_LAYOUT_ROWS; i++)
     {
-        // Should not add more records
-        printf("✓ Maximum records limit properly enforced\n");
+        char system_name[32];
+        char test_type[32];
+        snprintf(system_name, sizeof(system_name), "System%d", i % 5000);
+        snprintf(test_type, sizeof(test_type), "Type%d", i % 50);
+        TestRecord record = make_record(i + 1, system_name, test_type, (TestResult)(i % 4), i % 10 != 0);
+        database_set_record(db.count++, &record);
     }
 
-    // Test minimum valid test ID
-    assert(1 > 0); // Minimum valid test ID is 1
+    if (loaded)
+    {
+        double start = now_ms();
+        search_matching_rows("1000", &results); // Builds the indexes
+        printf("\nSearch, %d rows (index build %.1f ms; ms per query)\n", BENCH_LAYOUT_ROWS, now_ms() - start);
+        printf("%-12s %12s %12s %12s %10s\n", "Term", "Full scan", "No index", "Indexed", "Matches");
+    }
 
-    // Test enum bounds
-    assert(FAILED == 0);
-    assert(PASSED == 1);
-    assert(PENDING == 2);
-    assert(SUCCESS == 3);
-    assert(INVALID_RESULT == -1);
+    for (int t = 0; loaded && t < (int)(sizeof(terms) / sizeof(terms[0])); t++)
+    {
+        double start = now_ms();
+        int scanned = 0;
+        for (int i = 0; i < db.count; i++)
+        {
+            if (!database_is_active(i))
+                continue;
+            char id_str[20];
+            snprintf(id_str, sizeof(id_str), "%d", db.test_ids[i]);
+            if (strcasestr(db.systems.strings[db.system_codes[i]], terms[t]) ||
+                strcasestr(db.types.strings[db.type_codes[i]], terms[t]) ||
+                strcasestr(test_result_to_string(db.results[i]), terms[t]) || strstr(id_str, terms[t]))
+            {
+                results.rows[scanned++] = (uint32_t)i;
+            }
+        }
+        double scan_ms = now_ms() - start;
 
-    printf("✓ database bounds checking tests passed\n");
+        // Brute force over the dictionaries and IDs, then through the indexes
+        double best[2] = {-1, -1};
+        int matched[2] = {0, 0};
+        int saved_index = use_search_index;
+        for (int indexed = 0; indexed <= 1; indexed++)
+        {
+            use_search_index = indexed;
+            for (int trial = 0; trial < BENCH_TRIALS; trial++)
+            {
+                start = now_ms();
+                matched[indexed] = search_matching_rows(terms[t], &results);
+                double elapsed = now_ms() - start;
+                if (best[indexed] < 0 || elapsed < best[indexed])
+                    best[indexed] = elapsed;
+            }
+        }
+        use_search_index = saved_index;
+        printf("%-12s %12.2f %12.2f %12.2f %10d%s\n", terms[t], scan_ms, best[0], best[1], matched[1],
+               matched[0] == scanned && matched[1] == scanned ? "" : "  ✗ mismatch");
+    }
 
-    printf("Testing memory safety (basic checks)...\n");
+    // A compound filter: per-row strings and comparisons against the compiled tree
+    const char *filter = "system~\"System4\" and result in (Failed,Pending) and id between 100 and 900000 and active";
+    char error[MAX_LINE];
+    QueryNode *query = loaded ? query_compile(filter, error, sizeof(error)) : NULL;
+    if (query)
+    {
+        double start = now_ms();
+        int scanned = 0;
+        for (int i = 0; i < db.count; i++)
+        {
+            char id_str[20];
+            snprintf(id_str, sizeof(id_str), "%d", db.test_ids[i]);
+            const char *result = test_result_to_string(db.results[i]);
+            long id = strtol(id_str, NULL, 10);
+            if (strcasestr(db.systems.strings[db.system_codes[i]], "System4") &&
+                (strcasecmp(result, "Failed") == 0 || strcasecmp(result, "Pending") == 0) && id >= 100 &&
+                id <= 900000 && database_is_active(i))
+            {
+                results.rows[scanned++] = (uint32_t)i;
+            }
+        }
+        double scan_ms = now_ms() - start;
 
-    // Test string lengths don't exceed buffer sizes
-    char test_system[100] = "TestSystemName";
-    char test_type[100] = "TestType";
-    assert(strlen(test_system) < 100);
-    assert(strlen(test_type) < 100);
+        double best = -1;
+        int matched = 0;
+        for (int trial = 0; trial < BENCH_TRIALS; trial++)
+        {
+            start = now_ms();
+            matched = query_select(query, &results);
+            double elapsed = now_ms() - start;
+            if (best < 0 || elapsed < best)
+                best = elapsed;
+        }
+        query_free(query);
 
-    // Test that we can safely copy strings
-    TestRecord safe_record = {0};
-    strncpy(safe_record.system_name, test_system, sizeof(safe_record.system_name) - 1);
-    safe_record.system_name[sizeof(safe_record.system_name) - 1] = '\0';
-    strncpy(safe_record.test_type, test_type, sizeof(safe_record.test_type) - 1);
-    safe_record.test_type[sizeof(safe_record.test_type) - 1] = '\0';
+        start = now_ms();
+        query = query_compile(filter, error, sizeof(error));
+        double compile_ms = now_ms() - start;
+        query_free(query);
 
-    assert(strlen(safe_record.system_name) == strlen(test_system));
-    assert(strlen(safe_record.test_type) == strlen(test_type));
+        printf("\nFilter, %d rows (ms): %s\n", BENCH_LAYOUT_ROWS, filter);
+        printf("%-34s %10.2f\n", "Per-row strings", scan_ms);
+        printf("%-34s %10.2f  (compile %.3f ms, %d matches%s)\n", "Compiled predicates", best, compile_ms, matched,
+               matched == scanned ? "" : ", ✗ mismatch");
+    }
 
-    printf("✓ memory safety tests passed\n");
+    if (!loaded)
+        printf("Error: Unable to allocate memory for the search benchmark.\n");
 
-    // Restore original database state
+    database_reset();
     db = *original_db;
     free(original_db);
-
-    printf("\nAll CRUD Operations Tests PASSED!\n");
-    printf("Total test categories: 6\n");
-    printf("- find_record_by_id: ✓\n");
-    printf("- get_next_test_id: ✓\n");
-    printf("- database record validation: ✓\n");
-    printf("- CSV header validation: ✓\n");
-    printf("- database bounds checking: ✓\n");
-    printf("- memory safety: ✓\n");
+    rowset_free(&results);
 }
 
-void run_all_tests(void)
+void run_benchmarks(void)
 {
     printf("╔══════════════════════════════════════════════════════════════╗\n");
-    printf("║                    UNIT TEST SUITE                           ║\n");
-    printf("║                 System Testing Data Manager                  ║\n");
+    printf("║                      BENCHMARK SUITE                         ║\n");
+    printf("║                System Testing Data Manager                   ║\n");
     printf("╚══════════════════════════════════════════════════════════════╝\n\n");
 
-    printf("Starting comprehensive unit test suite...\n\n");
-
-    // Test input validation functions
-    printf("Test Category 1: Input Validation\n");
-    printf("────────────────────────────────────────\n");
-    test_input_validation();
-
-    printf("\n\nTest Category 2: CRUD Operations\n");
-    printf("────────────────────────────────────────\n");
-    test_crud_operations();
-
-    printf("\n\n╔══════════════════════════════════════════════════════════════╗\n");
-    printf("║                     TEST SUMMARY                             ║\n");
-    printf("╠══════════════════════════════════════════════════════════════╣\n");
-    printf("║ Input Validation Tests:     PASSED                           ║\n");
-    printf("║ CRUD Operations Tests:      PASSED                           ║\n");
-    printf("╠══════════════════════════════════════════════════════════════╣\n");
-    printf("║ ALL UNIT TESTS PASSED SUCCESSFULLY!                          ║\n");
-    printf("╚══════════════════════════════════════════════════════════════╝\n");
+    run_tokenizer_benchmark();
+    run_layout_benchmark();
+    run_journal_benchmark();
+    run_save_benchmark();
+    run_snapshot_benchmark();
+    run_search_benchmark();
+    run_substring_benchmark();
+    run_screen_benchmark();
 }
 
-void run_e2e_tests(void)
+// Page flips of the record listing: a full redraw after clear(1), as the pager
+// used to do, against the renderer's changed-lines update
+void run_screen_benchmark(void)
 {
-    printf("╔══════════════════════════════════════════════════════════════╗\n");
-    printf("║                   END-TO-END TEST SUITE                      ║\n");
-    printf("║                System Testing Data Manager                   ║\n");
-    printf("╚══════════════════════════════════════════════════════════════╝\n\n");
-
-    printf("Starting End-to-End testing...\n\n");
-
-    // Save original database state
     Database *original_db = malloc(sizeof(Database));
-    if (!original_db)
+    RowSet rows;
+    FILE *sink = fopen(NULL_DEVICE, "w");
+    if (!original_db || !sink || !rowset_init(&rows, PAGINATION_SIZE * 2))
     {
-        printf("Error: Unable to allocate memory for database backup.\n");
+        printf("Error: Unable to set up the screen benchmark.\n");
+        free(original_db);
+        if (sink)
+            fclose(sink);
         return;
     }
     memcpy(original_db, &db, sizeof(Database));
-
-    printf("E2E Test 1: Complete Database Workflow\n");
-    printf("─────────────────────────────────────────────\n");
-
-    // Initialize test database
     memset(&db, 0, sizeof(db));
-    strcpy(db.filename, "e2e_test.csv");
-    db.next_id = 1;
-
-    // Test 1: Create test records
-    printf("Testing complete record creation workflow...\n");
+    int loaded = bench_fill_database(PAGINATION_SIZE * 2);
+    for (int i = 0; loaded && i < PAGINATION_SIZE * 2; i++)
+        rows.rows[rows.count++] = (uint32_t)i;
+
+    int saved_ansi = screen.ansi;
+    screen.ansi = 1;
+    int flips = 1000;
+    size_t bytes[2] = {0, 0};
+    double renderer_ms = 0;
+    double clear_ms = 0;
+    if (loaded)
+    {
+        screen_invalidate();
+        double start = now_ms();
+        for (int i = 0; i < flips; i++)
+        {
+            compose_records_page(&rows, i & 1);
+            screen_compose("Page 1 of 2 | (p)revious (n)ext (q)uit: ", 0, 0);
+            fwrite(screen.output, 1, screen.output_length, sink);
+            fflush(sink);
+            bytes[1] += screen.output_length;
+        }
+        renderer_ms = (now_ms() - start) / flips;
 
-    TestRecord test_records[] = {
-        {1, "WebApp Frontend", "UnitTest", PASSED, 1},
-        {2, "API Gateway", "IntegrationTest", FAILED, 1},
-        {3, "Database Layer", "SystemTest", PENDING, 1},
-        {4, "Authentication Service", "SecurityTest", SUCCESS, 1},
-        {5, "Payment System", "LoadTest", FAILED, 0} // Deleted record
-    };
+        // Spawning the clear command dominates, so fewer flips are enough
+        int clear_flips = 50;
+        start = now_ms();
+        for (int i = 0; i < clear_flips; i++)
+        {
+            system(CLEAR_TO_NULL_COMMAND);
+            screen_invalidate();
+            compose_records_page(&rows, i & 1);
+            screen_compose("Page 1 of 2 | (p)revious (n)ext (q)uit: ", 0, 0);
+            fwrite(screen.output, 1, screen.output_length, sink);
+            fflush(sink);
+            bytes[0] += screen.output_length;
+        }
+        clear_ms = (now_ms() - start) / clear_flips;
+        bytes[0] /= clear_flips;
+        bytes[1] /= flips;
+    }
+    screen.ansi = saved_ansi;
+    screen_invalidate();
 
-    // Add records to database
-    for (int i = 0; i < 5; i++)
+    if (loaded)
     {
-        db.records[db.count++] = test_records[i];
-        db.next_id = test_records[i].test_id + 1;
+        printf("\nPage flip, %d-row page (ms per flip, bytes written)\n", PAGINATION_SIZE);
+        printf("%-34s %10.3f %10zu\n", "clear command + full page", clear_ms, bytes[0]);
+        printf("%-34s %10.3f %10zu  (%.0fx faster)\n", "Changed lines, one write", renderer_ms, bytes[1],
+               renderer_ms > 0 ? clear_ms / renderer_ms : 0.0);
+    }
+    else
+    {
+        printf("Error: Unable to allocate memory for the screen benchmark.\n");
     }
 
-    assert(db.count == 5);
-    printf("✓ Record creation workflow completed\n");
-
-    // Test 2: Search functionality
-    printf("Testing search functionality...\n");
+    database_reset();
+    db = *original_db;
+    free(original_db);
+    rowset_free(&rows);
+    fclose(sink);
+}
 
-    int search_results = 0;
-    for (int i = 0; i < db.count; i++)
+// Synthetic rows shared by the benchmarks: 5000 systems, 50 types, 10% deleted
+int bench_fill_database(int rows)
+{
+    if (!database_reserve(rows))
+        return 0;
+    for (int i = 0; i < rows; i++)
     {
-        if (db.records[i].active && strcasestr(db.records[i].system_name, "API"))
-        {
-            search_results++;
-        }
+        char system_name[32];
+        char test_type[32];
+        snprintf(system_name, sizeof(system_name), "System %d", i % 5000);
+        snprintf(test_type, sizeof(test_type), "Type%d", i % 50);
+        TestRecord record = make_record(i + 1, system_name, test_type, (TestResult)(i % 4), i % 10 != 0);
+        database_set_record(db.count++, &record);
     }
-    assert(search_results == 1); // Should find "API Gateway"
-    printf("✓ Search functionality working correctly\n");
+    return 1;
+}
 
-    // Test 3: Update operations
-    printf("Testing update operations...\n");
+int bench_compare_ms(const void *a, const void *b)
+{
+    double left = *(const double *)a;
+    double right = *(const double *)b;
+    return (left > right) - (left < right);
+}
 
-    int index = find_record_by_id(2);
-    assert(index != -1);
-    TestRecord *record = &db.records[index];
-    TestResult old_result = record->test_result;
-    record->test_result = PASSED; // Change from FAILED to PASSED
-    assert(record->test_result != old_result);
-    printf("✓ Update operations working correctly\n");
+// Files the load cases read back, written once per size before timing
+const char *bench_suite_files[3] = {"bench_suite.csv", "bench_suite" SNAPSHOT_SUFFIX, "bench_suite" ARCHIVE_SUFFIX};
 
-    // Test 4: Delete and recovery operations
-    printf("Testing delete and recovery operations...\n");
+int bench_case_load_csv(void)
+{
+    return load_database(bench_suite_files[0]);
+}
 
-    // Test soft delete
-    index = find_record_by_id(3);
-    assert(index != -1);
-    assert(db.records[index].active == 1);
-    db.records[index].active = 0; // Soft delete
-    assert(db.records[index].active == 0);
+int bench_case_load_snapshot(void)
+{
+    return load_database(bench_suite_files[1]);
+}
 
-    // Test recovery
-    db.records[index].active = 1; // Recover
-    assert(db.records[index].active == 1);
-    printf("✓ Delete and recovery operations working correctly\n");
+int bench_case_load_archive(void)
+{
+    return load_database(bench_suite_files[2]);
+}
 
-    // Test 5: Data integrity checks
-    printf("Testing data integrity...\n");
+int bench_case_save_csv(void)
+{
+    return write_database_csv(bench_suite_files[0]);
+}
 
-    int active_count = 0;
-    int deleted_count = 0;
+int bench_case_save_snapshot(void)
+{
+    return write_database_snapshot(bench_suite_files[1]);
+}
 
-    for (int i = 0; i < db.count; i++)
-    {
-        if (db.records[i].active)
-        {
-            active_count++;
-        }
-        else
-        {
-            deleted_count++;
-        }
+int bench_case_save_archive(void)
+{
+    return write_database_archive(bench_suite_files[2]);
+}
 
-        // Validate each record's data integrity
-        assert(db.records[i].test_id > 0);
-        assert(strlen(db.records[i].system_name) >= MIN_NAME_LENGTH);
-        assert(strlen(db.records[i].test_type) >= MIN_NAME_LENGTH);
-        assert(db.records[i].test_result >= FAILED && db.records[i].test_result <= SUCCESS);
-        assert(db.records[i].active == 0 || db.records[i].active == 1);
+// Spread over the whole table so most lookups miss the cache
+int bench_case_find_record(void)
+{
+    int found = 0;
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+    {
+        int row = (int)(((uint64_t)i * 2654435761u) % (uint64_t)db.count);
+        found += find_record_by_id(db.test_ids[row]) == row;
     }
+    return found == BENCH_LOOKUPS;
+}
 
-    assert(active_count == 4);  // 4 active records
-    assert(deleted_count == 1); // 1 deleted record
-    printf("✓ Data integrity checks passed\n");
+int bench_case_search(void)
+{
+    RowSet results;
+    int ok = rowset_init(&results, db.count) && search_matching_rows("stem 12", &results) > 0;
+    rowset_free(&results);
+    return ok;
+}
 
-    printf("\nE2E Test 2: ID Generation and Uniqueness\n");
-    printf("──────────────────────────────────────────────\n");
+int bench_case_query(void)
+{
+    char error[MAX_LINE];
+    QueryNode *query = query_compile("system ~ \"System 1\" and result in (Failed, Pending) and active", error,
+                                     sizeof(error));
+    RowSet results;
+    int ok = query && rowset_init(&results, db.count) && query_select(query, &results) > 0;
+    if (query)
+        rowset_free(&results);
+    query_free(query);
+    return ok;
+}
 
-    // Test ID generation
-    int original_next_id = db.next_id;
-    int new_id1 = get_next_test_id();
-    int new_id2 = get_next_test_id();
+int bench_case_stats(void)
+{
+    return stats_rebuild();
+}
 
-    assert(new_id1 == original_next_id);
-    assert(new_id2 == original_next_id + 1);
-    assert(new_id1 != new_id2);
-    printf("✓ ID generation and uniqueness working correctly\n");
+// The input validators over every row's values, as an import would run them
+int bench_case_validators(void)
+{
+    int valid = 0;
+    for (int row = 0; row < db.count; row++)
+    {
+        char test_id[12];
+        format_test_id(db.test_ids[row], test_id);
+        valid += validate_system_name(db.systems.strings[db.system_codes[row]]) &&
+                 validate_test_type(db.types.strings[db.type_codes[row]]) && validate_test_id(test_id);
+    }
+    return valid == db.count;
+}
 
-    printf("\nE2E Test 3: Input Validation Integration\n");
-    printf("─────────────────────────────────────────────────\n");
+// A count like 250, 10k or 2M; end is left after the suffix
+long long parse_row_count(const char *text, char **end)
+{
+    long long count = strtoll(text, end, 10);
+    if (*end == text)
+        return -1;
+    if (**end == 'k' || **end == 'K')
+        count *= 1000, (*end)++;
+    else if (**end == 'm' || **end == 'M')
+        count *= 1000000, (*end)++;
+    return count;
+}
 
-    // Test system name validation in context
-    char valid_names[][50] = {
-        "Production API Server",
-        "Test-Environment_v2.0",
-        "System[Backend]",
-        "Database (Primary)"};
+// Comma-separated row counts, with k and M suffixes allowed; returns how many
+int bench_parse_sizes(const char *text, int *sizes)
+{
+    int count = 0;
+    while (*text && count < BENCH_MAX_SIZES)
+    {
+        char *end;
+        long long size = parse_row_count(text, &end);
+        if (size <= 0 || size > INT_MAX / 2 || (*end != ',' && *end != '\0'))
+            return 0;
+        sizes[count++] = (int)size;
+        text = *end ? end + 1 : end;
+    }
+    return *text ? 0 : count;
+}
 
-    for (int i = 0; i < 4; i++)
+// bench subcommand: every case at every size, warmup calls then timed trials.
+// Trials default to more at small sizes so p99 has samples behind it.
+int bench_main(int argc, char *argv[])
+{
+    const BenchCase cases[] = {
+        {"load_database.csv", bench_case_load_csv, 0},
+        {"load_database" SNAPSHOT_SUFFIX, bench_case_load_snapshot, 0},
+        {"load_database" ARCHIVE_SUFFIX, bench_case_load_archive, 0},
+        {"save_database.csv", bench_case_save_csv, 0},
+        {"save_database" SNAPSHOT_SUFFIX, bench_case_save_snapshot, 0},
+        {"save_database" ARCHIVE_SUFFIX, bench_case_save_archive, 0},
+        {"find_record_by_id", bench_case_find_record, BENCH_LOOKUPS},
+        {"search_matching_rows", bench_case_search, 0},
+        {"query_select", bench_case_query, 0},
+        {"stats_rebuild", bench_case_stats, 0},
+        {"validators", bench_case_validators, 0},
+    };
+    const int case_count = (int)(sizeof(cases) / sizeof(cases[0]));
+
+    int sizes[BENCH_MAX_SIZES];
+    int size_count = bench_parse_sizes(BENCH_DEFAULT_SIZES, sizes);
+    int trials = 0;
+    int warmup = 1;
+    const char *output = NULL;
+    for (int i = 2; i < argc; i++)
     {
-        assert(validate_system_name(valid_names[i]) == 1);
+        int has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--sizes") == 0 && has_value)
+            size_count = bench_parse_sizes(argv[++i], sizes);
+        else if (strcmp(argv[i], "--trials") == 0 && has_value)
+            trials = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && has_value)
+            warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--output") == 0 && has_value)
+            output = argv[++i];
+        else
+            size_count = 0;
+    }
+    if (size_count == 0 || trials < 0 || warmup < 0)
+    {
+        print_usage(argv[0]);
+        return 2;
     }
 
-    // Test test type validation in context
-    char valid_types[][30] = {
-        "UnitTest",
-        "IntegrationTest",
-        "SystemTest",
-        "PerformanceTest"};
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out)
+    {
+        printf("error,0,unable to open %s\n", output);
+        return 1;
+    }
+
+    // Saves are timed without fsync, which would only measure the disk
+    init_structural_scanner();
+    DurabilityMode saved_durability = durability_mode;
+    durability_mode = DURABILITY_NONE;
+    fprintf(out, "{\n  \"suite\": \"testdata-manager\",\n  \"unit\": \"ms\",\n  \"fsync\": false,\n");
+    fprintf(out, "  \"tokenizer\": \"%s\",\n  \"load_threads\": %d,\n  \"save_threads\": %d,\n",
+            structural_kernel_name, get_load_thread_count(SIZE_MAX), get_save_thread_count(INT_MAX));
+    fprintf(out, "  \"results\": [");
+
+    int failed = 0;
+    int first = 1;
+    for (int s = 0; s < size_count && !failed; s++)
+    {
+        int rows = sizes[s];
+        int size_trials = trials > 0 ? trials : rows <= 10000 ? 101 : rows <= 100000 ? 31 : rows <= 1000000 ? 11 : 5;
+        double *samples = malloc((size_t)size_trials * sizeof(double));
+        database_reset();
+        failed = !samples || !bench_fill_database(rows) || !write_database_csv(bench_suite_files[0]) ||
+                 !write_database_snapshot(bench_suite_files[1]) || !write_database_archive(bench_suite_files[2]);
+
+        for (int c = 0; c < case_count && !failed; c++)
+        {
+            for (int i = 0; i < warmup && !failed; i++)
+                failed = !cases[c].run();
+            for (int i = 0; i < size_trials && !failed; i++)
+            {
+                double start = now_ms();
+                failed = !cases[c].run();
+                samples[i] = now_ms() - start;
+            }
+            if (failed)
+            {
+                fprintf(stderr, "error,0,%s failed at %d rows\n", cases[c].name, rows);
+                break;
+            }
+
+            qsort(samples, (size_t)size_trials, sizeof(double), bench_compare_ms);
+            int ops = cases[c].ops > 0 ? cases[c].ops : rows;
+            double median = samples[size_trials / 2];
+            double p99 = samples[(size_trials * 99 + 99) / 100 - 1]; // Nearest rank
+            fprintf(out,
+                    "%s\n    {\"name\": \"%s\", \"rows\": %d, \"ops\": %d, \"warmup\": %d, \"trials\": %d, "
+                    "\"min\": %.4f, \"median\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"ns_per_op\": %.2f}",
+                    first ? "" : ",", cases[c].name, rows, ops, warmup, size_trials, samples[0], median, p99,
+                    samples[size_trials - 1], median * 1e6 / ops);
+            first = 0;
+            fflush(out);
+        }
+        free(samples);
+    }
+    fprintf(out, "\n  ]\n}\n");
+    durability_mode = saved_durability;
+
+    database_reset();
+    for (int f = 0; f < 3; f++)
+        remove(bench_suite_files[f]);
+    if (output)
+        fclose(out);
+    return failed;
+}
+
+// splitmix64: small state, fast, and the same sequence on every platform
+uint64_t generator_random(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// A draw below this (from the top 53 bits) happens with the given probability
+uint64_t generator_threshold(double probability)
+{
+    return (uint64_t)(probability * 9007199254740992.0);
+}
+
+// Parses --name value pairs from argv[first]; returns 0 on anything unknown or out of range
+int generator_parse_options(int argc, char *argv[], int first, GeneratorOptions *options)
+{
+    GeneratorOptions defaults = {1000000, 1, 1000, 20, {15, 60, 10, 15}, 0.1, 0.01, 100, 0.0};
+    *options = defaults;
+    for (int i = first; i < argc; i++)
+    {
+        if (i + 1 >= argc || strncmp(argv[i], "--", 2) != 0)
+            return 0;
+        const char *name = argv[i] + 2;
+        const char *value = argv[++i];
+        char *end;
+        if (strcmp(name, "rows") == 0)
+            options->rows = parse_row_count(value, &end);
+        else if (strcmp(name, "seed") == 0)
+            options->seed = strtoull(value, &end, 10);
+        else if (strcmp(name, "systems") == 0)
+            options->systems = (int)parse_row_count(value, &end);
+        else if (strcmp(name, "types") == 0)
+            options->types = (int)parse_row_count(value, &end);
+        else if (strcmp(name, "deleted") == 0)
+            options->deleted = strtod(value, &end);
+        else if (strcmp(name, "gaps") == 0)
+            options->gaps = strtod(value, &end);
+        else if (strcmp(name, "max-gap") == 0)
+            options->max_gap = (int)strtol(value, &end, 10);
+        else if (strcmp(name, "duplicates") == 0)
+            options->duplicates = strtod(value, &end);
+        else if (strcmp(name, "results") == 0)
+        {
+            end = (char *)value;
+            for (int r = FAILED; r <= SUCCESS; r++)
+            {
+                options->result_weights[r] = (int)strtol(end, &end, 10);
+                if (r < SUCCESS && *end++ != ',')
+                    return 0;
+            }
+        }
+        else
+            return 0;
+        if (end == value || *end != '\0')
+            return 0;
+    }
 
-    for (int i = 0; i < 4; i++)
+    int weight_total = 0;
+    for (int r = FAILED; r <= SUCCESS; r++)
     {
-        assert(validate_test_type(valid_types[i]) == 1);
+        if (options->result_weights[r] < 0 || options->result_weights[r] > 1000000)
+            return 0;
+        weight_total += options->result_weights[r];
     }
+    return options->rows >= 0 && options->systems >= 1 && options->types >= 1 && weight_total > 0 &&
+           options->deleted >= 0 && options->deleted <= 1 && options->gaps >= 0 && options->gaps <= 1 &&
+           options->max_gap >= 1 && options->duplicates >= 0 && options->duplicates <= 1;
+}
 
-    printf("✓ Input validation integration working correctly\n");
-
-    printf("\nE2E Test 4: Enum Conversion Workflow\n");
-    printf("─────────────────────────────────────────────\n");
-
-    // Test complete enum conversion workflow
-    const char *result_strings[] = {"Failed", "Passed", "Pending", "Success"};
-    TestResult expected_results[] = {FAILED, PASSED, PENDING, SUCCESS};
+// Streams rows straight to path ("-" for stdout) a buffer at a time, so the
+// output can be far larger than memory. Returns 1 on success, 0 if a write
+// fails and -1 if the TestIDs would pass INT_MAX; a failed file is removed.
+int generate_dataset(const char *path, const GeneratorOptions *options)
+{
+    int to_stdout = strcmp(path, "-") == 0;
+    FILE *file = to_stdout ? stdout : fopen(path, "wb");
+    if (!file)
+        return 0;
+    fflush(file);
 
-    for (int i = 0; i < 4; i++)
+    char result_fields[SUCCESS + 1][16] = {{0}};
+    size_t result_lengths[SUCCESS + 1];
+    int result_cutoffs[SUCCESS + 1];
+    int weight_total = 0;
+    for (int r = FAILED; r <= SUCCESS; r++)
     {
-        TestResult converted = string_to_test_result(result_strings[i]);
-        assert(converted == expected_results[i]);
-
-        const char *back_converted = test_result_to_string(converted);
-        assert(strcmp(back_converted, result_strings[i]) == 0);
+        result_lengths[r] = (size_t)snprintf(result_fields[r], sizeof(result_fields[r]), "%s,",
+                                             test_result_to_string((TestResult)r));
+        weight_total += options->result_weights[r];
+        result_cutoffs[r] = weight_total;
     }
 
-    printf("✓ Enum conversion workflow working correctly\n");
+    uint64_t state = options->seed;
+    uint64_t deleted_below = generator_threshold(options->deleted);
+    uint64_t gap_below = generator_threshold(options->gaps);
+    uint64_t duplicate_below = generator_threshold(options->duplicates);
+    int recent[GENERATOR_RECENT_IDS];
+    long long next_id = 1;
+
+    char *buffer = malloc(SAVE_BUFFER_SIZE);
+    int fd = fileno(file);
+    int ok = buffer != NULL;
+    size_t used = 0;
+    if (ok)
+    {
+        memcpy(buffer, REQUIRED_HEADER "\n", sizeof(REQUIRED_HEADER));
+        used = sizeof(REQUIRED_HEADER);
+    }
 
-    printf("\nE2E Test 5: Memory Management\n");
-    printf("───────────────────────────────────────\n");
+    for (long long row = 0; ok && row < options->rows; row++)
+    {
+        // Every draw happens on every row, so one option never shifts the others' sequences
+        uint64_t id_draw = generator_random(&state) >> 11;
+        uint64_t gap_draw = generator_random(&state);
+        uint64_t system_draw = generator_random(&state);
+        uint64_t type_draw = generator_random(&state);
+        uint64_t result_draw = generator_random(&state);
+        uint64_t active_draw = generator_random(&state) >> 11;
+
+        int test_id;
+        if (row > 0 && id_draw < duplicate_below)
+        {
+            long long window = row < GENERATOR_RECENT_IDS ? row : GENERATOR_RECENT_IDS;
+            test_id = recent[gap_draw % (uint64_t)window];
+        }
+        else
+        {
+            if ((gap_draw >> 11) < gap_below)
+                next_id += 1 + (long long)(gap_draw % (uint64_t)options->max_gap);
+            if (next_id > INT_MAX)
+            {
+                ok = -1;
+                break;
+            }
+            test_id = (int)next_id++;
+        }
+        recent[row % GENERATOR_RECENT_IDS] = test_id;
 
-    // Test memory allocation and deallocation patterns
-    TestRecord *temp_records = malloc(db.count * sizeof(TestRecord));
-    assert(temp_records != NULL);
+        if (used + 128 > SAVE_BUFFER_SIZE)
+        {
+            ok = write_fully(fd, buffer, used);
+            used = 0;
+        }
+        char *p = buffer + used;
+        p += format_test_id(test_id, p);
+        memcpy(p, ",System-", 8);
+        p += 8;
+        p += format_test_id((int)(system_draw % (uint64_t)options->systems), p);
+        memcpy(p, ",Type", 5);
+        p += 5;
+        p += format_test_id((int)(type_draw % (uint64_t)options->types), p);
+        *p++ = ',';
+        int pick = (int)(result_draw % (uint64_t)weight_total);
+        int result = FAILED;
+        while (pick >= result_cutoffs[result])
+            result++;
+        memcpy(p, result_fields[result], sizeof(result_fields[result]));
+        p += result_lengths[result];
+        *p++ = active_draw < deleted_below ? '0' : '1';
+        *p++ = '\n';
+        used = (size_t)(p - buffer);
+    }
+    if (ok == 1 && used > 0)
+        ok = write_fully(fd, buffer, used);
+    free(buffer);
+
+    if (!to_stdout && fclose(file) != 0 && ok == 1)
+        ok = 0;
+    if (!to_stdout && ok != 1)
+        remove(path); // No partial dataset left behind
+    return ok;
+}
 
-    // Copy and verify data
-    for (int i = 0; i < db.count; i++)
+// generate subcommand: generate <output.csv|-> [--option value]...
+int generate_main(int argc, char *argv[])
+{
+    GeneratorOptions options;
+    if (argc < 3 || !generator_parse_options(argc, argv, 3, &options) ||
+        (strcmp(argv[2], "-") != 0 && strlen(argv[2]) >= MAX_PATH))
     {
-        temp_records[i] = db.records[i];
-        assert(temp_records[i].test_id == db.records[i].test_id);
-        assert(strcmp(temp_records[i].system_name, db.records[i].system_name) == 0);
+        print_usage(argv[0]);
+        return 2;
     }
 
-    free(temp_records);
-    printf("✓ Memory management working correctly\n");
-
-    // Restore original database state
-    db = *original_db;
-    free(original_db);
+    // Rows are streamed as CSV text; the binary formats come from export
+    if (is_binary_database_file(argv[2]))
+    {
+        fprintf(stderr, "error,0,generate writes CSV; use export <csv> %s to convert it\n", argv[2]);
+        return 2;
+    }
 
-    printf("\n╔══════════════════════════════════════════════════════════════╗\n");
-    printf("║                    E2E TEST SUMMARY                          ║\n");
-    printf("╠══════════════════════════════════════════════════════════════╣\n");
-    printf("║ Complete Database Workflow:    PASSED                        ║\n");
-    printf("║ ID Generation & Uniqueness:    PASSED                        ║\n");
-    printf("║ Input Validation Integration:  PASSED                        ║\n");
-    printf("║ Enum Conversion Workflow:      PASSED                        ║\n");
-    printf("║ Memory Management:             PASSED                        ║\n");
-    printf("╠══════════════════════════════════════════════════════════════╣\n");
-    printf("║ ALL E2E TESTS PASSED SUCCESSFULLY!                           ║\n");
-    printf("╚══════════════════════════════════════════════════════════════╝\n");
+    int generated = generate_dataset(argv[2], &options);
+    if (generated < 0)
+    {
+        fprintf(stderr, "error,0,TestIDs would pass %d; lower --rows, --gaps or --max-gap\n", INT_MAX);
+        return 1;
+    }
+    if (!generated)
+    {
+        fprintf(stderr, "error,0,unable to write %s\n", argv[2]);
+        return 1;
+    }
+    if (strcmp(argv[2], "-") != 0)
+        printf("ok,generate,%lld,%s\n", options.rows, argv[2]);
+    return 0;
 }
 
 void show_main_menu(void)
@@ -2092,13 +10394,20 @@ void show_main_menu(void)
     printf("4. Update record\n");
     printf("5. Recovery data\n");
     printf("6. Change database\n");
-    printf("7. Run tests\n");
-    printf("8. Exit program\n");
+    printf("7. Statistics\n");
+    printf("8. Metrics\n");
+    printf("9. Run tests\n");
+    printf("10. Exit program\n");
 }
 
 void cleanup_memory(void)
 {
-    memset(&db, 0, sizeof(Database));
+    if (database_checkpoint())
+        printf("✓ Journal checkpointed\n");
+    else
+        printf("✗ Unable to write %s; changes remain in its journal\n", db.filename);
+
+    database_reset();
     printf("✓ Global database structure cleared\n");
     
     fflush(stdout);
@@ -2114,24 +10423,438 @@ char *strcasestr(const char *haystack, const char *needle)
     if (!haystack || !needle)
         return NULL;
 
-    size_t needle_len = strlen(needle);
-    if (needle_len == 0)
-        return (char *)haystack;
+    return (char *)find_substring_ci(haystack, strlen(haystack), needle, strlen(needle));
+}
+#endif
+
+void print_usage(const char *program)
+{
+    printf("Usage:\n");
+    printf("  %s                                  interactive menu\n", program);
+    printf("  %s --metrics-json <file|-> ...      any of these, writing latency metrics at exit\n", program);
+    printf("  %s --trace <file.json> ...          any of these, writing a Chrome trace at exit\n", program);
+    printf("  %s load <csv>\n", program);
+    printf("  %s add <csv> <system> <type> <result>\n", program);
+    printf("  %s update <csv> <id> <system> <type> <result>\n", program);
+    printf("  %s delete <csv> <id>\n", program);
+    printf("  %s search <csv> <term>\n", program);
+    printf("  %s query <csv> <filter>             e.g. 'system~\"API\" and result in (Failed,Pending) and active'\n",
+           program);
+    printf("  %s export <csv> <output.csv|.tdb|.tda>  binary snapshot or compressed archive\n", program);
+    printf("  %s stats <csv>\n", program);
+    printf("  %s bench [--sizes 10k,100k,1M,10M] [--trials N] [--warmup N] [--output file.json]\n", program);
+    printf("                                                 times the hot paths, prints median and p99 as JSON\n");
+    printf("  %s generate <output.csv|-> [--rows N] [--seed N] [--systems N] [--types N]\n", program);
+    printf("           [--results F,P,Pe,S] [--deleted R] [--gaps R] [--max-gap N] [--duplicates R]\n");
+    printf("                                                 writes a reproducible synthetic database\n");
+    printf("  %s --script <file|-> <csv>           one command per line, fields\n", program);
+    printf("                                                 separated by commas, e.g. add,WebApp,UnitTest,Passed\n");
+    printf("\nOutput is one comma-separated line per result: record,..., ok,<command>,...\n");
+    printf("or error,<line>,<message>. The exit status is 1 if any command failed.\n");
+    printf("Warnings, such as invalid results in the file or a replayed journal, go to stderr.\n");
+    printf("Any <csv> may also be a .tdb snapshot or a .tda archive.\n");
+}
+
+// Splits a script line in place on commas into at most max_fields fields; returns the count
+int split_batch_line(char *line, char **fields, int max_fields)
+{
+    int count = 0;
+    char *field = line;
+    while (count < max_fields)
+    {
+        char *comma = count + 1 < max_fields ? strchr(field, ',') : NULL; // The last field keeps the rest
+        if (comma)
+            *comma = '\0';
+        fields[count++] = trim_string(field);
+        if (!comma)
+            break;
+        field = comma + 1;
+    }
+    return count;
+}
+
+void batch_print_record(FILE *out, int row)
+{
+    fprintf(out, "record,%d,%s,%s,%s,%d\n", db.test_ids[row], db.systems.strings[db.system_codes[row]],
+            db.types.strings[db.type_codes[row]], test_result_to_string(db.results[row]), database_is_active(row));
+}
+
+// Runs one command (fields[0]) against the loaded database. Returns 1 on success;
+// on failure prints error,<line>,<message> and returns 0.
+int batch_execute(FILE *out, char **fields, int field_count, int line)
+{
+    const char *command = fields[0];
+    int expected = -1;
+    if (strcmp(command, "load") == 0 || strcmp(command, "stats") == 0)
+        expected = 1;
+    else if (strcmp(command, "delete") == 0 || strcmp(command, "search") == 0 || strcmp(command, "query") == 0 ||
+             strcmp(command, "export") == 0)
+        expected = 2;
+    else if (strcmp(command, "add") == 0)
+        expected = 4;
+    else if (strcmp(command, "update") == 0)
+        expected = 5;
+
+    if (expected < 0)
+    {
+        fprintf(out, "error,%d,unknown command '%s'\n", line, command);
+        return 0;
+    }
+    if (field_count != expected)
+    {
+        fprintf(out, "error,%d,%s takes %d argument(s)\n", line, command, expected - 1);
+        return 0;
+    }
+
+    if (strcmp(command, "load") == 0)
+    {
+        fprintf(out, "ok,load,%d,%d,%d\n", db.count, database_count_active(), database_count_deleted());
+        return 1;
+    }
 
-    for (const char *p = haystack; *p; p++)
+    if (strcmp(command, "stats") == 0)
     {
-        if (strncasecmp(p, needle, needle_len) == 0)
+        if (!stats_ensure())
+        {
+            fprintf(out, "error,%d,out of memory\n", line);
+            return 0;
+        }
+        for (int r = FAILED; r <= SUCCESS; r++)
+            fprintf(out, "result,%s,%d\n", test_result_to_string((TestResult)r), db.stats.by_result[r]);
+        for (uint32_t code = 0; code < db.systems.count; code++)
         {
-            return (char *)p;
+            if (stats_system_total(code) > 0)
+                fprintf(out, "system,%s,%d,%d\n", db.systems.strings[code], stats_system_total(code),
+                        db.stats.system_results[(size_t)code * (SUCCESS + 1) + FAILED]);
         }
+        for (uint32_t code = 0; code < db.types.count; code++)
+        {
+            if (db.stats.type_counts[code] > 0)
+                fprintf(out, "type,%s,%d\n", db.types.strings[code], db.stats.type_counts[code]);
+        }
+        fprintf(out, "ok,stats,%d,%d\n", database_count_active(), database_count_deleted());
+        return 1;
     }
-    return NULL;
+
+    if (strcmp(command, "search") == 0)
+    {
+        if (strlen(fields[1]) < 3)
+        {
+            fprintf(out, "error,%d,search term must be at least 3 characters\n", line);
+            return 0;
+        }
+        RowSet results;
+        uint64_t start = now_ns();
+        TRACE_BEGIN("search");
+        int found = rowset_init(&results, db.count) ? search_matching_rows(fields[1], &results) : -1;
+        TRACE_END("search");
+        metrics_record(METRIC_SEARCH, start);
+        if (found < 0)
+        {
+            rowset_free(&results);
+            fprintf(out, "error,%d,out of memory\n", line);
+            return 0;
+        }
+        for (int i = 0; i < results.count; i++)
+            batch_print_record(out, (int)results.rows[i]);
+        fprintf(out, "ok,search,%d\n", results.count);
+        rowset_free(&results);
+        return 1;
+    }
+
+    if (strcmp(command, "query") == 0)
+    {
+        char error[MAX_LINE];
+        QueryNode *query = query_compile(fields[1], error, sizeof(error));
+        if (!query)
+        {
+            fprintf(out, "error,%d,%s\n", line, error);
+            return 0;
+        }
+        RowSet results;
+        if (!rowset_init(&results, db.count))
+        {
+            query_free(query);
+            fprintf(out, "error,%d,out of memory\n", line);
+            return 0;
+        }
+        uint64_t start = now_ns();
+        TRACE_BEGIN("search");
+        query_select(query, &results);
+        TRACE_END("search");
+        metrics_record(METRIC_SEARCH, start);
+        query_free(query);
+        for (int i = 0; i < results.count; i++)
+            batch_print_record(out, (int)results.rows[i]);
+        fprintf(out, "ok,query,%d\n", results.count);
+        rowset_free(&results);
+        return 1;
+    }
+
+    if (strcmp(command, "export") == 0)
+    {
+        if (strlen(fields[1]) >= MAX_PATH || strcmp(fields[1], db.filename) == 0)
+        {
+            fprintf(out, "error,%d,invalid export path '%s'\n", line, fields[1]);
+            return 0;
+        }
+        // A .tdb path converts to a binary snapshot, .tda to a compressed archive
+        int written = is_snapshot_file(fields[1])  ? write_database_snapshot(fields[1])
+                      : is_archive_file(fields[1]) ? write_database_archive(fields[1])
+                                                   : write_database_csv(fields[1]);
+        if (!written)
+        {
+            fprintf(out, "error,%d,unable to write %s\n", line, fields[1]);
+            return 0;
+        }
+        fprintf(out, "ok,export,%d,%s\n", db.count, fields[1]);
+        return 1;
+    }
+
+    // add, update and delete name or locate a record first
+    int index = -1;
+    int id_field = strcmp(command, "add") == 0 ? 0 : 1;
+    if (id_field)
+    {
+        if (!validate_test_id(fields[1]))
+        {
+            fprintf(out, "error,%d,invalid TestID '%s'\n", line, fields[1]);
+            return 0;
+        }
+        index = find_record_by_id(atoi(fields[1]));
+        if (index == -1)
+        {
+            fprintf(out, "error,%d,TestID %s not found\n", line, fields[1]);
+            return 0;
+        }
+    }
+
+    if (strcmp(command, "delete") == 0)
+    {
+        if (!database_is_active(index))
+        {
+            fprintf(out, "error,%d,TestID %s is already deleted\n", line, fields[1]);
+            return 0;
+        }
+        if (!database_set_active(index, 0))
+        {
+            fprintf(out, "error,%d,unable to write the journal\n", line);
+            return 0;
+        }
+        fprintf(out, "ok,delete,%d\n", db.test_ids[index]);
+        return 1;
+    }
+
+    const char *system_name = fields[id_field + 1];
+    const char *test_type = fields[id_field + 2];
+    TestResult result = string_to_test_result(fields[id_field + 3]);
+    if (!validate_system_name(system_name))
+    {
+        fprintf(out, "error,%d,invalid SystemName '%s'\n", line, system_name);
+        return 0;
+    }
+    if (!validate_test_type(test_type))
+    {
+        fprintf(out, "error,%d,invalid TestType '%s'\n", line, test_type);
+        return 0;
+    }
+    if (result == INVALID_RESULT)
+    {
+        fprintf(out, "error,%d,invalid TestResult '%s'\n", line, fields[id_field + 3]);
+        return 0;
+    }
+
+    TestRecord record = {0};
+    record.test_id = id_field ? db.test_ids[index] : db.next_id;
+    record.system_code = dictionary_intern(&db.systems, system_name, strlen(system_name));
+    record.type_code = dictionary_intern(&db.types, test_type, strlen(test_type));
+    record.test_result = result;
+    record.active = id_field ? database_is_active(index) : 1;
+    if (record.system_code == INVALID_CODE || record.type_code == INVALID_CODE)
+    {
+        fprintf(out, "error,%d,out of memory\n", line);
+        return 0;
+    }
+
+    int ok = id_field ? database_update_record(index, &record) : database_insert_record(&record);
+    if (!ok)
+    {
+        fprintf(out, "error,%d,unable to write the journal\n", line);
+        return 0;
+    }
+    if (!id_field)
+        get_next_test_id(); // Only consumed once the insert is journaled
+    fprintf(out, "ok,%s,%d\n", command, record.test_id);
+    return 1;
+}
+
+// Runs every line of script; blank lines and lines starting with # are skipped.
+// Returns the number of commands that failed.
+int batch_run_script(FILE *out, FILE *script)
+{
+    char line[MAX_LINE];
+    int line_number = 0;
+    int failed = 0;
+    while (fgets(line, sizeof(line), script))
+    {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        char *command = trim_string(line);
+        if (command[0] == '\0' || command[0] == '#')
+            continue;
+
+        // A filter may contain commas of its own, so query keeps the rest of the line
+        char *fields[BATCH_MAX_FIELDS];
+        int max_fields = strncmp(command, "query,", 6) == 0 ? 2 : BATCH_MAX_FIELDS;
+        int field_count = split_batch_line(command, fields, max_fields);
+        if (!batch_execute(out, fields, field_count, line_number))
+            failed++;
+    }
+    return failed;
+}
+
+// Where warnings and errors printed below the command level go
+FILE *diagnostic_stream(void)
+{
+    return batch_mode ? stderr : stdout;
+}
+
+// Command-line entry: one load, the commands, then one save for the lot
+int batch_main(int argc, char *argv[])
+{
+    const char *csv;
+    FILE *script = NULL;
+    if (strcmp(argv[1], "bench") == 0)
+        return bench_main(argc, argv);
+    if (strcmp(argv[1], "generate") == 0)
+        return generate_main(argc, argv);
+    if (strcmp(argv[1], "--script") == 0)
+    {
+        if (argc != 4)
+        {
+            print_usage(argv[0]);
+            return 2;
+        }
+        csv = argv[3];
+        script = strcmp(argv[2], "-") == 0 ? stdin : fopen(argv[2], "r");
+        if (!script)
+        {
+            printf("error,0,unable to open %s\n", argv[2]);
+            return 1;
+        }
+    }
+    else if (argc >= 3 && argc - 1 <= BATCH_MAX_FIELDS)
+    {
+        csv = argv[2];
+    }
+    else
+    {
+        print_usage(argv[0]);
+        return strcmp(argv[1], "--help") == 0 ? 0 : 2;
+    }
+
+    batch_mode = 1;
+    if (strlen(csv) >= MAX_PATH || (!is_binary_database_file(csv) && !validate_csv_header(csv)) || !load_database(csv))
+    {
+        printf("error,0,unable to load %s\n", csv);
+        if (script && script != stdin)
+            fclose(script);
+        return 1;
+    }
+
+    int failed = 0;
+    database_begin_batch();
+    if (script)
+    {
+        failed = batch_run_script(stdout, script);
+        if (script != stdin)
+            fclose(script);
+    }
+    else
+    {
+        // argv minus the program name and the CSV, as one command line
+        char *fields[BATCH_MAX_FIELDS];
+        int field_count = 0;
+        fields[field_count++] = argv[1];
+        for (int i = 3; i < argc; i++)
+            fields[field_count++] = trim_string(argv[i]);
+        failed = !batch_execute(stdout, fields, field_count, 1);
+    }
+
+    if (!database_end_batch() || !database_checkpoint())
+    {
+        printf("error,0,unable to save %s\n", csv);
+        failed++;
+    }
+    database_reset();
+    return failed > 0;
 }
-#endif
 
 // Main function
-int main(void)
+int main(int argc, char *argv[])
 {
+    const char *loader = getenv("TDM_LOADER");
+    if (loader && strcmp(loader, "buffered") == 0)
+    {
+        use_mapped_loader = 0;
+    }
+
+    const char *search_index = getenv("TDM_SEARCH_INDEX");
+    if (search_index && strcmp(search_index, "off") == 0)
+    {
+        use_search_index = 0;
+    }
+
+    const char *durability = getenv("TDM_DURABILITY");
+    if (durability)
+    {
+        durability_mode = parse_durability_mode(durability);
+    }
+
+    const char *threads = getenv("TDM_LOAD_THREADS");
+    if (threads)
+    {
+        load_threads = atoi(threads);
+    }
+
+    const char *writers = getenv("TDM_SAVE_THREADS");
+    if (writers)
+    {
+        save_threads = atoi(writers);
+    }
+
+    // --metrics-json <path> and --trace <file.json> may precede anything else,
+    // in either order; both files are written at exit
+    while (argc > 2 && (strcmp(argv[1], "--metrics-json") == 0 || strcmp(argv[1], "--trace") == 0))
+    {
+        if (strcmp(argv[1], "--metrics-json") == 0)
+        {
+            if (!metrics_json_path)
+                atexit(write_metrics_json_at_exit);
+            metrics_json_path = argv[2];
+        }
+        else
+        {
+            if (!tracing && !trace_enable())
+            {
+                printf("Error: Unable to allocate memory for the trace buffer.\n");
+                return 1;
+            }
+            if (!trace_path)
+                atexit(write_trace_at_exit);
+            trace_path = argv[2];
+        }
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+
+    // Any argument selects the non-interactive commands
+    if (argc > 1)
+    {
+        return batch_main(argc, argv);
+    }
+
     pause_screen();
     clear_screen();
     printf("╔══════════════════════════════════════════════════════════════╗\n");
@@ -2157,12 +10880,17 @@ int main(void)
     {
         show_main_menu();
 
-        int choice = get_menu_choice(1, 8);
+        int choice = get_menu_choice(1, 10);
         if (choice == -1)
         {
             continue;
         }
 
+        // One span per menu action, named like the function it runs
+        const char *action_names[] = {"", "list_all_records", "add_new_record", "search_records",
+                                      "update_record", "recovery_data", "change_database", "display_statistics",
+                                      "display_metrics", "run_tests", "exit"};
+        TRACE_BEGIN(action_names[choice]);
         switch (choice)
         {
         case 1:
@@ -2184,12 +10912,19 @@ int main(void)
             change_database();
             break;
         case 7:
+            display_statistics();
+            break;
+        case 8:
+            display_metrics();
+            break;
+        case 9:
             printf("\nSelect test type:\n");
             printf("1. Unit tests\n");
             printf("2. End-to-end tests\n");
-            printf("3. Return to main menu\n");
+            printf("3. Benchmarks\n");
+            printf("4. Return to main menu\n");
 
-            int test_choice = get_menu_choice(1, 3);
+            int test_choice = get_menu_choice(1, 4);
             if (test_choice == 1)
             {
                 clear_screen();
@@ -2202,16 +10937,24 @@ int main(void)
                 run_e2e_tests();
                 pause_screen();
             }
+            else if (test_choice == 3)
+            {
+                clear_screen();
+                run_benchmarks();
+                pause_screen();
+            }
             break;
-        case 8:
+        case 10:
             if (get_yes_no("Are you sure you want to exit?", 0, 1))
             {
                 cleanup_memory();
                 printf("Thank you for using System Testing Data Manager!\n");
+                TRACE_END(action_names[choice]);
                 return 0;
             }
             break;
         }
+        TRACE_END(action_names[choice]);
     }
 
     return 0;